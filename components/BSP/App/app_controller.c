@@ -1,4 +1,5 @@
 #include "app_controller.h"
+#include "app_state.h"
 
 #include <stdio.h>
 #include <stdint.h>
@@ -8,9 +9,23 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "baseline_store.h"
+#include "binlog.h"
+#include "checkpoint_store.h"
+#include "upload_batch.h"
+#include "upload_journal.h"
+#include "rtc_service.h"
 #include "protocol.h"
 #include "http_request.h"
 #include "sleep_analysis.h"
+#include "sleep_arousal.h"
+#include "sleep_epoch_fixed.h"
+#include "sleep_features.h"
+#include "sleep_fusion.h"
+#include "sleep_night_summary.h"
+#include "sleep_quantile.h"
+#include "sleep_rollup.h"
 #include "uart.h"
 
 static const char *TAG = "app_ctrl";
@@ -38,18 +53,91 @@ static sleep_state_t g_sleep_state = SLEEP_MONITORING;
 #define HR_WAKE_THRESH       80.0f    /* 心率高于此值认为清醒 */
 #define HR_DROP_REQUIRED     5.0f     /* 心率需下降至少5bpm */
 #define SENSOR_WARMUP_EPOCHS 2U
-#define RADAR_SAMPLES_PER_EPOCH 10U
+#define RADAR_SAMPLES_PER_EPOCH 10U      /* 3s 网格上每epoch的采样数（特征提取/浮点聚合） */
+#define RADAR_RING_SAMPLES   SLEEP_FIXED_MAX_SAMPLES   /* 1s 轮询时一个epoch约30个采样，留余量 */
+#define RADAR_MIN_SAMPLES_PER_EPOCH 4U   /* 6s 轮询时一个epoch约5个采样 */
 #define THRESH_WINDOW_EPOCHS 40U
+#define BASELINE_MIN_NIGHT_EPOCHS 60U /* 至少睡眠30分钟才更新个人基线 */
+#define LIVE_EPOCH_UPLOAD    1        /* 逐epoch实时上报（仪表盘用）；整晚数据以夜间摘要为准，可置0仅传摘要 */
+#define EPOCH_FIXED_POINT    1        /* epoch 聚合使用定点内核（与 ULP 共用），0 为浮点路径 */
+#define AROUSAL_FAST_WAKE_EVENTS 2U   /* WAKE epoch 内微觉醒事件达到该数即确认觉醒，无需等满3个epoch */
+#define RADAR_FUSION_ENABLE  1        /* 雷达片上分期与本地分期持续一致时卸载本地计算 */
+#define APP_EVENT_LOOP       0        /* 1: 接收与分期合并为单任务事件循环（UART事件+定时），省一个任务栈 */
+#define APP_TASK_STACK       4096U
+#define CHECKPOINT_PERIOD_EPOCHS 10U  /* 观察期/睡眠中每5分钟写一次断点 */
+#define CHECKPOINT_MAX_AGE_S 1200U    /* 断点不超过20分钟才恢复 */
+#define CHECKPOINT_TIME_WAIT_MS 90000U /* 开机等待系统时间有效以判断断点新旧 */
+
+/* 任务栈高水位：各任务循环末尾记录，报告中输出 */
+typedef enum
+{
+    APP_TASK_UPLOAD = 0,
+    APP_TASK_STAGE,
+    APP_TASK_UART,
+    APP_TASK_LOOP,
+    APP_TASK_COUNT
+} app_task_id_t;
+static uint32_t s_task_stack_size[APP_TASK_COUNT];
+static volatile uint32_t s_task_stack_free[APP_TASK_COUNT];   /* 历史最少剩余字节 */
+
+static void task_stack_mark(app_task_id_t id)
+{
+    s_task_stack_free[id] = (uint32_t)uxTaskGetStackHighWaterMark(NULL);
+}
 
 /* 入睡观察计数器 */
 static uint32_t g_settling_count = 0;
+static uint32_t s_wake_count = 0;    /* 睡眠中连续WAKE计数器 */
+static bool s_wake_cue_armed = false; /* 本轮入睡后已进入睡眠状态，醒来才算智能唤醒的清醒信号 */
+static uint32_t s_epoch_total = 0;   /* 已存储epoch的绝对序号，断点按此增量写入 */
+static uint32_t s_warmup_left = SENSOR_WARMUP_EPOCHS;
+static bool s_checkpoint_active = false;
+static checkpoint_state_t s_restore_st;       /* 开机读出、等待系统时间有效后接续的断点 */
+static size_t s_restore_count = 0;
 static float g_baseline_hr = 0.0f;   /* 基线心率（开始监测时的心率） */
 
+/* 个人跨夜基线（NVS持久化），用于阈值预置 */
+static sleep_baseline_t g_user_baseline = {0};
+static size_t g_night_epochs = 0;    /* 本次睡眠已持续的epoch数 */
+
+/*
+ * 整晚摘要：入睡后逐epoch累加，醒来时编码并由上传任务一次发出。
+ * 双缓冲：分期任务只写上传任务未在发送的那一块，待发/在发下标由 s_night_blob_mux 保护。
+ */
+#define NIGHT_BLOB_NONE (-1)
+static sleep_night_t g_night;
+static uint8_t s_night_blob[2][SLEEP_NIGHT_BLOB_MAX];
+static size_t s_night_blob_len[2] = {0, 0};
+static int s_night_blob_ready = NIGHT_BLOB_NONE;     /* 待发送的缓冲 */
+static int s_night_blob_sending = NIGHT_BLOB_NONE;   /* 上传任务正在发送的缓冲 */
+static portMUX_TYPE s_night_blob_mux = portMUX_INITIALIZER_UNLOCKED;
+
 #define MAX_SLEEP_EPOCHS 512
 static sleep_epoch_t g_epochs[MAX_SLEEP_EPOCHS];
 static sleep_stage_result_t g_stage_results[MAX_SLEEP_EPOCHS];
+static sleep_epoch_features_t g_epoch_features[MAX_SLEEP_EPOCHS];  /* 与 g_epochs 一一对应的扩展特征 */
+static sleep_feature_state_t g_feature_state;
 static size_t g_epoch_count = 0;
 static sleep_thresholds_t g_thresholds = {0};
+
+/* 阈值模式：运行时可切换；分位数估计器始终喂入，切换后立即可用 */
+static volatile app_threshold_mode_t s_threshold_mode = APP_THRESHOLD_MEAN_STD;
+static sleep_quantile_thresholds_t g_quantiles;
+
+/* 分期分类器：规则级联或决策树，运行时可切换；定期用另一分类器跑最近一段以比较每epoch耗时 */
+#define CLASSIFIER_SHADOW_PERIOD 20U
+#define CLASSIFIER_SHADOW_EPOCHS 64U
+typedef void (*stage_detect_fn_t)(const sleep_epoch_t *, size_t, const sleep_thresholds_t *, sleep_stage_result_t *);
+static const stage_detect_fn_t s_stage_detectors[] = {
+    [APP_CLASSIFIER_RULES] = sleep_analysis_detect_stages,
+    [APP_CLASSIFIER_TREE] = sleep_analysis_detect_stages_tree,
+};
+static volatile app_stage_classifier_t s_stage_classifier = APP_CLASSIFIER_RULES;
+static float s_classify_cost_us[2] = {0};    /* 每epoch推理耗时（指数平均） */
+static uint32_t s_checkpoint_max_us = 0;      /* 断点写入最长耗时 */
+static uint32_t s_loop_step_max_us = 0;       /* 事件循环关一次 epoch 的最长耗时（串口附加延迟） */
+static uint32_t s_classify_runs = 0;
+static sleep_stage_result_t s_shadow_results[CLASSIFIER_SHADOW_EPOCHS];
 static sleep_quality_report_t g_report = {0};
 
 static bool s_started = false;
@@ -57,11 +145,184 @@ static bool s_started = false;
 static QueueHandle_t s_health_queue = NULL;
 #define HEALTH_QUEUE_LEN 16
 
+/* 批量上传：上传任务独占，按策略攒批发送 */
+#define UPLOAD_SEND_MAX      UPLOAD_JOURNAL_READ_MAX   /* 单个请求最多携带的 epoch 数，413 时减半 */
+#define UPLOAD_RETRY_MIN_MS  10000U
+#define UPLOAD_RETRY_MAX_MS  300000U
+static upload_batch_t s_upload_batch;          /* 日志可用时为日志最新一段的内存副本，只用于刷写策略 */
+static health_data_t s_upload_send[UPLOAD_SEND_MAX];   /* 从日志读出的待发批 */
+static upload_flush_policy_t s_upload_policy = {
+    .max_items = 20,             /* 10分钟一批，整晚约50个请求 */
+    .max_age_s = 600,
+    .flush_on_transition = true,
+};
+static volatile bool s_upload_transition = false;   /* 分期任务置位，上传任务清除 */
+static sleep_state_t s_upload_phase = SLEEP_MONITORING;
+static bool s_upload_batch_supported = true;
+static uint16_t s_upload_send_max = UPLOAD_SEND_MAX;
+static uint32_t s_upload_retry_ms = 0;
+static int64_t s_upload_retry_at_us = 0;
+static uint32_t s_upload_requests = 0;
+static uint32_t s_upload_items_sent = 0;
+
 static portMUX_TYPE s_radar_sample_mux = portMUX_INITIALIZER_UNLOCKED;
-static radar_sample_t s_radar_sample_ring[RADAR_SAMPLES_PER_EPOCH];
+static radar_sample_t s_radar_sample_ring[RADAR_RING_SAMPLES];
 static size_t s_radar_sample_count = 0;
 static size_t s_radar_sample_head = 0;
 
+/* 雷达片上睡眠状态（0x84 0x02 / 0x0C）与整晚评分（0x84 0x06 / 0x0D），由接收任务写入 */
+static uint8_t s_radar_sleep_state = SLEEP_FUSION_RADAR_UNKNOWN;
+static uint32_t s_radar_sleep_ts = 0;
+static volatile uint8_t s_radar_sleep_score = 0;   /* 0 表示尚无评分 */
+static sleep_fusion_t g_fusion;
+
+/* 逐采样微觉醒检测（接收任务独占），事件数按epoch由分期任务取走 */
+static sleep_arousal_detector_t g_arousal;
+static uint32_t s_epoch_arousals = 0;
+
+/* 床上存在门控：无人时接收任务只保留存在心跳，分期/上传挂起，有人回来时立即唤醒 */
+#define MOTION_QUERY_MS          3000U    /* 有人时体动查询间隔 */
+#define PRESENCE_HEARTBEAT_MS    30000U   /* 无人时存在查询间隔 */
+#define PRESENCE_IDLE_READ_MS    1000U    /* 无人时串口阻塞读取超时，代替 20ms 轮询 */
+#define RX_POLL_MS               20U
+#define PRESENCE_END_SESSION_S   1800U    /* 睡眠中离床超过30分钟才结束本次睡眠（与雷达异常无人判定一致） */
+static volatile app_presence_t s_presence = APP_PRESENCE_UNKNOWN;
+static volatile uint8_t s_motion_info = MOTION_INFO_NONE;
+static TaskHandle_t s_stage_task = NULL;
+static int64_t s_presence_since_us = 0;      /* 以下两项由 s_radar_sample_mux 保护 */
+static int64_t s_empty_total_us = 0;         /* 已结束的无人时段累计 */
+static uint32_t s_presence_heartbeats = 0;
+static uint32_t s_epochs_skipped = 0;
+
+/* 自适应轮询：入睡观察/微觉醒/活跃/唤醒窗口 1s，稳定深睡 6s，其余 3s */
+#define POLL_FAST_MS             1000U
+#define POLL_SLOW_MS             6000U
+#define POLL_AROUSAL_HOLD_S      60U      /* 微觉醒后保持快速轮询的时长 */
+#define POLL_STABLE_NREM_EPOCHS  10U      /* 连续10个无事件NREM epoch（5分钟）后降速 */
+static uint32_t s_last_arousal_s = 0;            /* 接收任务独占 */
+static volatile uint32_t s_stable_nrem_epochs = 0;  /* 分期任务写入 */
+static uint32_t s_poll_queries[3] = {0};         /* 快/常规/慢 三档已发查询数 */
+static uint64_t s_poll_span_ms = 0;              /* 有人时段累计（按各次查询周期计） */
+
+/* 当前体动查询周期（接收任务调用，状态机阶段取自快照） */
+static uint32_t motion_query_period_ms(void)
+{
+    const uint32_t now_s = (uint32_t)time(NULL);
+    app_live_state_t live;
+    (void)app_state_read(&live);
+    if (live.phase == APP_PHASE_SETTLING ||
+        s_motion_info == MOTION_INFO_ACTIVE ||
+        (s_last_arousal_s != 0 && now_s - s_last_arousal_s < POLL_AROUSAL_HOLD_S) ||
+        alarm_service_wake_window_active())
+    {
+        return POLL_FAST_MS;
+    }
+    if (live.phase == APP_PHASE_SLEEPING && s_stable_nrem_epochs >= POLL_STABLE_NREM_EPOCHS)
+    {
+        return POLL_SLOW_MS;
+    }
+    return MOTION_QUERY_MS;
+}
+
+/* 相对固定 3s 轮询的查询次数节省比例（负值表示更多） */
+static float poll_savings_pct(void)
+{
+    const uint32_t sent = s_poll_queries[0] + s_poll_queries[1] + s_poll_queries[2];
+    const float fixed = (float)s_poll_span_ms / (float)MOTION_QUERY_MS;
+    return (fixed > 0.0f) ? (1.0f - (float)sent / fixed) * 100.0f : 0.0f;
+}
+
+/* 累计无人时长（含当前时段） */
+static int64_t presence_empty_us(int64_t now_us)
+{
+    portENTER_CRITICAL(&s_radar_sample_mux);
+    int64_t total = s_empty_total_us;
+    if (s_presence == APP_PRESENCE_EMPTY)
+    {
+        total += now_us - s_presence_since_us;
+    }
+    portEXIT_CRITICAL(&s_radar_sample_mux);
+    return total;
+}
+
+/* 当前无人时段已持续的秒数，有人时为0 */
+static uint32_t presence_empty_for_s(void)
+{
+    portENTER_CRITICAL(&s_radar_sample_mux);
+    const int64_t since = s_presence_since_us;
+    const bool empty = (s_presence == APP_PRESENCE_EMPTY);
+    portEXIT_CRITICAL(&s_radar_sample_mux);
+    return empty ? (uint32_t)((esp_timer_get_time() - since) / 1000000) : 0U;
+}
+
+/* 输出无人门控的节省统计 */
+static void presence_report(void)
+{
+    const int64_t up_us = esp_timer_get_time();
+    const int64_t empty_ms = presence_empty_us(up_us) / 1000;
+    const uint32_t polls = (uint32_t)(empty_ms / MOTION_QUERY_MS);
+    const uint32_t queries_saved = (polls > s_presence_heartbeats) ? polls - s_presence_heartbeats : 0U;
+    const uint32_t wakeups_saved = (uint32_t)(empty_ms / RX_POLL_MS - empty_ms / PRESENCE_IDLE_READ_MS);
+
+    BINLOG_I(BINLOG_MOD_PRESENCE, "[存在] 无人累计 %lu 秒 (%.1f%%)，省去体动查询 %lu 次、串口轮询 %lu 次、分期 %lu 个epoch、上传 %lu 次，存在心跳 %lu 次\n",
+             (unsigned long)(empty_ms / 1000), (up_us > 0) ? (float)empty_ms * 100000.0f / (float)up_us : 0.0f,
+             (unsigned long)queries_saved, (unsigned long)wakeups_saved, (unsigned long)s_epochs_skipped,
+             (unsigned long)(LIVE_EPOCH_UPLOAD ? s_epochs_skipped : 0U), (unsigned long)s_presence_heartbeats);
+}
+
+/* 存在状态切换（接收任务调用） */
+static void presence_set(app_presence_t presence)
+{
+    const app_presence_t prev = s_presence;
+    if (presence == prev)
+    {
+        return;
+    }
+
+    const int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&s_radar_sample_mux);
+    if (prev == APP_PRESENCE_EMPTY)
+    {
+        s_empty_total_us += now_us - s_presence_since_us;
+        /* 离床前的旧采样不与回床后的采样混在同一epoch */
+        s_radar_sample_count = 0;
+        s_radar_sample_head = 0;
+    }
+    s_presence_since_us = now_us;
+    s_presence = presence;
+    portEXIT_CRITICAL(&s_radar_sample_mux);
+
+    if (presence == APP_PRESENCE_EMPTY)
+    {
+        s_upload_transition = true;   /* 离床：已攒的 epoch 立即发出 */
+        BINLOG_I(BINLOG_MOD_PRESENCE, "[存在] 无人，暂停体动查询/分期/上传\n");
+        return;
+    }
+
+    BINLOG_I(BINLOG_MOD_PRESENCE, "[存在] 有人，恢复监测\n");
+    if (prev == APP_PRESENCE_EMPTY)
+    {
+        if (s_stage_task)
+        {
+            xTaskNotifyGive(s_stage_task);
+        }
+        presence_report();
+    }
+}
+
+app_presence_t app_controller_get_presence(void)
+{
+    return s_presence;
+}
+
+static void radar_sleep_state_set(uint8_t state)
+{
+    portENTER_CRITICAL(&s_radar_sample_mux);
+    s_radar_sleep_state = state;
+    s_radar_sleep_ts = (uint32_t)time(NULL);
+    portEXIT_CRITICAL(&s_radar_sample_mux);
+}
+
 static void radar_sample_push(uint8_t heart_rate_bpm, uint8_t respiratory_rate_bpm, uint8_t motion_level)
 {
     radar_sample_t sample = {
@@ -73,11 +334,28 @@ static void radar_sample_push(uint8_t heart_rate_bpm, uint8_t respiratory_rate_b
 
     portENTER_CRITICAL(&s_radar_sample_mux);
     s_radar_sample_ring[s_radar_sample_head] = sample;
-    s_radar_sample_head = (s_radar_sample_head + 1) % RADAR_SAMPLES_PER_EPOCH;
-    if (s_radar_sample_count < RADAR_SAMPLES_PER_EPOCH) {
+    s_radar_sample_head = (s_radar_sample_head + 1) % RADAR_RING_SAMPLES;
+    if (s_radar_sample_count < RADAR_RING_SAMPLES) {
         s_radar_sample_count++;
     }
     portEXIT_CRITICAL(&s_radar_sample_mux);
+
+    sleep_arousal_event_t ev;
+    if (sleep_arousal_update(&g_arousal, &sample, &ev))
+    {
+        portENTER_CRITICAL(&s_radar_sample_mux);
+        s_epoch_arousals++;
+        portEXIT_CRITICAL(&s_radar_sample_mux);
+        s_last_arousal_s = sample.timestamp;
+
+        app_live_state_t live;
+        (void)app_state_read(&live);
+        if (live.phase == APP_PHASE_SLEEPING)
+        {
+            BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] 微觉醒事件 (通道0x%x, 强度%.1f)\n", ev.channels, ev.score);
+            alarm_service_report_sleep_signal(ALARM_SLEEP_SIGNAL_AROUSAL);
+        }
+    }
 }
 
 /* 睡眠阶段转字符串 */
@@ -92,6 +370,18 @@ static const char *stage_to_str(sleep_stage_t s)
     }
 }
 
+static const char *radar_stage_to_cloud_str(uint8_t state)
+{
+    switch (state)
+    {
+    case SLEEP_FUSION_RADAR_DEEP:  return "DEEP";
+    case SLEEP_FUSION_RADAR_LIGHT: return "LIGHT";
+    case SLEEP_FUSION_RADAR_AWAKE: return "AWAKE";
+    case SLEEP_FUSION_RADAR_NONE:  return "NONE";
+    default: return "";
+    }
+}
+
 static const char *stage_to_cloud_str(sleep_stage_t s)
 {
     switch (s)
@@ -112,439 +402,1396 @@ static const char *quality_to_str(float score)
     return "较差";
 }
 
-static void upload_data_task(void *pvParameters)
+/*
+ * 一段睡眠结束：将本晚统计融合进个人基线并写入NVS。
+ * skip_newest 为 true 时最新一个 epoch 是未计入 g_night_epochs 的觉醒 epoch，
+ * 本晚区间随之前移一位，保留入睡后的第一个 epoch。
+ */
+static void baseline_commit_night(bool skip_newest)
 {
-    while (1)
+    const size_t avail = (skip_newest && g_epoch_count > 0) ? g_epoch_count - 1 : g_epoch_count;
+    const size_t n = (g_night_epochs < avail) ? g_night_epochs : avail;
+    g_night_epochs = 0;
+    if (n < BASELINE_MIN_NIGHT_EPOCHS)
     {
-        if (!s_health_queue)
-        {
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            continue;
-        }
+        return;
+    }
 
-        health_data_t data = {0};
-        if (xQueueReceive(s_health_queue, &data, pdMS_TO_TICKS(1000)) == pdTRUE)
-        {
-            if (data.heart_rate <= 0 && data.breathing_rate <= 0)
-            {
-                continue;
-            }
-            printf("正在上传数据 - 心率:%d 呼吸:%d 阶段:%s\n", data.heart_rate, data.breathing_rate, data.sleep_status);
-            esp_err_t err = http_send_health_data(&data);
-            if (err != ESP_OK)
-            {
-                vTaskDelay(pdMS_TO_TICKS(10000));
-                (void)xQueueSend(s_health_queue, &data, 0);
-            }
-        }
+    sleep_analysis_baseline_merge_night(&g_user_baseline, &g_epochs[avail - n], n);
+    if (baseline_store_save(&g_user_baseline) == ESP_OK)
+    {
+        BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] 个人基线已更新 (%lu晚): 呼吸%.1f 心率%.1f\n",
+                 (unsigned long)g_user_baseline.nights, g_user_baseline.rr.mean, g_user_baseline.hr.mean);
     }
 }
 
-static void sleep_stage_task(void *pvParameters)
+/* 醒来：按整晚累加器生成报告并编码，交给上传任务（上一份未发出时覆盖为最新一晚） */
+static void night_summary_finish(void)
 {
-    const TickType_t period = pdMS_TO_TICKS(EPOCH_MS);
-    uint32_t warmup_left = SENSOR_WARMUP_EPOCHS;
-    
-    printf("\n========== 睡眠监测已启动 ==========\n");
-    printf("入睡判定条件: 连续%u分钟低体动(<%.0f) + 心率下降\n", 
-           ONSET_WINDOW_EPOCHS / 2, MOTION_SLEEP_MAX);
-
-    while (1)
+    if (g_night.epoch_count < BASELINE_MIN_NIGHT_EPOCHS)
     {
-        radar_sample_t samples[RADAR_SAMPLES_PER_EPOCH] = {0};
-        size_t copied = 0;
-        portENTER_CRITICAL(&s_radar_sample_mux);
-        if (s_radar_sample_count >= RADAR_SAMPLES_PER_EPOCH) {
-            for (size_t i = 0; i < RADAR_SAMPLES_PER_EPOCH; ++i) {
-                const size_t idx = (s_radar_sample_head + i) % RADAR_SAMPLES_PER_EPOCH;
-                samples[i] = s_radar_sample_ring[idx];
-            }
-            copied = RADAR_SAMPLES_PER_EPOCH;
-        }
-        portEXIT_CRITICAL(&s_radar_sample_mux);
-
-        if (copied < RADAR_SAMPLES_PER_EPOCH) {
-            vTaskDelay(period);
-            continue;
-        }
-
-        size_t valid_rr_count = 0;
-        size_t valid_hr_count = 0;
-        float motion_sum = 0.0f;
-        float motion_max = 0.0f;
-        for (size_t i = 0; i < RADAR_SAMPLES_PER_EPOCH; ++i) {
-            const uint8_t rr = samples[i].respiratory_rate_bpm;
-            const uint8_t hr = samples[i].heart_rate_bpm;
-            const float mv = (float)samples[i].motion_level;
-            if (rr > 0 && rr <= 35) valid_rr_count++;
-            if (hr >= 60 && hr <= 120) valid_hr_count++;
-            motion_sum += mv;
-            if (mv > motion_max) motion_max = mv;
-        }
-        const float motion_avg = motion_sum / (float)RADAR_SAMPLES_PER_EPOCH;
-
-        sleep_epoch_t epoch = {0};
-        const size_t epoch_n = sleep_analysis_aggregate_samples(samples, copied, &epoch, 1);
-        if (epoch_n == 0) {
-            vTaskDelay(period);
-            continue;
-        }
-        if (valid_rr_count == 0) {
-            epoch.respiratory_rate_bpm = 0.0f;
-        }
-        if (valid_hr_count == 0) {
-            epoch.heart_rate_mean = 0.0f;
-            epoch.heart_rate_std = 0.0f;
-        }
+        return;
+    }
 
-        epoch.motion_index = motion_max;
+    /* 撤下尚未取走的旧摘要，写入不在发送中的缓冲 */
+    portENTER_CRITICAL(&s_night_blob_mux);
+    const int slot = (s_night_blob_sending == 0) ? 1 : 0;
+    s_night_blob_ready = NIGHT_BLOB_NONE;
+    portEXIT_CRITICAL(&s_night_blob_mux);
 
-        const float hr_avg = epoch.heart_rate_mean;
-        const float rr_avg = epoch.respiratory_rate_bpm;
+    sleep_quality_report_t report;
+    sleep_night_build_report(&g_night, &report);
+    const size_t len = sleep_night_encode(&g_night, &report, s_night_blob[slot], sizeof(s_night_blob[slot]));
+    if (len > 0)
+    {
+        portENTER_CRITICAL(&s_night_blob_mux);
+        s_night_blob_len[slot] = len;
+        s_night_blob_ready = slot;
+        portEXIT_CRITICAL(&s_night_blob_mux);
+        BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] 整晚摘要已生成: %u个epoch, %u字节, 评分%.0f\n",
+                 (unsigned)g_night.epoch_count, (unsigned)len, report.sleep_score);
+    }
+}
 
-        const bool has_valid_epoch = (valid_hr_count > 0) || (valid_rr_count > 0);
-        if (warmup_left > 0) {
-            if (has_valid_epoch) {
-                warmup_left--;
-            }
-            vTaskDelay(period);
-            continue;
-        }
+/* 上传任务：发送待发的整晚摘要；失败且期间没有更新的摘要时放回待发 */
+static void night_summary_upload(void)
+{
+    portENTER_CRITICAL(&s_night_blob_mux);
+    const int slot = s_night_blob_ready;
+    if (slot != NIGHT_BLOB_NONE)
+    {
+        s_night_blob_ready = NIGHT_BLOB_NONE;
+        s_night_blob_sending = slot;
+    }
+    portEXIT_CRITICAL(&s_night_blob_mux);
+    if (slot == NIGHT_BLOB_NONE)
+    {
+        return;
+    }
 
-        if (!has_valid_epoch) {
-            vTaskDelay(period);
-            continue;
-        }
+    const esp_err_t err = http_send_night_summary(s_night_blob[slot], s_night_blob_len[slot]);
 
-        /* 2. 存储epoch数据 */
-        if (g_epoch_count >= MAX_SLEEP_EPOCHS)
-        {
-            memmove(&g_epochs[0], &g_epochs[1], (MAX_SLEEP_EPOCHS - 1) * sizeof(sleep_epoch_t));
-            memmove(&g_stage_results[0], &g_stage_results[1], (MAX_SLEEP_EPOCHS - 1) * sizeof(sleep_stage_result_t));
-            g_epoch_count = MAX_SLEEP_EPOCHS - 1;
-        }
-        g_epochs[g_epoch_count] = epoch;
-        g_epoch_count++;
+    portENTER_CRITICAL(&s_night_blob_mux);
+    s_night_blob_sending = NIGHT_BLOB_NONE;
+    if (err != ESP_OK && s_night_blob_ready == NIGHT_BLOB_NONE)
+    {
+        s_night_blob_ready = slot;
+    }
+    portEXIT_CRITICAL(&s_night_blob_mux);
+}
 
-        /* 3. 入睡状态机 */
-        sleep_stage_t current_stage = SLEEP_STAGE_WAKE;
-        bool is_quiet = (motion_avg < MOTION_SLEEP_MAX) && 
-                        (rr_avg >= RESP_SLEEP_MIN && rr_avg <= RESP_SLEEP_MAX) &&
-                        (rr_avg > 0);  /* 呼吸数据必须有效 */
-        bool is_active = (motion_avg > MOTION_WAKE_THRESH) || (hr_avg > HR_WAKE_THRESH);
-        
-        switch (g_sleep_state)
-        {
-        case SLEEP_MONITORING:
-            /* 记录基线心率 */
-            if (g_baseline_hr < 1.0f && hr_avg > 50.0f)
-            {
-                g_baseline_hr = hr_avg;
-                printf("[睡眠] 基线心率: %.0f bpm\n", g_baseline_hr);
-            }
-            
-            if (is_quiet && !is_active)
-            {
-                /* 开始入睡观察 */
-                g_sleep_state = SLEEP_SETTLING;
-                g_settling_count = 1;
-                printf("[睡眠] 进入观察期 (%lu/%u)\n", (unsigned long)g_settling_count, ONSET_WINDOW_EPOCHS);
-            }
-            break;
-            
-        case SLEEP_SETTLING:
-            if (is_active)
-            {
-                /* 活动太大，重置 */
-                g_sleep_state = SLEEP_MONITORING;
-                g_settling_count = 0;
-                printf("[睡眠] 观察期中断(体动%.1f/心率%.0f)，重新监测\n", motion_avg, hr_avg);
-            }
-            else if (is_quiet)
-            {
-                g_settling_count++;
-                printf("[睡眠] 观察期进行中 (%lu/%u)\n", (unsigned long)g_settling_count, ONSET_WINDOW_EPOCHS);
-                
-                /* 检查是否满足入睡条件 */
-                if (g_settling_count >= ONSET_WINDOW_EPOCHS)
-                {
-                    /* 检查心率是否有下降趋势 */
-                    float hr_drop = g_baseline_hr - hr_avg;
-                    if (hr_drop >= HR_DROP_REQUIRED || hr_avg < 75.0f)
-                    {
-                        g_sleep_state = SLEEP_SLEEPING;
-                        printf("[睡眠] ★ 确认入睡! 心率从%.0f降至%.0f (降%.0f)\n", 
-                               g_baseline_hr, hr_avg, hr_drop);
-                    }
-                    else
-                    {
-                        printf("[睡眠] 体动低但心率未下降(%.0f→%.0f)，继续观察\n", 
-                               g_baseline_hr, hr_avg);
-                        /* 保持在观察期，不重置计数 */
-                    }
-                }
-            }
-            else
-            {
-                /* 不够安静，减少计数 */
-                if (g_settling_count > 0) g_settling_count--;
-                if (g_settling_count == 0)
-                {
-                    g_sleep_state = SLEEP_MONITORING;
-                    printf("[睡眠] 观察期结束，未入睡\n");
-                }
-            }
-            break;
-            
-        case SLEEP_SLEEPING:
-            if (is_active)
-            {
-                /* 醒来了 */
-                g_sleep_state = SLEEP_MONITORING;
-                g_settling_count = 0;
-                g_baseline_hr = hr_avg;  /* 重新设置基线 */
-                printf("[睡眠] ★ 检测到觉醒 (体动%.1f/心率%.0f)\n", motion_avg, hr_avg);
-            }
-            break;
-        }
+/* 一段睡眠结束 */
+static void sleep_session_end(bool skip_newest)
+{
+    baseline_commit_night(skip_newest);
+    night_summary_finish();
+    sleep_quantile_thresholds_init(&g_quantiles);  /* 下一晚重新统计 */
+    (void)checkpoint_store_clear();
+    s_checkpoint_active = false;
+}
 
-        /* 4. 睡眠阶段分析（仅在确认睡眠后） */
-        static uint32_t s_wake_count = 0;  /* 连续WAKE计数器 */
-        
-        if (g_sleep_state == SLEEP_SLEEPING && g_epoch_count >= ONSET_WINDOW_EPOCHS)
-        {
-            size_t thr_count = g_epoch_count;
-            size_t thr_start = 0;
-            if (thr_count > THRESH_WINDOW_EPOCHS) {
-                thr_start = thr_count - THRESH_WINDOW_EPOCHS;
-                thr_count = THRESH_WINDOW_EPOCHS;
-            }
-            sleep_analysis_compute_thresholds(&g_epochs[thr_start], thr_count, &g_thresholds);
-            sleep_analysis_detect_stages(g_epochs, g_epoch_count, &g_thresholds, g_stage_results);
-            current_stage = g_stage_results[g_epoch_count - 1].stage;
-            
-            /* 如果论文算法判定为WAKE，检查是否真的觉醒 */
-            if (current_stage == SLEEP_STAGE_WAKE)
-            {
-                s_wake_count++;
-                
-                if (s_wake_count >= 3)
-                {
-                    /* 连续3次WAKE（1.5分钟），真的觉醒了 */
-                    g_sleep_state = SLEEP_MONITORING;
-                    g_settling_count = 0;
-                    g_baseline_hr = hr_avg;
-                    s_wake_count = 0;
-                    printf("[睡眠] ★ 算法检测到觉醒\n");
-                }
-                else
-                {
-                    /* 可能是短暂微觉醒，保持睡眠状态，标记为浅睡 */
-                    current_stage = SLEEP_STAGE_NREM;
-                    printf("[睡眠] 微觉醒信号 (%lu/3)，继续监测\n", (unsigned long)s_wake_count);
-                }
-            }
-            else
-            {
-                /* 非WAKE，重置觉醒计数 */
-                s_wake_count = 0;
-            }
-        }
-        else
-        {
-            s_wake_count = 0;  /* 未在睡眠状态，重置计数 */
-            /* 未入睡，全部标记为清醒 */
-            for (size_t i = 0; i < g_epoch_count; ++i)
-            {
-                g_stage_results[i].stage = SLEEP_STAGE_WAKE;
-                g_stage_results[i].respiratory_rate_bpm = g_epochs[i].respiratory_rate_bpm;
-                g_stage_results[i].motion_index = g_epochs[i].motion_index;
-                g_stage_results[i].heart_rate_mean = g_epochs[i].heart_rate_mean;
-                g_stage_results[i].heart_rate_std = g_epochs[i].heart_rate_std;
-            }
-        }
+/* 写入断点：状态机 + 新增epoch + 整晚累加器 */
+static void checkpoint_save(void)
+{
+    checkpoint_state_t st = {0};
+    st.saved_at = (uint32_t)time(NULL);
+    st.total_epochs = s_epoch_total;
+    st.settling_count = g_settling_count;
+    st.night_epochs = (uint32_t)g_night_epochs;
+    st.wake_count = s_wake_count;
+    st.baseline_hr = g_baseline_hr;
+    st.sleep_state = (uint8_t)g_sleep_state;
 
-        /* 5. 计算睡眠质量报告 */
-        sleep_analysis_build_quality(g_epochs, g_stage_results, g_epoch_count, &g_report);
+    const int64_t t0 = esp_timer_get_time();
+    const esp_err_t err = checkpoint_store_save(&st, g_epochs, g_stage_results, g_epoch_count,
+                                                (g_sleep_state == SLEEP_SLEEPING) ? &g_night : NULL);
+    const uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - t0);
+    s_checkpoint_max_us = (elapsed_us > s_checkpoint_max_us) ? elapsed_us : s_checkpoint_max_us;
+    if (err == ESP_OK)
+    {
+        s_checkpoint_active = true;
+        ESP_LOGI(TAG, "checkpoint saved: %lu epochs, %lu us",
+                 (unsigned long)s_epoch_total, (unsigned long)elapsed_us);
+    }
+}
 
-        if (s_health_queue && g_epoch_count > 0)
-        {
-            const sleep_stage_result_t *last = &g_stage_results[g_epoch_count - 1];
-            health_data_t data = {0};
-            data.heart_rate = (int)(last->heart_rate_mean + 0.5f);
-            data.breathing_rate = (int)(last->respiratory_rate_bpm + 0.5f);
-            snprintf(data.sleep_status, sizeof(data.sleep_status), "%s", stage_to_cloud_str(last->stage));
+/* 开机读取断点；有断点返回 true，待系统时间有效（或等待超时）后由 checkpoint_restore 判断新旧 */
+static bool checkpoint_restore_load(void)
+{
+    s_restore_count = 0;
+    return checkpoint_store_load(&s_restore_st, g_epochs, g_stage_results, MAX_SLEEP_EPOCHS,
+                                 &s_restore_count, &g_night) == ESP_OK;
+}
 
-            if (data.heart_rate <= 0 && data.breathing_rate <= 0)
-            {
-                vTaskDelay(period);
-                continue;
-            }
+/*
+ * 接续已读取的断点；成功返回 true，调用方跳过暖机。
+ * 软件复位/看门狗复位后系统时间通常仍有效；掉电复位需等 NTP 校时，
+ * 调用方最多等 CHECKPOINT_TIME_WAIT_MS，时间仍无效则按过期丢弃。
+ */
+static bool checkpoint_restore(void)
+{
+    const checkpoint_state_t st = s_restore_st;
+    const size_t count = s_restore_count;
+    const uint32_t now = (uint32_t)time(NULL);
+    if (!rtc_time_is_valid() || now < st.saved_at || now - st.saved_at > CHECKPOINT_MAX_AGE_S ||
+        st.sleep_state > SLEEP_SLEEPING)
+    {
+        ESP_LOGI(TAG, "checkpoint stale, ignored");
+        (void)checkpoint_store_clear();
+        return false;
+    }
 
-            if (xQueueSend(s_health_queue, &data, 0) != pdTRUE)
-            {
-                health_data_t dropped = {0};
-                (void)xQueueReceive(s_health_queue, &dropped, 0);
-                (void)xQueueSend(s_health_queue, &data, 0);
-            }
-        }
+    s_checkpoint_active = true;
+    g_epoch_count = count;
+    s_epoch_total = st.total_epochs;
+    g_sleep_state = (sleep_state_t)st.sleep_state;
+    g_settling_count = st.settling_count;
+    g_night_epochs = st.night_epochs;
+    s_wake_count = st.wake_count;
+    g_baseline_hr = st.baseline_hr;
+    memset(g_epoch_features, 0, sizeof(g_epoch_features));   /* 扩展特征不入断点 */
+    for (size_t i = 0; i < count; ++i)
+    {
+        sleep_quantile_thresholds_add_epoch(&g_quantiles, &g_epochs[i]);
+    }
+    if (g_sleep_state == SLEEP_SLEEPING && !st.has_night)
+    {
+        sleep_night_begin(&g_night, st.saved_at);
+    }
 
-        /* 6. 输出睡眠状态 */
-        const char *state_str = (g_sleep_state == SLEEP_MONITORING) ? "监测中" :
-                                (g_sleep_state == SLEEP_SETTLING) ? "观察期" : "睡眠中";
-        
-        printf("\n╔════════════════════════════════════════╗\n");
-        printf("║           睡眠监测报告                  ║\n");
-        printf("╠════════════════════════════════════════╣\n");
-        printf("║ 监测状态: %-28s ║\n", state_str);
-        printf("║ 睡眠阶段: %-28s ║\n", stage_to_str(current_stage));
-        printf("║ 呼吸频率: %-3d 次/分                     ║\n", (int)(rr_avg + 0.5f));
-        printf("║ 心率:     %-3d bpm                       ║\n", (int)(hr_avg + 0.5f));
-        printf("║ 体动指数: %-5.1f                         ║\n", motion_avg);
-        printf("╠════════════════════════════════════════╣\n");
-        
-        if (g_sleep_state == SLEEP_SLEEPING)
-        {
-            printf("║ 睡眠评分: %-5.1f (%s)                 ║\n", 
-                   g_report.sleep_score, quality_to_str(g_report.sleep_score));
-            printf("║ 睡眠效率: %-5.1f%%                       ║\n", g_report.sleep_efficiency * 100.0f);
-            printf("║ REM占比:  %-5.1f%%                       ║\n", g_report.rem_ratio * 100.0f);
-            printf("║ 深睡时长: %-4lu 秒                      ║\n", (unsigned long)g_report.nrem_seconds);
-            printf("║ 平均心率: %-5.1f bpm                    ║\n", g_report.average_heart_rate);
-        }
-        else if (g_sleep_state == SLEEP_SETTLING)
-        {
-            printf("║ 入睡观察: %lu/%u (%.1f分钟)             ║\n",
-                   (unsigned long)g_settling_count, ONSET_WINDOW_EPOCHS, g_settling_count * 0.5f);
-        }
-        else
-        {
-            printf("║ [等待入睡信号...]                       ║\n");
-        }
-        printf("╚════════════════════════════════════════╝\n");
+    BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] 从断点恢复: %u 个epoch，状态%u，%lu 秒前\n",
+             (unsigned)count, (unsigned)st.sleep_state, (unsigned long)(now - st.saved_at));
+    return true;
+}
 
-        vTaskDelay(period);
+void app_controller_set_threshold_mode(app_threshold_mode_t mode)
+{
+    if (mode == APP_THRESHOLD_MEAN_STD || mode == APP_THRESHOLD_QUANTILE)
+    {
+        s_threshold_mode = mode;
+        ESP_LOGI(TAG, "threshold mode -> %s", (mode == APP_THRESHOLD_QUANTILE) ? "quantile" : "mean+std");
     }
 }
 
-static void uart_rx_task(void *pvParameters)
+app_threshold_mode_t app_controller_get_threshold_mode(void)
 {
-    uint8_t rx_buf[128] = {0};
-    uint16_t len = 0;
+    return s_threshold_mode;
+}
 
-    /* 发送开启心率监测指令 */
-    uint8_t tx_buf[32];
-    uint16_t tx_len = sizeof(tx_buf);
-    if (protocol_pack_heart_rate_switch(1, tx_buf, &tx_len) == 0)
+void app_controller_set_stage_classifier(app_stage_classifier_t classifier)
+{
+    if (classifier == APP_CLASSIFIER_RULES || classifier == APP_CLASSIFIER_TREE)
     {
-        uart_write_bytes(USART_UX, (const char *)tx_buf, tx_len);
-        printf("已发送心率使能命令\n");
+        s_stage_classifier = classifier;
+        ESP_LOGI(TAG, "stage classifier -> %s", (classifier == APP_CLASSIFIER_TREE) ? "tree" : "rules");
     }
-    
-    /* 体动查询定时器 (每3秒查询一次) */
-    TickType_t last_motion_query = xTaskGetTickCount();
-    const TickType_t motion_query_period = pdMS_TO_TICKS(3000);
-
-    while (1)
-    {
-        /* 定时发送体动参数查询 */
-        if ((xTaskGetTickCount() - last_motion_query) >= motion_query_period)
-        {
-            tx_len = sizeof(tx_buf);
-            if (protocol_pack_motion_query(tx_buf, &tx_len) == 0)
-            {
-                uart_write_bytes(USART_UX, (const char *)tx_buf, tx_len);
-            }
-            last_motion_query = xTaskGetTickCount();
-        }
-
-        uart_get_buffered_data_len(USART_UX, (size_t *)&len);
+}
 
-        if (len > 0)
-        {
-            int rx_len = uart_read_bytes(USART_UX, rx_buf, (len > sizeof(rx_buf) ? sizeof(rx_buf) : len), 100);
-            if (rx_len > 0)
-            {
-                uint8_t ctrl, cmd;
-                uint8_t *data_ptr;
-                uint16_t data_len;
+app_stage_classifier_t app_controller_get_stage_classifier(void)
+{
+    return s_stage_classifier;
+}
 
-                int parse_res = protocol_parse_frame(rx_buf, rx_len, &ctrl, &cmd, &data_ptr, &data_len);
+static void classifier_cost_update(app_stage_classifier_t c, int64_t elapsed_us, size_t n)
+{
+    const float per_epoch = (float)elapsed_us / (float)n;
+    s_classify_cost_us[c] = (s_classify_cost_us[c] == 0.0f)
+                          ? per_epoch
+                          : s_classify_cost_us[c] + 0.2f * (per_epoch - s_classify_cost_us[c]);
+}
 
-                if (parse_res == 0)
-                {
-                    /* 
-                     * 只处理三种数据：心率、呼吸、体动
-                     * 其他帧静默忽略
-                     */
-                    
-                    /* 心率上报: 5359 85 02 0001 1B [心率] sum 5443 */
-                    if (ctrl == CTRL_HEART_RATE && cmd == CMD_HEART_RATE_REPORT)
-                    {
-                        /* 数据格式: 1B + 心率值 */
-                        if (data_len >= 1)
-                        {
-                            /* 检查是否有0x1B前缀 */
-                            uint8_t heart_rate = (data_len == 2 && data_ptr[0] == DATA_REPORT) 
-                                                 ? data_ptr[1] : data_ptr[0];
-                            if (heart_rate >= 60 && heart_rate <= 120)
-                            {
-                                g_heart_rate = heart_rate;
-                                printf("心率: %d bpm\n", heart_rate);
-                            }
-                        }
-                    }
-                    /* 呼吸上报: 5359 81 02 0001 1B [呼吸] sum 5443 */
-                    else if (ctrl == CTRL_BREATH && cmd == CMD_BREATH_VALUE)
-                    {
-                        if (data_len >= 1)
-                        {
-                            uint8_t breath = (data_len == 2 && data_ptr[0] == DATA_REPORT) 
-                                             ? data_ptr[1] : data_ptr[0];
-                            if (breath <= 35)
-                            {
-                                g_breathing_rate = breath;
-                                if (breath > 0)
-                                {
-                                    printf("呼吸频率: %d 次/分\n", breath);
-                                }
-                            }
-                        }
-                    }
-                    /* 体动回复: 5359 80 83 0001 1B [体动] sum 5443 */
-                    else if (ctrl == CTRL_HUMAN_PRESENCE && cmd == CMD_BODY_MOVEMENT)
-                    {
-                        if (data_len >= 1)
-                        {
-                            uint8_t movement = (data_len == 2 && data_ptr[0] == DATA_REPORT) 
-                                               ? data_ptr[1] : data_ptr[0];
-                            if (movement <= 100)
-                            {
-                                g_motion_index = (float)movement;
-                                printf("体动参数: %d\n", movement);
-                                const uint8_t hr = (g_heart_rate >= 60 && g_heart_rate <= 120) ? (uint8_t)g_heart_rate : 0;
-                                const uint8_t rr = (g_breathing_rate > 0 && g_breathing_rate <= 35) ? (uint8_t)g_breathing_rate : 0;
-                                radar_sample_push(hr, rr, movement);
-                            }
-                        }
-                    }
-                    /* 其他帧静默忽略，不打印 */
-                }
-                /* 解析失败也静默忽略 */
-            }
-        }
+/* 用当前分类器对全部epoch分期 */
+static void stage_detect_run(void)
+{
+    const app_stage_classifier_t sel = s_stage_classifier;
+    const int64_t t0 = esp_timer_get_time();
+    s_stage_detectors[sel](g_epochs, g_epoch_count, &g_thresholds, g_stage_results);
+    classifier_cost_update(sel, esp_timer_get_time() - t0, g_epoch_count);
+}
 
-        vTaskDelay(pdMS_TO_TICKS(20));
+/* 每 CLASSIFIER_SHADOW_PERIOD 次分期，用另一分类器跑最近一段，仅计耗时，不影响结果 */
+static void stage_detect_shadow(void)
+{
+    if ((s_classify_runs++ % CLASSIFIER_SHADOW_PERIOD) != 0)
+    {
+        return;
     }
+    const app_stage_classifier_t other = (s_stage_classifier == APP_CLASSIFIER_TREE)
+                                       ? APP_CLASSIFIER_RULES : APP_CLASSIFIER_TREE;
+    const size_t n = (g_epoch_count < CLASSIFIER_SHADOW_EPOCHS) ? g_epoch_count : CLASSIFIER_SHADOW_EPOCHS;
+    const int64_t t0 = esp_timer_get_time();
+    s_stage_detectors[other](&g_epochs[g_epoch_count - n], n, &g_thresholds, s_shadow_results);
+    classifier_cost_update(other, esp_timer_get_time() - t0, n);
 }
 
-esp_err_t app_controller_start(void)
+/* 发布实时状态快照（仅分期任务调用），其他任务经 app_state_read/app_state_wait 读取 */
+static void live_state_publish(sleep_stage_t stage, float hr, float rr, float motion, uint32_t arousals)
 {
-    if (s_started)
+    app_live_state_t live = {0};
+    live.timestamp = (uint32_t)time(NULL);
+    live.phase = (app_sleep_phase_t)g_sleep_state;   /* 两个枚举顺序一致 */
+    live.stage = stage;
+    portENTER_CRITICAL(&s_radar_sample_mux);
+    live.radar_stage = s_radar_sleep_state;
+    portEXIT_CRITICAL(&s_radar_sample_mux);
+    live.presence = s_presence;
+    live.heart_rate = hr;
+    live.breathing_rate = rr;
+    live.motion_index = motion;
+    live.epoch_arousals = arousals;
+    live.settling_epochs = g_settling_count;
+    live.night_epochs = (uint32_t)g_night_epochs;
+    live.report = g_report;
+    app_state_publish(&live);
+}
+
+/* 新 epoch 先落 SD 日志再进内存批；日志不可用时仅内存批（满则丢最旧） */
+static void upload_enqueue(const health_data_t *data)
+{
+    /* 写失败后日志另起新段，重试一次 */
+    if (upload_journal_ready() && upload_journal_append(data) != ESP_OK &&
+        (!upload_journal_ready() || upload_journal_append(data) != ESP_OK))
+    {
+        ESP_LOGW(TAG, "upload journal append failed");
+    }
+    upload_batch_push(&s_upload_batch, data, (uint32_t)(esp_timer_get_time() / 1000000));
+}
+
+/* 取出队列中的 epoch，block 为首条的等待时间 */
+static void upload_receive(TickType_t block)
+{
+    health_data_t data = {0};
+    while (xQueueReceive(s_health_queue, &data, block) == pdTRUE)
+    {
+        block = 0;
+        if (data.heart_rate > 0 || data.breathing_rate > 0)
+        {
+            upload_enqueue(&data);
+        }
+    }
+}
+
+static uint32_t upload_pending(void)
+{
+    return upload_journal_ready() ? upload_journal_pending() : (uint32_t)s_upload_batch.count;
+}
+
+/* 服务器确认前 accepted 条：日志推进游标，内存批只保留仍未确认的最新部分 */
+static void upload_consume(size_t accepted)
+{
+    if (!upload_journal_ready())
+    {
+        upload_batch_consume(&s_upload_batch, accepted);
+        return;
+    }
+    if (upload_journal_ack(accepted) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "upload journal cursor commit failed");
+    }
+    const uint32_t pending = upload_journal_pending();
+    if (s_upload_batch.count > pending)
+    {
+        upload_batch_consume(&s_upload_batch, s_upload_batch.count - pending);
+    }
+}
+
+/* 按刷写策略发送待发 epoch；服务器只确认前缀时其余留待下次。
+ * 日志中积压（断网、重启）时连续整批发出直到清空，期间照常收取新 epoch。 */
+static void upload_batch_flush(void)
+{
+    /* 入睡后随批附带当晚质量报告，服务器可直接展示而不必等整晚摘要 */
+    app_live_state_t live;
+    (void)app_state_read(&live);
+    const sleep_quality_report_t *report = (live.phase == APP_PHASE_SLEEPING) ? &live.report : NULL;
+
+    while (upload_pending() > 0)
+    {
+        const health_data_t *items = s_upload_batch.items;
+        size_t n = (s_upload_batch.count < s_upload_send_max) ? s_upload_batch.count : s_upload_send_max;
+        if (upload_journal_ready())
+        {
+            items = s_upload_send;
+            n = upload_journal_read(s_upload_send, s_upload_send_max);
+            if (n == 0)
+            {
+                continue;   /* 只跳过了损坏帧 */
+            }
+        }
+        size_t accepted = 0;
+        esp_err_t err;
+        if (s_upload_batch_supported)
+        {
+            err = http_send_health_batch(items, n, report, &accepted);
+        }
+        else
+        {
+            /* 服务器无批量接口：逐条发送 */
+            n = 1;
+            err = http_send_health_data(&items[0]);
+            accepted = (err == ESP_OK) ? 1U : 0U;
+        }
+        task_stack_mark(APP_TASK_UPLOAD);
+
+        if (err == ESP_ERR_NOT_SUPPORTED)
+        {
+            ESP_LOGW(TAG, "batch upload not supported by server, falling back to single uploads");
+            s_upload_batch_supported = false;
+            continue;
+        }
+        if (err == ESP_ERR_INVALID_SIZE && n > 1)
+        {
+            s_upload_send_max = (uint16_t)(n / 2U);
+            continue;
+        }
+
+        upload_consume(accepted);
+        s_upload_requests++;
+        s_upload_items_sent += accepted;
+        if (err != ESP_OK || accepted == 0)
+        {
+            /* 失败退避：10s 起翻倍，最长 UPLOAD_RETRY_MAX_MS，期间继续攒数据 */
+            s_upload_retry_ms = (s_upload_retry_ms == 0) ? UPLOAD_RETRY_MIN_MS :
+                                (s_upload_retry_ms * 2U > UPLOAD_RETRY_MAX_MS) ? UPLOAD_RETRY_MAX_MS : s_upload_retry_ms * 2U;
+            s_upload_retry_at_us = esp_timer_get_time() + (int64_t)s_upload_retry_ms * 1000;
+            return;
+        }
+        s_upload_retry_ms = 0;
+        upload_receive(0);
+    }
+}
+
+static void upload_data_task(void *pvParameters)
+{
+    upload_batch_init(&s_upload_batch);
+    if (upload_journal_init() != ESP_OK)
+    {
+        ESP_LOGW(TAG, "upload journal unavailable, outage buffer limited to %u epochs", (unsigned)UPLOAD_BATCH_CAPACITY);
+    }
+
+    while (1)
+    {
+        if (!s_health_queue)
+        {
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            continue;
+        }
+
+        const int64_t now_us = esp_timer_get_time();
+        const bool backoff = now_us < s_upload_retry_at_us;
+
+        if (!backoff)
+        {
+            night_summary_upload();
+        }
+
+        /* 先取切换标记再取队列：标记置位时对应的 epoch 已入队，会一并发出 */
+        if (s_upload_transition)
+        {
+            s_upload_transition = false;
+            upload_batch_mark_transition(&s_upload_batch);
+        }
+
+        /* 无人时分期任务不再入队，拉长阻塞时间减少空转；离床前的残余数据照常发出 */
+        const uint32_t pending = upload_pending();
+        const TickType_t wait = (s_presence == APP_PRESENCE_EMPTY && pending == 0) ?
+                                pdMS_TO_TICKS(PRESENCE_HEARTBEAT_MS) : pdMS_TO_TICKS(1000);
+        upload_receive(wait);
+
+        /* 日志中有比内存批更早的积压（断网恢复、重启后）时不等策略，立即补传 */
+        const bool backlog = upload_journal_ready() && upload_journal_pending() > s_upload_batch.count;
+        if (esp_timer_get_time() < s_upload_retry_at_us ||
+            (!backlog && !upload_batch_due(&s_upload_batch, &s_upload_policy, (uint32_t)(esp_timer_get_time() / 1000000))))
+        {
+            continue;
+        }
+        if (s_upload_batch.count > 0)
+        {
+            printf("正在上传数据 - 待发 %lu 个epoch，最新 心率:%d 呼吸:%d 阶段:%s\n", (unsigned long)upload_pending(),
+                   s_upload_batch.items[s_upload_batch.count - 1].heart_rate,
+                   s_upload_batch.items[s_upload_batch.count - 1].breathing_rate,
+                   s_upload_batch.items[s_upload_batch.count - 1].sleep_status);
+        }
+        else
+        {
+            printf("正在补传积压数据 - %lu 个epoch\n", (unsigned long)upload_pending());
+        }
+        upload_batch_flush();
+    }
+}
+
+void app_controller_set_upload_policy(const upload_flush_policy_t *policy)
+{
+    if (policy && policy->max_items > 0)
+    {
+        s_upload_policy = *policy;
+        if (s_upload_policy.max_items > UPLOAD_BATCH_CAPACITY)
+        {
+            s_upload_policy.max_items = UPLOAD_BATCH_CAPACITY;
+        }
+    }
+}
+
+/*
+ * 分期任务启动：特征/融合/分位数初始化并读取断点。
+ * 返回 true 表示读到断点，调用方在系统时间有效或等待超时后调用 sleep_stage_resume，之前不关 epoch。
+ */
+static bool sleep_stage_begin(void)
+{
+    sleep_features_init(&g_feature_state);
+    sleep_fusion_reset(&g_fusion);
+    sleep_quantile_thresholds_init(&g_quantiles);
+    
+    BINLOG_I(BINLOG_MOD_SLEEP, "\n========== 睡眠监测已启动 ==========\n");
+    BINLOG_I(BINLOG_MOD_SLEEP, "入睡判定条件: 连续%u分钟低体动(<%.0f) + 心率下降\n", 
+             ONSET_WINDOW_EPOCHS / 2, MOTION_SLEEP_MAX);
+    return checkpoint_restore_load();
+}
+
+/* 夜间重启：断点新鲜则直接接续分期，不再暖机和重走入睡观察 */
+static void sleep_stage_resume(void)
+{
+    if (checkpoint_restore())
+    {
+        s_warmup_left = 0;
+    }
+}
+
+/* 关闭一个epoch：取样、聚合、分期、上报与输出，每 EPOCH_MS 调用一次 */
+static void sleep_stage_step(void)
+{
+    /* 无人：跳过分期与上传；短暂离床保留睡眠会话，超时才结束 */
+    if (s_presence == APP_PRESENCE_EMPTY)
+    {
+        s_epochs_skipped++;
+        if (g_sleep_state == SLEEP_SLEEPING && presence_empty_for_s() >= PRESENCE_END_SESSION_S)
+        {
+            sleep_session_end(false);
+            g_baseline_hr = 0.0f;
+            BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] ★ 离床超过%u分钟，结束本次睡眠\n", PRESENCE_END_SESSION_S / 60U);
+        }
+        if (g_sleep_state != SLEEP_SLEEPING)
+        {
+            g_sleep_state = SLEEP_MONITORING;
+            g_settling_count = 0;
+        }
+        s_warmup_left = SENSOR_WARMUP_EPOCHS;
+        live_state_publish(SLEEP_STAGE_UNKNOWN, 0.0f, 0.0f, 0.0f, 0U);
+        return;
+    }
+
+    /* 取走上个epoch以来的全部采样，数量随轮询周期在约5到30之间变化 */
+    static radar_sample_t samples[RADAR_RING_SAMPLES];   /* 512B，放静态区避免占用任务栈 */
+    portENTER_CRITICAL(&s_radar_sample_mux);
+    const uint32_t epoch_arousals = s_epoch_arousals;
+    s_epoch_arousals = 0;
+    const size_t copied = s_radar_sample_count;
+    for (size_t i = 0; i < copied; ++i) {
+        const size_t idx = (s_radar_sample_head + RADAR_RING_SAMPLES - copied + i) % RADAR_RING_SAMPLES;
+        samples[i] = s_radar_sample_ring[idx];
+    }
+    s_radar_sample_count = 0;
+    portEXIT_CRITICAL(&s_radar_sample_mux);
+
+    if (copied < RADAR_MIN_SAMPLES_PER_EPOCH) {
+        return;
+    }
+
+    /* 频谱特征与体动峰值按 3s 网格重采样，与固定轮询时的量纲/阈值保持一致 */
+    radar_sample_t uniform[RADAR_SAMPLES_PER_EPOCH];
+    (void)sleep_features_resample(samples, copied, SLEEP_FEATURE_PERIOD_S, uniform, RADAR_SAMPLES_PER_EPOCH);
+
+    size_t valid_rr_count = 0;
+    size_t valid_hr_count = 0;
+    float motion_sum = 0.0f;
+    float motion_max = 0.0f;
+    for (size_t i = 0; i < copied; ++i) {
+        const uint8_t rr = samples[i].respiratory_rate_bpm;
+        const uint8_t hr = samples[i].heart_rate_bpm;
+        if (rr > 0 && rr <= 35) valid_rr_count++;
+        if (hr >= 60 && hr <= 120) valid_hr_count++;
+        motion_sum += (float)samples[i].motion_level;
+    }
+    for (size_t i = 0; i < RADAR_SAMPLES_PER_EPOCH; ++i) {
+        const float mv = (float)uniform[i].motion_level;
+        if (mv > motion_max) motion_max = mv;
+    }
+    const float motion_avg = motion_sum / (float)copied;
+
+    sleep_epoch_t epoch = {0};
+#if EPOCH_FIXED_POINT
+    sleep_epoch_fixed_t epoch_q = {0};
+    const size_t epoch_n = (size_t)sleep_epoch_fixed_aggregate(samples, (uint32_t)copied, &epoch_q);
+    sleep_epoch_fixed_to_float(&epoch_q, &epoch);
+#else
+    /* 浮点参考路径每epoch固定 SAMPLES_PER_EPOCH 个采样，使用重采样序列 */
+    const size_t epoch_n = sleep_analysis_aggregate_samples(uniform, RADAR_SAMPLES_PER_EPOCH, &epoch, 1);
+#endif
+    if (epoch_n == 0) {
+        return;
+    }
+    if (valid_rr_count == 0) {
+        epoch.respiratory_rate_bpm = 0.0f;
+    }
+    if (valid_hr_count == 0) {
+        epoch.heart_rate_mean = 0.0f;
+        epoch.heart_rate_std = 0.0f;
+    }
+
+    epoch.motion_index = motion_max;
+
+    const float hr_avg = epoch.heart_rate_mean;
+    const float rr_avg = epoch.respiratory_rate_bpm;
+
+    /* 扩展特征（呼吸变异、HR/RR频段功率、体动突发），暖机期也要喂入以填满频谱滑窗 */
+    sleep_epoch_features_t features;
+    sleep_features_extract(&g_feature_state, uniform, RADAR_SAMPLES_PER_EPOCH, &features);
+
+    const bool has_valid_epoch = (valid_hr_count > 0) || (valid_rr_count > 0);
+    if (s_warmup_left > 0) {
+        if (has_valid_epoch) {
+            s_warmup_left--;
+        }
+        return;
+    }
+
+    if (!has_valid_epoch) {
+        return;
+    }
+
+    /* 2. 存储epoch数据 */
+    if (g_epoch_count >= MAX_SLEEP_EPOCHS)
+    {
+        memmove(&g_epochs[0], &g_epochs[1], (MAX_SLEEP_EPOCHS - 1) * sizeof(sleep_epoch_t));
+        memmove(&g_stage_results[0], &g_stage_results[1], (MAX_SLEEP_EPOCHS - 1) * sizeof(sleep_stage_result_t));
+        memmove(&g_epoch_features[0], &g_epoch_features[1], (MAX_SLEEP_EPOCHS - 1) * sizeof(sleep_epoch_features_t));
+        g_epoch_count = MAX_SLEEP_EPOCHS - 1;
+    }
+    g_epochs[g_epoch_count] = epoch;
+    g_epoch_features[g_epoch_count] = features;
+    g_epoch_count++;
+    s_epoch_total++;
+    sleep_quantile_thresholds_add_epoch(&g_quantiles, &epoch);
+
+    /* 3. 入睡状态机 */
+    sleep_stage_t current_stage = SLEEP_STAGE_WAKE;
+    bool is_quiet = (motion_avg < MOTION_SLEEP_MAX) && 
+                    (rr_avg >= RESP_SLEEP_MIN && rr_avg <= RESP_SLEEP_MAX) &&
+                    (rr_avg > 0);  /* 呼吸数据必须有效 */
+    bool is_active = (motion_avg > MOTION_WAKE_THRESH) || (hr_avg > HR_WAKE_THRESH);
+    
+    switch (g_sleep_state)
+    {
+    case SLEEP_MONITORING:
+        /* 记录基线心率 */
+        if (g_baseline_hr < 1.0f && hr_avg > 50.0f)
+        {
+            g_baseline_hr = hr_avg;
+            BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] 基线心率: %.0f bpm\n", g_baseline_hr);
+        }
+        
+        if (is_quiet && !is_active)
+        {
+            /* 开始入睡观察 */
+            g_sleep_state = SLEEP_SETTLING;
+            g_settling_count = 1;
+            BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] 进入观察期 (%lu/%u)\n", (unsigned long)g_settling_count, ONSET_WINDOW_EPOCHS);
+        }
+        break;
+        
+    case SLEEP_SETTLING:
+        if (is_active)
+        {
+            /* 活动太大，重置 */
+            g_sleep_state = SLEEP_MONITORING;
+            g_settling_count = 0;
+            BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] 观察期中断(体动%.1f/心率%.0f)，重新监测\n", motion_avg, hr_avg);
+        }
+        else if (is_quiet)
+        {
+            g_settling_count++;
+            BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] 观察期进行中 (%lu/%u)\n", (unsigned long)g_settling_count, ONSET_WINDOW_EPOCHS);
+            
+            /* 检查是否满足入睡条件 */
+            if (g_settling_count >= ONSET_WINDOW_EPOCHS)
+            {
+                /* 检查心率是否有下降趋势 */
+                float hr_drop = g_baseline_hr - hr_avg;
+                if (hr_drop >= HR_DROP_REQUIRED || hr_avg < 75.0f)
+                {
+                    g_sleep_state = SLEEP_SLEEPING;
+                    g_night_epochs = 0;
+                    sleep_night_begin(&g_night, (uint32_t)time(NULL));
+                    sleep_fusion_reset(&g_fusion);
+                    BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] ★ 确认入睡! 心率从%.0f降至%.0f (降%.0f)\n", 
+                             g_baseline_hr, hr_avg, hr_drop);
+                }
+                else
+                {
+                    BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] 体动低但心率未下降(%.0f→%.0f)，继续观察\n", 
+                             g_baseline_hr, hr_avg);
+                    /* 保持在观察期，不重置计数 */
+                }
+            }
+        }
+        else
+        {
+            /* 不够安静，减少计数 */
+            if (g_settling_count > 0) g_settling_count--;
+            if (g_settling_count == 0)
+            {
+                g_sleep_state = SLEEP_MONITORING;
+                BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] 观察期结束，未入睡\n");
+            }
+        }
+        break;
+        
+    case SLEEP_SLEEPING:
+        if (is_active)
+        {
+            /* 醒来了：本epoch尚未计入g_night_epochs */
+            sleep_session_end(true);
+            g_sleep_state = SLEEP_MONITORING;
+            g_settling_count = 0;
+            g_baseline_hr = hr_avg;  /* 重新设置基线 */
+            BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] ★ 检测到觉醒 (体动%.1f/心率%.0f)\n", motion_avg, hr_avg);
+        }
+        break;
+    }
+
+    if (g_sleep_state == SLEEP_SLEEPING)
+    {
+        g_night_epochs++;
+    }
+
+    /* 4. 睡眠阶段分析（仅在确认睡眠后） */
+    
+    if (g_sleep_state == SLEEP_SLEEPING && g_epoch_count >= ONSET_WINDOW_EPOCHS)
+    {
+        const uint32_t now_s = (uint32_t)time(NULL);
+        portENTER_CRITICAL(&s_radar_sample_mux);
+        sleep_fusion_update_radar(&g_fusion, s_radar_sleep_state, s_radar_sleep_ts);
+        portEXIT_CRITICAL(&s_radar_sample_mux);
+
+        if (!RADAR_FUSION_ENABLE || sleep_fusion_need_local(&g_fusion, now_s))
+        {
+            const int64_t t0 = esp_timer_get_time();
+            size_t thr_count = g_epoch_count;
+            size_t thr_start = 0;
+            if (thr_count > THRESH_WINDOW_EPOCHS) {
+                thr_start = thr_count - THRESH_WINDOW_EPOCHS;
+                thr_count = THRESH_WINDOW_EPOCHS;
+            }
+            /* 分位数模式：整晚流式分位数；数据不足时与均值模式一样用基线预置阈值 */
+            if (s_threshold_mode != APP_THRESHOLD_QUANTILE ||
+                !sleep_quantile_thresholds_get(&g_quantiles, &g_thresholds))
+            {
+                /* 个人基线预置阈值，当晚数据按入睡以来的时长以指数衰减权重逐步融入 */
+                sleep_analysis_compute_thresholds_seeded(&g_epochs[thr_start], thr_count, g_night_epochs,
+                                                         &g_user_baseline, &g_thresholds);
+            }
+            stage_detect_run();
+            current_stage = g_stage_results[g_epoch_count - 1].stage;
+            sleep_fusion_record_local(&g_fusion, current_stage, (uint32_t)(esp_timer_get_time() - t0), now_s);
+            stage_detect_shadow();
+        }
+        else
+        {
+            /* 融合卸载：直接采用雷达片上分期，跳过阈值计算与全序列分期 */
+            current_stage = sleep_fusion_take_radar_stage(&g_fusion);
+            sleep_stage_result_t *res = &g_stage_results[g_epoch_count - 1];
+            res->stage = current_stage;
+            res->respiratory_rate_bpm = epoch.respiratory_rate_bpm;
+            res->motion_index = epoch.motion_index;
+            res->heart_rate_mean = epoch.heart_rate_mean;
+            res->heart_rate_std = epoch.heart_rate_std;
+        }
+        
+        /* 如果论文算法判定为WAKE，检查是否真的觉醒 */
+        if (current_stage == SLEEP_STAGE_WAKE)
+        {
+            s_wake_count++;
+            
+            if (s_wake_count >= 3 || epoch_arousals >= AROUSAL_FAST_WAKE_EVENTS)
+            {
+                /* 连续3次WAKE（1.5分钟），或本epoch内多次微觉醒，真的觉醒了 */
+                sleep_session_end(false);
+                g_sleep_state = SLEEP_MONITORING;
+                g_settling_count = 0;
+                g_baseline_hr = hr_avg;
+                s_wake_count = 0;
+                BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] ★ 算法检测到觉醒\n");
+            }
+            else
+            {
+                /* 可能是短暂微觉醒，保持睡眠状态，标记为浅睡 */
+                current_stage = SLEEP_STAGE_NREM;
+                alarm_service_report_sleep_signal(ALARM_SLEEP_SIGNAL_AROUSAL);
+                BINLOG_I(BINLOG_MOD_SLEEP, "[睡眠] 微觉醒信号 (%lu/3)，继续监测\n", (unsigned long)s_wake_count);
+            }
+        }
+        else
+        {
+            /* 非WAKE，重置觉醒计数 */
+            s_wake_count = 0;
+        }
+    }
+    else
+    {
+        s_wake_count = 0;  /* 未在睡眠状态，重置计数 */
+        /* 未入睡，全部标记为清醒 */
+        for (size_t i = 0; i < g_epoch_count; ++i)
+        {
+            g_stage_results[i].stage = SLEEP_STAGE_WAKE;
+            g_stage_results[i].respiratory_rate_bpm = g_epochs[i].respiratory_rate_bpm;
+            g_stage_results[i].motion_index = g_epochs[i].motion_index;
+            g_stage_results[i].heart_rate_mean = g_epochs[i].heart_rate_mean;
+            g_stage_results[i].heart_rate_std = g_epochs[i].heart_rate_std;
+        }
+    }
+
+    if (g_sleep_state == SLEEP_SLEEPING)
+    {
+        (void)sleep_night_add_epoch(&g_night, &epoch, current_stage);
+    }
+
+    /* 连续无事件的 NREM 计数，供接收任务降低轮询频率 */
+    if (g_sleep_state == SLEEP_SLEEPING && current_stage == SLEEP_STAGE_NREM &&
+        epoch_arousals == 0 && s_wake_count == 0)
+    {
+        s_stable_nrem_epochs++;
+    }
+    else
+    {
+        s_stable_nrem_epochs = 0;
+    }
+
+    /* 智能唤醒窗口内上报浅睡信号（窗口外调用直接返回）；
+     * 清醒信号只在睡眠后醒来时上报，整晚未入睡或观察期中不算 */
+    if (g_sleep_state == SLEEP_SLEEPING)
+    {
+        s_wake_cue_armed = true;
+        if (current_stage == SLEEP_STAGE_REM)
+        {
+            alarm_service_report_sleep_signal(ALARM_SLEEP_SIGNAL_REM);
+        }
+    }
+    else if (g_sleep_state == SLEEP_SETTLING)
+    {
+        s_wake_cue_armed = false;
+    }
+    else if (s_wake_cue_armed)
+    {
+        alarm_service_report_sleep_signal(ALARM_SLEEP_SIGNAL_WAKE);
+    }
+
+    /* 多分辨率趋势汇总（5分钟/小时/每晚） */
+    (void)sleep_rollup_add_epoch((uint32_t)time(NULL), &epoch, current_stage);
+
+    /* 断点：观察期/睡眠中定期写入，回到监测状态即作废 */
+    if (g_sleep_state != SLEEP_MONITORING)
+    {
+        if (s_epoch_total % CHECKPOINT_PERIOD_EPOCHS == 0U)
+        {
+            checkpoint_save();
+        }
+    }
+    else if (s_checkpoint_active)
+    {
+        (void)checkpoint_store_clear();
+        s_checkpoint_active = false;
+    }
+
+    /* 5. 计算睡眠质量报告 */
+    sleep_analysis_build_quality(g_epochs, g_stage_results, g_epoch_count, &g_report);
+    live_state_publish(current_stage, hr_avg, rr_avg, epoch.motion_index, epoch_arousals);
+
+    if (LIVE_EPOCH_UPLOAD && s_health_queue && g_epoch_count > 0)
+    {
+        const sleep_stage_result_t *last = &g_stage_results[g_epoch_count - 1];
+        health_data_t data = {0};
+        data.heart_rate = (int)(last->heart_rate_mean + 0.5f);
+        data.breathing_rate = (int)(last->respiratory_rate_bpm + 0.5f);
+        snprintf(data.sleep_status, sizeof(data.sleep_status), "%s", stage_to_cloud_str(last->stage));
+        /* 雷达片上分期作为交叉校验通道一并上报 */
+        portENTER_CRITICAL(&s_radar_sample_mux);
+        const uint8_t radar_state = s_radar_sleep_state;
+        portEXIT_CRITICAL(&s_radar_sample_mux);
+        snprintf(data.radar_status, sizeof(data.radar_status), "%s", radar_stage_to_cloud_str(radar_state));
+        data.radar_score = s_radar_sleep_score;
+        data.arousals = (int)epoch_arousals;
+        const time_t now = time(NULL);
+        data.timestamp = rtc_time_is_valid() ? (uint32_t)now : 0U;
+
+        if (data.heart_rate <= 0 && data.breathing_rate <= 0)
+        {
+            return;
+        }
+
+        if (xQueueSend(s_health_queue, &data, 0) != pdTRUE)
+        {
+            health_data_t dropped = {0};
+            (void)xQueueReceive(s_health_queue, &dropped, 0);
+            (void)xQueueSend(s_health_queue, &data, 0);
+        }
+        /* 入睡/醒来：本 epoch 入队后再通知上传任务立即发送 */
+        if (g_sleep_state != s_upload_phase)
+        {
+            s_upload_phase = g_sleep_state;
+            s_upload_transition = true;
+        }
+    }
+
+    /* 6. 输出睡眠状态 */
+    binlog_stats_t log_stats;
+    binlog_get_stats(&log_stats);
+    http_upload_stats_t upload_stats;
+    http_upload_get_stats(&upload_stats);
+    upload_journal_stats_t jnl_stats;
+    upload_journal_get_stats(&jnl_stats);
+    http_alarm_fetch_stats_t alarm_stats;
+    http_alarm_get_fetch_stats(&alarm_stats);
+    net_worker_stats_t net_stats;
+    net_worker_get_stats(&net_stats);
+    const char *state_str = (g_sleep_state == SLEEP_MONITORING) ? "监测中" :
+                            (g_sleep_state == SLEEP_SETTLING) ? "观察期" : "睡眠中";
+    
+    BINLOG_I(BINLOG_MOD_REPORT, "\n╔════════════════════════════════════════╗\n");
+    BINLOG_I(BINLOG_MOD_REPORT, "║           睡眠监测报告                  ║\n");
+    BINLOG_I(BINLOG_MOD_REPORT, "╠════════════════════════════════════════╣\n");
+    BINLOG_I(BINLOG_MOD_REPORT, "║ 监测状态: %-28s ║\n", state_str);
+    BINLOG_I(BINLOG_MOD_REPORT, "║ 睡眠阶段: %-28s ║\n", stage_to_str(current_stage));
+    BINLOG_I(BINLOG_MOD_REPORT, "║ 呼吸频率: %-3d 次/分                     ║\n", (int)(rr_avg + 0.5f));
+    BINLOG_I(BINLOG_MOD_REPORT, "║ 心率:     %-3d bpm                       ║\n", (int)(hr_avg + 0.5f));
+    BINLOG_I(BINLOG_MOD_REPORT, "║ 体动指数: %-5.1f                         ║\n", motion_avg);
+    /* 诊断摘要两行；逐项明细为 DEBUG 级，binlog_set_level(BINLOG_MOD_REPORT, BINLOG_LEVEL_DEBUG) 后输出 */
+    uint32_t stack_min = UINT32_MAX;
+    for (int i = 0; i < APP_TASK_COUNT; ++i)
+    {
+        if (s_task_stack_size[i] > 0 && s_task_stack_free[i] < stack_min)
+        {
+            stack_min = s_task_stack_free[i];
+        }
+    }
+    BINLOG_I(BINLOG_MOD_REPORT, "║ 感知: 采样 %-2u 微觉醒 %lu/%-4lu 特征 %-5lu us 分类 %-5.2f us 融合 %s ║\n",
+             (unsigned)copied, (unsigned long)epoch_arousals, (unsigned long)g_arousal.events,
+             (unsigned long)g_feature_state.last_cost_us, s_classify_cost_us[s_stage_classifier],
+             (RADAR_FUSION_ENABLE && g_fusion.offloaded) ? "卸载" : "本地");
+    BINLOG_I(BINLOG_MOD_REPORT, "║ 系统: 日志丢 %-3lu 上传 %lu/失败 %-3lu 待发 %-4lu 网络失败 %-3lu 闹钟 %s 栈余 %-4lu 循环 %-6lu us ║\n",
+             (unsigned long)log_stats.dropped, (unsigned long)upload_stats.requests,
+             (unsigned long)upload_stats.failures, (unsigned long)jnl_stats.pending, (unsigned long)net_stats.failed,
+             alarm_stats.push_active ? "推送" : "轮询", (unsigned long)((stack_min == UINT32_MAX) ? 0U : stack_min),
+             (unsigned long)s_loop_step_max_us);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 呼吸变异: %-5.2f 体动突发: %-3u          ║\n", features.rr_std, (unsigned)features.motion_bursts);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 微觉醒:   %-3lu (累计 %-5lu)               ║\n",
+             (unsigned long)epoch_arousals, (unsigned long)g_arousal.events);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 特征耗时: %-5lu us (最大 %-5lu us)       ║\n",
+             (unsigned long)g_feature_state.last_cost_us, (unsigned long)g_feature_state.max_cost_us);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 分类器:   %-6s 规则 %-5.2f 树 %-5.2f us/epoch ║\n",
+             (s_stage_classifier == APP_CLASSIFIER_TREE) ? "决策树" : "规则",
+             s_classify_cost_us[APP_CLASSIFIER_RULES], s_classify_cost_us[APP_CLASSIFIER_TREE]);
+    if (RADAR_FUSION_ENABLE)
+    {
+        BINLOG_D(BINLOG_MOD_REPORT, "║ 雷达融合: %-6s 一致 %2lu/%-2u 节省 %-6lu ms ║\n",
+                 g_fusion.offloaded ? "卸载中" : "本地",
+                 (unsigned long)sleep_fusion_agree_count(&g_fusion), SLEEP_FUSION_WINDOW,
+                 (unsigned long)(g_fusion.saved_us / 1000U));
+    }
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 轮询:     本epoch %-2u 采样 1s/3s/6s %lu/%lu/%lu 省 %-5.1f%% ║\n",
+             (unsigned)copied, (unsigned long)s_poll_queries[0], (unsigned long)s_poll_queries[1],
+             (unsigned long)s_poll_queries[2], poll_savings_pct());
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 任务栈:   共 %-5lu B 余 上传%-4lu 分期%-4lu 接收%-4lu 循环%-4lu ║\n",
+             (unsigned long)(s_task_stack_size[APP_TASK_UPLOAD] + s_task_stack_size[APP_TASK_STAGE] +
+                             s_task_stack_size[APP_TASK_UART] + s_task_stack_size[APP_TASK_LOOP]),
+             (unsigned long)s_task_stack_free[APP_TASK_UPLOAD], (unsigned long)s_task_stack_free[APP_TASK_STAGE],
+             (unsigned long)s_task_stack_free[APP_TASK_UART], (unsigned long)s_task_stack_free[APP_TASK_LOOP]);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 循环延迟: 关epoch最长 %-6lu us 断点最长 %-6lu us ║\n",
+             (unsigned long)s_loop_step_max_us, (unsigned long)s_checkpoint_max_us);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 无人门控: 无人 %-6lu 秒 跳过 %-5lu epoch  ║\n",
+             (unsigned long)(presence_empty_us(esp_timer_get_time()) / 1000000), (unsigned long)s_epochs_skipped);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 日志:     写入 %-6lu 丢弃 %-4lu 积压 %-3lu 延迟 %-4lu ms ║\n",
+             (unsigned long)log_stats.written, (unsigned long)log_stats.dropped,
+             (unsigned long)log_stats.max_depth, (unsigned long)log_stats.max_lag_ms);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 上传:     新连 %-4lu 复用 %-5lu 平均 %-4lu ms 堆低 %-6lu ║\n",
+             (unsigned long)upload_stats.new_connections, (unsigned long)upload_stats.reused_connections,
+             (unsigned long)upload_stats.avg_latency_ms, (unsigned long)upload_stats.heap_min_free);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 批量上传: 请求 %-4lu 条 %-5lu 待发 %-2u 丢弃 %-3lu ║\n",
+             (unsigned long)s_upload_requests, (unsigned long)s_upload_items_sent,
+             (unsigned)s_upload_batch.count, (unsigned long)s_upload_batch.dropped);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 上传日志: 待发 %-5lu 段 %-2lu 淘汰 %-4lu 损坏 %-3lu ║\n",
+             (unsigned long)jnl_stats.pending, (unsigned long)jnl_stats.segments,
+             (unsigned long)jnl_stats.evicted, (unsigned long)jnl_stats.corrupt);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 载荷:     %-4s 共 %-8lu B 编码 %-5lu us ║\n",
+             upload_stats.format ? "CBOR" : "JSON", (unsigned long)upload_stats.payload_bytes,
+             (unsigned long)upload_stats.encode_us);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 压缩:     %-4s gzip %-4lu 次 比 %-5.2f %-4lu us/KB ║\n",
+             upload_stats.gzip ? "开" : "关", (unsigned long)upload_stats.gzip_bodies,
+             upload_stats.gzip_out_bytes ? (float)upload_stats.gzip_in_bytes / (float)upload_stats.gzip_out_bytes : 1.0f,
+             upload_stats.gzip_in_bytes ?
+                 (unsigned long)((uint64_t)upload_stats.gzip_us * 1024U / upload_stats.gzip_in_bytes) : 0UL);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 闹钟拉取: %-4lu 次 304 %-4lu 变更 %-3lu 共 %-7lu B ║\n",
+             (unsigned long)alarm_stats.fetches, (unsigned long)alarm_stats.not_modified,
+             (unsigned long)alarm_stats.changed, (unsigned long)alarm_stats.rx_bytes);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 闹钟推送: %-4s 重连 %-4lu 回退 %-3lu 命令 %-3lu ║\n",
+             alarm_stats.push_active ? "长轮询" : "轮询", (unsigned long)alarm_stats.push_reconnects,
+             (unsigned long)alarm_stats.push_fallbacks, (unsigned long)alarm_stats.commands);
+    BINLOG_D(BINLOG_MOD_REPORT, "║ 网络任务: 请求 %-5lu 重试 %-3lu 失败 %-3lu 等待 %-5lu ms 栈余 %-4lu ║\n",
+             (unsigned long)net_stats.submitted, (unsigned long)net_stats.retries, (unsigned long)net_stats.failed,
+             (unsigned long)net_stats.max_wait_ms, (unsigned long)net_stats.stack_free);
+    BINLOG_I(BINLOG_MOD_REPORT, "╠════════════════════════════════════════╣\n");
+    
+    if (g_sleep_state == SLEEP_SLEEPING)
+    {
+        BINLOG_I(BINLOG_MOD_REPORT, "║ 睡眠评分: %-5.1f (%s)                 ║\n", 
+                 g_report.sleep_score, quality_to_str(g_report.sleep_score));
+        BINLOG_I(BINLOG_MOD_REPORT, "║ 睡眠效率: %-5.1f%%                       ║\n", g_report.sleep_efficiency * 100.0f);
+        BINLOG_I(BINLOG_MOD_REPORT, "║ REM占比:  %-5.1f%%                       ║\n", g_report.rem_ratio * 100.0f);
+        BINLOG_I(BINLOG_MOD_REPORT, "║ 深睡时长: %-4lu 秒                      ║\n", (unsigned long)g_report.nrem_seconds);
+        BINLOG_I(BINLOG_MOD_REPORT, "║ 平均心率: %-5.1f bpm                    ║\n", g_report.average_heart_rate);
+    }
+    else if (g_sleep_state == SLEEP_SETTLING)
+    {
+        BINLOG_I(BINLOG_MOD_REPORT, "║ 入睡观察: %lu/%u (%.1f分钟)             ║\n",
+                 (unsigned long)g_settling_count, ONSET_WINDOW_EPOCHS, g_settling_count * 0.5f);
+    }
+    else
+    {
+        BINLOG_I(BINLOG_MOD_REPORT, "║ [等待入睡信号...]                       ║\n");
+    }
+    BINLOG_I(BINLOG_MOD_REPORT, "╚════════════════════════════════════════╝\n");
+
+}
+
+#if !APP_EVENT_LOOP
+static void sleep_stage_task(void *pvParameters)
+{
+    const TickType_t period = pdMS_TO_TICKS(EPOCH_MS);
+
+    if (sleep_stage_begin())
+    {
+        /* 接收在独立任务中，这里可以阻塞等待系统时间 */
+        for (uint32_t waited = 0; !rtc_time_is_valid() && waited < CHECKPOINT_TIME_WAIT_MS; waited += 1000U)
+        {
+            vTaskDelay(pdMS_TO_TICKS(1000));
+        }
+        sleep_stage_resume();
+    }
+    while (1)
+    {
+        sleep_stage_step();
+        task_stack_mark(APP_TASK_STAGE);
+        (void)ulTaskNotifyTake(pdTRUE, period);   /* 有人回床时由接收任务通知立即唤醒 */
+    }
+}
+#endif
+
+/* 处理一帧雷达数据 */
+static void radar_handle_frame(uint8_t ctrl, uint8_t cmd, const uint8_t *data_ptr, uint16_t data_len)
+{
+    /* 心率上报: 5359 85 02 0001 1B [心率] sum 5443 */
+    if (ctrl == CTRL_HEART_RATE && cmd == CMD_HEART_RATE_REPORT)
+    {
+        /* 数据格式: 1B + 心率值 */
+        if (data_len >= 1)
+        {
+            /* 检查是否有0x1B前缀 */
+            uint8_t heart_rate = (data_len == 2 && data_ptr[0] == DATA_REPORT) 
+                                 ? data_ptr[1] : data_ptr[0];
+            if (heart_rate >= 60 && heart_rate <= 120)
+            {
+                g_heart_rate = heart_rate;
+                BINLOG_I(BINLOG_MOD_RADAR, "心率: %d bpm\n", heart_rate);
+            }
+        }
+    }
+    /* 呼吸上报: 5359 81 02 0001 1B [呼吸] sum 5443 */
+    else if (ctrl == CTRL_BREATH && cmd == CMD_BREATH_VALUE)
+    {
+        if (data_len >= 1)
+        {
+            uint8_t breath = (data_len == 2 && data_ptr[0] == DATA_REPORT) 
+                             ? data_ptr[1] : data_ptr[0];
+            if (breath <= 35)
+            {
+                g_breathing_rate = breath;
+                if (breath > 0)
+                {
+                    BINLOG_I(BINLOG_MOD_RADAR, "呼吸频率: %d 次/分\n", breath);
+                }
+            }
+        }
+    }
+    /* 体动回复: 5359 80 83 0001 1B [体动] sum 5443 */
+    else if (ctrl == CTRL_HUMAN_PRESENCE && cmd == CMD_BODY_MOVEMENT)
+    {
+        if (data_len >= 1)
+        {
+            uint8_t movement = (data_len == 2 && data_ptr[0] == DATA_REPORT) 
+                               ? data_ptr[1] : data_ptr[0];
+            if (movement <= 100)
+            {
+                g_motion_index = (float)movement;
+                BINLOG_I(BINLOG_MOD_RADAR, "体动参数: %d\n", movement);
+                const uint8_t hr = (g_heart_rate >= 60 && g_heart_rate <= 120) ? (uint8_t)g_heart_rate : 0;
+                const uint8_t rr = (g_breathing_rate > 0 && g_breathing_rate <= 35) ? (uint8_t)g_breathing_rate : 0;
+                radar_sample_push(hr, rr, movement);
+            }
+        }
+    }
+    /* 存在信息: 5359 80 01 0001 [0无人/1有人] sum 5443（变化时上报），查询回复 80 81 */
+    else if (ctrl == CTRL_HUMAN_PRESENCE && (cmd == CMD_PRESENCE_REPORT || cmd == CMD_PRESENCE_QUERY))
+    {
+        if (data_len >= 1 && data_ptr[data_len - 1] <= PRESENCE_SOMEONE)
+        {
+            presence_set(data_ptr[data_len - 1] == PRESENCE_SOMEONE ? APP_PRESENCE_OCCUPIED : APP_PRESENCE_EMPTY);
+        }
+    }
+    /* 运动信息: 5359 80 02 0001 [0无/1静止/2活跃] sum 5443，查询回复 80 82 */
+    else if (ctrl == CTRL_HUMAN_PRESENCE && (cmd == CMD_MOTION_INFO || cmd == CMD_MOTION_INFO_QUERY))
+    {
+        if (data_len >= 1 && data_ptr[data_len - 1] <= MOTION_INFO_ACTIVE)
+        {
+            s_motion_info = data_ptr[data_len - 1];
+            /* 有运动必然有人，存在上报丢失时也能及时恢复 */
+            if (s_motion_info != MOTION_INFO_NONE)
+            {
+                presence_set(APP_PRESENCE_OCCUPIED);
+            }
+        }
+    }
+    /* 睡眠状态: 5359 84 02 0001 [状态] sum 5443 */
+    else if (ctrl == CTRL_SLEEP && cmd == CMD_SLEEP_STATE)
+    {
+        if (data_len >= 1 && data_ptr[0] <= RADAR_SLEEP_NONE)
+        {
+            radar_sleep_state_set(data_ptr[0]);
+        }
+    }
+    /* 睡眠综合状态: 5359 84 0C 0008 ... sum 5443，十分钟一次 */
+    else if (ctrl == CTRL_SLEEP && cmd == CMD_SLEEP_COMPREHENSIVE)
+    {
+        radar_sleep_comprehensive_t info;
+        if (protocol_decode_sleep_comprehensive(data_ptr, data_len, &info) == 0 &&
+            info.sleep_state <= RADAR_SLEEP_NONE)
+        {
+            radar_sleep_state_set(info.sleep_state);
+            BINLOG_I(BINLOG_MOD_RADAR, "[雷达] 睡眠综合: 状态%u 呼吸%u 心跳%u 翻身%u 大体动%u%% 小体动%u%%\n",
+                     info.sleep_state, info.avg_breath, info.avg_heart_rate,
+                     info.turnovers, info.large_move_pct, info.small_move_pct);
+        }
+    }
+    /* 睡眠质量分析: 5359 84 0D 000C ... sum 5443，睡眠结束时上报 */
+    else if (ctrl == CTRL_SLEEP && cmd == CMD_SLEEP_QUALITY)
+    {
+        radar_sleep_quality_t q;
+        if (protocol_decode_sleep_quality(data_ptr, data_len, &q) == 0)
+        {
+            s_radar_sleep_score = q.score;
+            BINLOG_I(BINLOG_MOD_RADAR, "[雷达] 整晚质量: 评分%u 时长%u分钟 清醒%u%% 浅睡%u%% 深睡%u%%\n",
+                     q.score, q.total_minutes, q.awake_pct, q.light_pct, q.deep_pct);
+        }
+    }
+    /* 睡眠评分: 5359 84 06 0001 [评分] sum 5443 */
+    else if (ctrl == CTRL_SLEEP && cmd == CMD_SLEEP_SCORE)
+    {
+        if (data_len >= 1 && data_ptr[0] <= 100)
+        {
+            s_radar_sleep_score = data_ptr[0];
+        }
+    }
+    /* 其他帧静默忽略，不打印 */
+}
+
+/* 逐帧解析接收缓冲区，残余半帧移到缓冲区头部 */
+static void radar_rx_parse(uint8_t *rx_buf, uint16_t cap, uint16_t *rx_fill)
+{
+    /* 一次读取可能包含多帧（综合状态帧常与心率/呼吸帧同时到达），逐帧解析 */
+    uint16_t off = 0;
+    while (*rx_fill - off >= MIN_FRAME_LEN)
+    {
+        if (rx_buf[off] != FRAME_HEADER_1 || rx_buf[off + 1] != FRAME_HEADER_2)
+        {
+            off++;
+            continue;
+        }
+
+        uint8_t ctrl, cmd;
+        uint8_t *data_ptr;
+        uint16_t data_len;
+        int parse_res = protocol_parse_frame(&rx_buf[off], *rx_fill - off, &ctrl, &cmd, &data_ptr, &data_len);
+        if (parse_res == 0)
+        {
+            radar_handle_frame(ctrl, cmd, data_ptr, data_len);
+            off += MIN_FRAME_LEN + data_len;
+        }
+        else if (parse_res == -2)
+        {
+            break;  /* 半帧，留待下次读取补齐 */
+        }
+        else
+        {
+            off++;  /* 解析失败也静默忽略，跳过该字节重新同步 */
+        }
+    }
+
+    /* 从头部开始仍不完整且缓冲区已满说明是异常长度，丢弃 */
+    if (off > 0)
+    {
+        memmove(rx_buf, rx_buf + off, *rx_fill - off);
+        *rx_fill -= off;
+    }
+    else if (*rx_fill == cap)
+    {
+        *rx_fill = 0;
+    }
+}
+
+/* 接收侧状态（接收任务或事件循环独占） */
+static uint8_t s_rx_buf[128];
+static uint16_t s_rx_fill = 0;
+static TickType_t s_last_motion_query = 0;
+static TickType_t s_last_presence_query = 0;
+
+/* 接收启动：使能心率/睡眠上报并查询一次存在状态 */
+static void radar_rx_begin(void)
+{
+    /* 发送开启心率监测指令 */
+    uint8_t tx_buf[32];
+    uint16_t tx_len = sizeof(tx_buf);
+    if (protocol_pack_heart_rate_switch(1, tx_buf, &tx_len) == 0)
+    {
+        uart_write_bytes(USART_UX, (const char *)tx_buf, tx_len);
+        BINLOG_I(BINLOG_MOD_RADAR, "已发送心率使能命令\n");
+    }
+
+    /* 开启片上睡眠监测（睡眠状态/综合状态/质量分析上报） */
+    tx_len = sizeof(tx_buf);
+    if (protocol_pack_sleep_switch(1, tx_buf, &tx_len) == 0)
+    {
+        uart_write_bytes(USART_UX, (const char *)tx_buf, tx_len);
+    }
+
+    /* 启动时查询一次存在状态，之后依赖雷达的变化上报 */
+    tx_len = sizeof(tx_buf);
+    if (protocol_pack_presence_query(tx_buf, &tx_len) == 0)
+    {
+        uart_write_bytes(USART_UX, (const char *)tx_buf, tx_len);
+    }
+    
+    sleep_arousal_init(&g_arousal);
+
+    s_last_motion_query = xTaskGetTickCount();
+    s_last_presence_query = s_last_motion_query;
+}
+
+/*
+ * 发送到期的查询：有人时为体动查询（按睡眠状态自适应 1/3/6 秒），无人时为存在心跳。
+ * 返回距下一次查询的 tick 数，供事件循环计算阻塞时长。
+ */
+static TickType_t radar_query_step(void)
+{
+    const TickType_t now = xTaskGetTickCount();
+    uint8_t tx_buf[16];
+    uint16_t tx_len = sizeof(tx_buf);
+
+    if (s_presence != APP_PRESENCE_EMPTY)
+    {
+        const uint32_t query_ms = motion_query_period_ms();
+        const TickType_t period = pdMS_TO_TICKS(query_ms);
+        if ((now - s_last_motion_query) >= period)
+        {
+            if (protocol_pack_motion_query(tx_buf, &tx_len) == 0)
+            {
+                uart_write_bytes(USART_UX, (const char *)tx_buf, tx_len);
+                s_poll_queries[(query_ms == POLL_FAST_MS) ? 0 : (query_ms == POLL_SLOW_MS) ? 2 : 1]++;
+                s_poll_span_ms += query_ms;
+            }
+            s_last_motion_query = now;
+        }
+        return period - (now - s_last_motion_query);
+    }
+
+    const TickType_t period = pdMS_TO_TICKS(PRESENCE_HEARTBEAT_MS);
+    if ((now - s_last_presence_query) >= period)
+    {
+        if (protocol_pack_presence_query(tx_buf, &tx_len) == 0)
+        {
+            uart_write_bytes(USART_UX, (const char *)tx_buf, tx_len);
+            s_presence_heartbeats++;
+        }
+        s_last_presence_query = now;
+    }
+    return period - (now - s_last_presence_query);
+}
+
+/*
+ * 读取串口已缓存的数据并逐帧解析。
+ * first_byte_wait > 0 时先阻塞等待首字节（无人时代替 20ms 轮询），再等整帧到齐。
+ */
+static void radar_rx_drain(TickType_t first_byte_wait)
+{
+    const bool was_empty = (s_presence == APP_PRESENCE_EMPTY);
+    bool got = false;
+
+    if (first_byte_wait > 0 && s_rx_fill < sizeof(s_rx_buf))
+    {
+        if (uart_read_bytes(USART_UX, s_rx_buf + s_rx_fill, 1, first_byte_wait) > 0)
+        {
+            s_rx_fill++;
+            got = true;
+            vTaskDelay(pdMS_TO_TICKS(RX_POLL_MS));
+        }
+    }
+
+    size_t len = 0;
+    uart_get_buffered_data_len(USART_UX, &len);
+
+    if (len > 0 && s_rx_fill < sizeof(s_rx_buf))
+    {
+        const uint16_t space = sizeof(s_rx_buf) - s_rx_fill;
+        int rx_len = uart_read_bytes(USART_UX, s_rx_buf + s_rx_fill, (len > space ? space : len), 100);
+        if (rx_len > 0)
+        {
+            s_rx_fill += (uint16_t)rx_len;
+            got = true;
+        }
+    }
+
+    if (got)
+    {
+        radar_rx_parse(s_rx_buf, sizeof(s_rx_buf), &s_rx_fill);
+    }
+
+    /* 刚回床：立即补一次体动查询，一个采样内恢复 */
+    if (was_empty && s_presence != APP_PRESENCE_EMPTY)
+    {
+        s_last_motion_query = xTaskGetTickCount() - pdMS_TO_TICKS(POLL_SLOW_MS);
+    }
+}
+
+#if !APP_EVENT_LOOP
+static void uart_rx_task(void *pvParameters)
+{
+    radar_rx_begin();
+
+    while (1)
+    {
+        const bool empty = (s_presence == APP_PRESENCE_EMPTY);
+        (void)radar_query_step();
+        radar_rx_drain(empty ? pdMS_TO_TICKS(PRESENCE_IDLE_READ_MS) : 0);
+        task_stack_mark(APP_TASK_UART);
+
+        /* 无人时已在首字节上阻塞；刚回床时不等待，下一轮立即补发查询 */
+        if (!empty)
+        {
+            vTaskDelay(pdMS_TO_TICKS(RX_POLL_MS));
+        }
+    }
+}
+#endif
+
+#if APP_EVENT_LOOP
+/*
+ * 单任务事件循环：串口事件驱动帧解析，体动查询与epoch关闭按各自到期时间调度，
+ * 无事件时阻塞在 UART 事件队列上直到最近的到期时刻。取代接收与分期两个任务。
+ * 开机读到断点时先不关 epoch，每秒检查一次系统时间，有效或超时后接续，其间照常收发。
+ */
+static void app_event_loop_task(void *pvParameters)
+{
+    QueueHandle_t uart_queue = uart0_event_queue();
+    const TickType_t period = pdMS_TO_TICKS(EPOCH_MS);
+    const TickType_t restore_check = pdMS_TO_TICKS(1000);
+
+    radar_rx_begin();
+    bool restore_pending = sleep_stage_begin();
+    const TickType_t restore_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(CHECKPOINT_TIME_WAIT_MS);
+    TickType_t next_epoch = xTaskGetTickCount() + (restore_pending ? restore_check : period);
+
+    while (1)
+    {
+        /* 有人回床：与任务模式的通知唤醒一致，立即关一次epoch */
+        if (ulTaskNotifyTake(pdTRUE, 0) > 0)
+        {
+            next_epoch = xTaskGetTickCount();
+        }
+
+        const TickType_t query_wait = radar_query_step();
+        const TickType_t now = xTaskGetTickCount();
+        if (restore_pending && (int32_t)(now - next_epoch) >= 0)
+        {
+            if (rtc_time_is_valid() || (int32_t)(now - restore_deadline) >= 0)
+            {
+                sleep_stage_resume();
+                restore_pending = false;
+            }
+            next_epoch = xTaskGetTickCount() + (restore_pending ? restore_check : period);
+            continue;
+        }
+        if ((int32_t)(now - next_epoch) >= 0)
+        {
+            /* 关 epoch 期间（含断点写 SD/NVS）不读串口，耗时即为串口处理的附加延迟 */
+            const int64_t t0 = esp_timer_get_time();
+            sleep_stage_step();
+            const uint32_t step_us = (uint32_t)(esp_timer_get_time() - t0);
+            s_loop_step_max_us = (step_us > s_loop_step_max_us) ? step_us : s_loop_step_max_us;
+            next_epoch = xTaskGetTickCount() + period;
+            task_stack_mark(APP_TASK_LOOP);
+            continue;
+        }
+
+        const TickType_t epoch_wait = next_epoch - now;
+        const TickType_t wait = (query_wait < epoch_wait) ? query_wait : epoch_wait;
+        uart_event_t ev;
+        if (!uart_queue)
+        {
+            radar_rx_drain(wait);
+        }
+        else if (xQueueReceive(uart_queue, &ev, wait) == pdTRUE)
+        {
+            switch (ev.type)
+            {
+            case UART_DATA:
+                radar_rx_drain(0);
+                break;
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                /* 溢出后缓冲内容已不连续，整体丢弃重新同步 */
+                uart_flush_input(USART_UX);
+                xQueueReset(uart_queue);
+                s_rx_fill = 0;
+                break;
+            default:
+                break;
+            }
+        }
+        task_stack_mark(APP_TASK_LOOP);
+    }
+}
+#endif
+
+esp_err_t app_controller_start(void)
+{
+    if (s_started)
     {
         return ESP_OK;
     }
 
+    /* 接收/分期任务的输出经二进制日志环由低优先级任务刷写 */
+    if (binlog_init() != ESP_OK)
+    {
+        ESP_LOGW(TAG, "binlog unavailable, sensing logs dropped");
+    }
+
+    if (baseline_store_load(&g_user_baseline) == ESP_OK)
+    {
+        ESP_LOGI(TAG, "baseline loaded: %lu nights, rr %.1f hr %.1f",
+                 (unsigned long)g_user_baseline.nights, g_user_baseline.rr.mean, g_user_baseline.hr.mean);
+    }
+
+    if (sleep_rollup_init() != ESP_OK)
+    {
+        ESP_LOGW(TAG, "rollup storage unavailable");
+    }
+
     s_health_queue = xQueueCreate(HEALTH_QUEUE_LEN, sizeof(health_data_t));
     if (!s_health_queue)
     {
@@ -552,9 +1799,19 @@ esp_err_t app_controller_start(void)
         return ESP_FAIL;
     }
 
-    BaseType_t r1 = xTaskCreate(upload_data_task, "upload_data_task", 4096, NULL, 5, NULL);
-    BaseType_t r2 = xTaskCreate(sleep_stage_task, "sleep_stage_task", 4096, NULL, 5, NULL);
-    BaseType_t r3 = xTaskCreate(uart_rx_task, "uart_rx_task", 4096, NULL, 5, NULL);
+    BaseType_t r1 = xTaskCreate(upload_data_task, "upload_data_task", APP_TASK_STACK, NULL, 5, NULL);
+#if APP_EVENT_LOOP
+    /* 事件循环同时承担分期任务的角色，回床通知发给它 */
+    BaseType_t r2 = xTaskCreate(app_event_loop_task, "app_event_loop", APP_TASK_STACK, NULL, 5, &s_stage_task);
+    BaseType_t r3 = pdPASS;
+    s_task_stack_size[APP_TASK_LOOP] = APP_TASK_STACK;
+#else
+    BaseType_t r2 = xTaskCreate(sleep_stage_task, "sleep_stage_task", APP_TASK_STACK, NULL, 5, &s_stage_task);
+    BaseType_t r3 = xTaskCreate(uart_rx_task, "uart_rx_task", APP_TASK_STACK, NULL, 5, NULL);
+    s_task_stack_size[APP_TASK_STAGE] = APP_TASK_STACK;
+    s_task_stack_size[APP_TASK_UART] = APP_TASK_STACK;
+#endif
+    s_task_stack_size[APP_TASK_UPLOAD] = APP_TASK_STACK;
 
     if (r1 != pdPASS || r2 != pdPASS || r3 != pdPASS)
     {
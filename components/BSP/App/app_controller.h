@@ -1,6 +1,43 @@
 #pragma once
 
 #include "esp_err.h"
+#include "upload_batch.h"
+
+/* 分期阈值模式 */
+typedef enum
+{
+    APP_THRESHOLD_MEAN_STD = 0,  /* 最近40个epoch的 mean+std（个人基线预置） */
+    APP_THRESHOLD_QUANTILE,      /* 整晚流式分位数（P²），对单次大体动/雷达毛刺不敏感 */
+} app_threshold_mode_t;
+
+/* 分期分类器 */
+typedef enum
+{
+    APP_CLASSIFIER_RULES = 0,    /* 论文规则级联 + 心率扩展 */
+    APP_CLASSIFIER_TREE,         /* 决策树（tools/stage_tree_trainer.py 训练生成） */
+} app_stage_classifier_t;
+
+/* 床上存在状态（雷达 0x80 0x01/0x81） */
+typedef enum
+{
+    APP_PRESENCE_UNKNOWN = 0,    /* 尚未收到存在上报，按有人处理 */
+    APP_PRESENCE_EMPTY,          /* 无人：暂停体动查询、分期与上传，仅保留存在心跳 */
+    APP_PRESENCE_OCCUPIED,
+} app_presence_t;
 
 /* 启动业务控制任务（上传、睡眠分析、UART解析） */
 esp_err_t app_controller_start(void);
+
+/* 运行时切换阈值模式，下一个epoch生效 */
+void app_controller_set_threshold_mode(app_threshold_mode_t mode);
+app_threshold_mode_t app_controller_get_threshold_mode(void);
+
+/* 运行时切换分期分类器，下一个epoch生效；两者每epoch耗时在睡眠报告中输出 */
+void app_controller_set_stage_classifier(app_stage_classifier_t classifier);
+app_stage_classifier_t app_controller_get_stage_classifier(void);
+
+/* 当前存在状态；无人期间的节省统计（空闲占比、省去的查询/分期/上传）在状态切换时输出 */
+app_presence_t app_controller_get_presence(void);
+
+/* 批量上传刷写策略（条数/等待时长/状态切换），默认 20 条或 10 分钟 */
+void app_controller_set_upload_policy(const upload_flush_policy_t *policy);
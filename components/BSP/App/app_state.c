@@ -0,0 +1,116 @@
+#include "app_state.h"
+
+#include <string.h>
+#include "freertos/semphr.h"
+
+/*
+ * s_seq 为偶数时读者读 s_buf[0]，奇数时读 s_buf[1]。
+ * 写者：seq+1 → 写 s_buf[0] → seq+1 → 写 s_buf[1]，
+ * 任一时刻读者所选的副本都不在被修改；读取期间序号变化说明写者可能已转到该副本，重读一次即可。
+ * 版本号 = 完成的发布次数 = seq/2。
+ */
+static app_live_state_t s_buf[2];
+static uint32_t s_seq = 0;
+static portMUX_TYPE s_writer_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static SemaphoreHandle_t s_sub_sem[APP_STATE_MAX_SUBSCRIBERS];
+static portMUX_TYPE s_sub_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void app_state_publish(const app_live_state_t *state)
+{
+    if (!state)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_writer_mux);
+    const uint32_t seq = __atomic_load_n(&s_seq, __ATOMIC_RELAXED);
+    app_live_state_t copy = *state;
+    copy.version = seq / 2U + 1U;
+
+    __atomic_store_n(&s_seq, seq + 1U, __ATOMIC_RELEASE);   /* 读者切到 s_buf[1] */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s_buf[0] = copy;
+    __atomic_store_n(&s_seq, seq + 2U, __ATOMIC_RELEASE);   /* 读者切回 s_buf[0] */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s_buf[1] = copy;
+    portEXIT_CRITICAL(&s_writer_mux);
+
+    for (int i = 0; i < APP_STATE_MAX_SUBSCRIBERS; ++i)
+    {
+        SemaphoreHandle_t sem = s_sub_sem[i];
+        if (sem)
+        {
+            (void)xSemaphoreGive(sem);
+        }
+    }
+}
+
+uint32_t app_state_read(app_live_state_t *out)
+{
+    if (!out)
+    {
+        return 0;
+    }
+
+    uint32_t seq;
+    do
+    {
+        seq = __atomic_load_n(&s_seq, __ATOMIC_ACQUIRE);
+        memcpy(out, &s_buf[seq & 1U], sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&s_seq, __ATOMIC_RELAXED) != seq);   /* 读期间写者切换过才重读，读者从不等待写者 */
+
+    return out->version;
+}
+
+int app_state_subscribe(void)
+{
+    SemaphoreHandle_t sem = xSemaphoreCreateBinary();
+    if (!sem)
+    {
+        return -1;
+    }
+
+    portENTER_CRITICAL(&s_sub_mux);
+    for (int i = 0; i < APP_STATE_MAX_SUBSCRIBERS; ++i)
+    {
+        if (!s_sub_sem[i])
+        {
+            s_sub_sem[i] = sem;
+            portEXIT_CRITICAL(&s_sub_mux);
+            return i;
+        }
+    }
+    portEXIT_CRITICAL(&s_sub_mux);
+
+    vSemaphoreDelete(sem);
+    return -1;
+}
+
+bool app_state_wait(int sub, uint32_t *last_version, TickType_t timeout, app_live_state_t *out)
+{
+    if (sub < 0 || sub >= APP_STATE_MAX_SUBSCRIBERS || !s_sub_sem[sub] || !last_version || !out)
+    {
+        return false;
+    }
+
+    /* 先查版本：订阅前或两次等待之间的发布不会丢失 */
+    if (app_state_read(out) > *last_version)
+    {
+        (void)xSemaphoreTake(s_sub_sem[sub], 0);
+        *last_version = out->version;
+        return true;
+    }
+
+    if (xSemaphoreTake(s_sub_sem[sub], timeout) != pdTRUE)
+    {
+        return false;
+    }
+    if (app_state_read(out) <= *last_version)
+    {
+        return false;
+    }
+    *last_version = out->version;
+    return true;
+}
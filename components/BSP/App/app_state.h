@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "app_controller.h"
+#include "sleep_analysis.h"
+
+/* 入睡状态机阶段 */
+typedef enum
+{
+    APP_PHASE_MONITORING = 0,    /* 监测中（未入睡或已醒来） */
+    APP_PHASE_SETTLING,          /* 入睡观察期 */
+    APP_PHASE_SLEEPING,          /* 睡眠中 */
+} app_sleep_phase_t;
+
+/* 实时睡眠状态快照，分期任务每个epoch发布一次 */
+typedef struct
+{
+    uint32_t version;            /* 发布序号，从1开始；0 表示尚未发布 */
+    uint32_t timestamp;          /* 发布时刻 (time(NULL)) */
+    app_sleep_phase_t phase;
+    sleep_stage_t stage;         /* 最新epoch分期 */
+    uint8_t radar_stage;         /* 雷达片上分期 (RADAR_SLEEP_*，0xFF 未知) */
+    app_presence_t presence;
+    float heart_rate;            /* epoch 平均 */
+    float breathing_rate;
+    float motion_index;
+    uint32_t epoch_arousals;
+    uint32_t settling_epochs;
+    uint32_t night_epochs;
+    sleep_quality_report_t report;
+} app_live_state_t;
+
+#define APP_STATE_MAX_SUBSCRIBERS 4
+
+/**
+ * @brief 发布新快照（写者之间用 portMUX 串行化，可在任意任务调用）
+ *
+ * 双缓冲 seqlock（latch）：写者先切换序号再改另一份副本，
+ * 读者始终读取当前未被修改的那份，不加锁、不阻塞写者。
+ * state->version 由本函数填写。
+ */
+void app_state_publish(const app_live_state_t *state);
+
+/**
+ * @brief 读取最新快照，无锁且不等待写者；读取期间恰逢发布时重读
+ * @return 快照版本号，0 表示尚未发布（out 清零）
+ */
+uint32_t app_state_read(app_live_state_t *out);
+
+/**
+ * @brief 注册变更订阅者，每个订阅者持有一个二值信号量，发布时逐一唤醒
+ * @return 订阅句柄 (>=0)，订阅者已满返回 -1
+ */
+int app_state_subscribe(void);
+
+/**
+ * @brief 等待版本号超过 *last_version 的快照
+ *
+ * 已有更新时立即返回；否则阻塞在订阅信号量上直至发布或超时。
+ * 多次发布只唤醒一次，读到的总是最新快照。
+ *
+ * @param sub           app_state_subscribe 返回的句柄
+ * @param last_version  输入为已处理的版本，成功时更新为新版本
+ * @return true 取得新快照，false 超时
+ */
+bool app_state_wait(int sub, uint32_t *last_version, TickType_t timeout, app_live_state_t *out);
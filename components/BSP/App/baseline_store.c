@@ -0,0 +1,66 @@
+#include "baseline_store.h"
+
+#include "esp_log.h"
+#include "nvs.h"
+
+#define BASELINE_NVS_NAMESPACE "sleep"
+#define BASELINE_NVS_KEY       "baseline"
+
+static const char *TAG = "baseline";
+
+esp_err_t baseline_store_load(sleep_baseline_t *out_baseline)
+{
+    if (!out_baseline)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(BASELINE_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    sleep_baseline_t tmp;
+    size_t len = sizeof(tmp);
+    err = nvs_get_blob(handle, BASELINE_NVS_KEY, &tmp, &len);
+    nvs_close(handle);
+
+    if (err != ESP_OK || len != sizeof(tmp) || !sleep_analysis_baseline_is_valid(&tmp))
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    *out_baseline = tmp;
+    return ESP_OK;
+}
+
+esp_err_t baseline_store_save(const sleep_baseline_t *baseline)
+{
+    if (!baseline)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(BASELINE_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "nvs open failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_set_blob(handle, BASELINE_NVS_KEY, baseline, sizeof(*baseline));
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "save baseline failed: %s", esp_err_to_name(err));
+    }
+    return err;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "esp_err.h"
+#include "sleep_analysis.h"
+
+/* 从 NVS 读取个人睡眠基线；不存在或版本不符时返回 ESP_ERR_NOT_FOUND */
+esp_err_t baseline_store_load(sleep_baseline_t *out_baseline);
+
+/* 将个人睡眠基线写入 NVS */
+esp_err_t baseline_store_save(const sleep_baseline_t *baseline);
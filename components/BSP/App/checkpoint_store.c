@@ -0,0 +1,362 @@
+#include "checkpoint_store.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include "audio_sdcard.h"
+
+#define CKPT_NVS_NAMESPACE "sleep_ckpt"
+#define CKPT_DIR           AUDIO_SD_MOUNT_POINT "/CKPT"
+#define CKPT_EPOCH_FILE    CKPT_DIR "/EPOCHS.BIN"
+#define CKPT_MAGIC         0x504B4353U   /* 'SCKP' */
+#define CKPT_VERSION       1U
+
+static const char *TAG = "checkpoint";
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t seq;
+    checkpoint_state_t state;
+    uint32_t night_crc;
+    uint32_t crc;                /* 以上字段的 CRC32 */
+} ckpt_header_t;
+
+typedef struct
+{
+    uint32_t base;               /* 首个 epoch 的绝对序号 */
+    uint16_t count;
+    uint16_t reserved;
+    sleep_epoch_t epochs[CHECKPOINT_CHUNK_EPOCHS];
+    uint8_t stages[CHECKPOINT_CHUNK_EPOCHS];
+    uint32_t crc;                /* 以上字段的 CRC32 */
+} ckpt_chunk_t;
+
+static uint32_t s_seq = 0;            /* 最近一次写入的序号 */
+static uint32_t s_saved_total = 0;    /* 已落盘的 epoch 绝对序号上界，0 表示新一轮 */
+
+static uint32_t crc_of(const void *buf, size_t len)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)buf, (uint32_t)len);
+}
+
+static void header_key(char *key, size_t len, uint32_t seq)
+{
+    snprintf(key, len, "hdr%lu", (unsigned long)(seq & 1U));
+}
+
+static void night_key(char *key, size_t len, uint32_t seq)
+{
+    snprintf(key, len, "night%lu", (unsigned long)(seq & 1U));
+}
+
+static long chunk_offset(uint32_t chunk)
+{
+    return (long)(chunk % CHECKPOINT_CHUNK_SLOTS) * (long)sizeof(ckpt_chunk_t);
+}
+
+/* 打开 SD 卡上的 epoch 块文件；create 时不存在则新建 */
+static FILE *chunk_file_open(bool create)
+{
+    if (audio_sdcard_mount() != ESP_OK)
+    {
+        return NULL;
+    }
+    FILE *f = fopen(CKPT_EPOCH_FILE, "r+b");
+    if (!f && create)
+    {
+        mkdir(CKPT_DIR, 0775);
+        f = fopen(CKPT_EPOCH_FILE, "w+b");
+    }
+    return f;
+}
+
+static bool chunk_read(FILE *f, uint32_t chunk, ckpt_chunk_t *out)
+{
+    return fseek(f, chunk_offset(chunk), SEEK_SET) == 0 && fread(out, sizeof(*out), 1, f) == 1;
+}
+
+static bool chunk_write(FILE *f, uint32_t chunk, const ckpt_chunk_t *in)
+{
+    return fseek(f, chunk_offset(chunk), SEEK_SET) == 0 && fwrite(in, sizeof(*in), 1, f) == 1;
+}
+
+/*
+ * 写入 seq 一侧的键；NVS 空间不足时擦除该侧的旧状态头与累加器（它们已被另一侧的新断点取代）再重试一次。
+ * 先擦状态头，该侧在重写完成前始终无效。
+ */
+static esp_err_t side_set_blob(nvs_handle_t handle, uint32_t seq, const char *key, const void *data, size_t len)
+{
+    esp_err_t err = nvs_set_blob(handle, key, data, len);
+    if (err != ESP_ERR_NVS_NOT_ENOUGH_SPACE)
+    {
+        return err;
+    }
+    ESP_LOGW(TAG, "nvs full writing %s, dropping stale side %lu", key, (unsigned long)(seq & 1U));
+    char stale[12];
+    header_key(stale, sizeof(stale), seq);
+    (void)nvs_erase_key(handle, stale);
+    night_key(stale, sizeof(stale), seq);
+    (void)nvs_erase_key(handle, stale);
+    return nvs_set_blob(handle, key, data, len);
+}
+
+static bool header_valid(const ckpt_header_t *h)
+{
+    return h->magic == CKPT_MAGIC && h->version == CKPT_VERSION && h->size == sizeof(*h) &&
+           h->crc == crc_of(h, offsetof(ckpt_header_t, crc));
+}
+
+esp_err_t checkpoint_store_save(const checkpoint_state_t *state,
+                                const sleep_epoch_t *epochs,
+                                const sleep_stage_result_t *stages,
+                                size_t count,
+                                const sleep_night_t *night)
+{
+    if (!state || (count > 0 && (!epochs || !stages)) || count > state->total_epochs)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(CKPT_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "nvs open failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    /* 1. 增量 epoch 块（SD 卡）：从上次已写部分所在块重写到最新块 */
+    const uint32_t total = state->total_epochs;
+    const uint32_t window_start = total - (uint32_t)count;
+    uint32_t first = s_saved_total;
+    if (first == 0U || first < window_start || first > total)
+    {
+        first = (total > CHECKPOINT_BACKFILL_EPOCHS) ? total - CHECKPOINT_BACKFILL_EPOCHS : 0U;
+        if (first < window_start)
+        {
+            first = window_start;
+        }
+    }
+
+    char key[12];
+    FILE *f = (total > first) ? chunk_file_open(true) : NULL;
+    bool chunks_ok = (total == first) || f != NULL;
+    for (uint32_t c = first / CHECKPOINT_CHUNK_EPOCHS; f && chunks_ok && c * CHECKPOINT_CHUNK_EPOCHS < total; ++c)
+    {
+        ckpt_chunk_t chunk;
+        memset(&chunk, 0, sizeof(chunk));
+        uint32_t begin = c * CHECKPOINT_CHUNK_EPOCHS;
+        if (begin < window_start)
+        {
+            begin = window_start;
+        }
+        uint32_t end = (c + 1U) * CHECKPOINT_CHUNK_EPOCHS;
+        if (end > total)
+        {
+            end = total;
+        }
+        chunk.base = begin;
+        chunk.count = (uint16_t)(end - begin);
+        const uint32_t slot0 = begin - c * CHECKPOINT_CHUNK_EPOCHS;
+        for (uint32_t i = 0; i < chunk.count; ++i)
+        {
+            chunk.epochs[slot0 + i] = epochs[begin - window_start + i];
+            chunk.stages[slot0 + i] = (uint8_t)stages[begin - window_start + i].stage;
+        }
+        chunk.crc = crc_of(&chunk, offsetof(ckpt_chunk_t, crc));
+        chunks_ok = chunk_write(f, c, &chunk);
+    }
+    if (f)
+    {
+        /* 块先于状态头落盘，状态头提交时其引用的 epoch 已在卡上 */
+        chunks_ok = chunks_ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+        fclose(f);
+    }
+    if (!chunks_ok)
+    {
+        ESP_LOGW(TAG, "epoch chunks not saved (sd card unavailable), checkpoint keeps state only");
+    }
+
+    /* 2. 整晚累加器与 3. 状态头，写入与上次相反的一侧 */
+    const uint32_t seq = s_seq + 1U;
+    ckpt_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = CKPT_MAGIC;
+    hdr.version = CKPT_VERSION;
+    hdr.size = sizeof(hdr);
+    hdr.seq = seq;
+    hdr.state = *state;
+    hdr.state.has_night = night ? 1U : 0U;
+    if (err == ESP_OK && night)
+    {
+        hdr.night_crc = crc_of(night, sizeof(*night));
+        night_key(key, sizeof(key), seq);
+        err = side_set_blob(handle, seq, key, night, sizeof(*night));
+    }
+    if (err == ESP_OK)
+    {
+        hdr.crc = crc_of(&hdr, offsetof(ckpt_header_t, crc));
+        header_key(key, sizeof(key), seq);
+        err = side_set_blob(handle, seq, key, &hdr, sizeof(hdr));
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "save checkpoint failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    s_seq = seq;
+    s_saved_total = chunks_ok ? total : 0U;   /* 块未写入时下次重新回填 */
+    return ESP_OK;
+}
+
+esp_err_t checkpoint_store_load(checkpoint_state_t *state,
+                                sleep_epoch_t *epochs,
+                                sleep_stage_result_t *stages,
+                                size_t max_epochs,
+                                size_t *out_count,
+                                sleep_night_t *night)
+{
+    if (!state || !epochs || !stages || !out_count || !night)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_count = 0;
+
+    nvs_handle_t handle;
+    if (nvs_open(CKPT_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* 两份状态头取序号较大的有效者 */
+    ckpt_header_t best;
+    bool found = false;
+    char key[12];
+    for (uint32_t side = 0; side < 2U; ++side)
+    {
+        ckpt_header_t h;
+        size_t len = sizeof(h);
+        header_key(key, sizeof(key), side);
+        if (nvs_get_blob(handle, key, &h, &len) == ESP_OK && len == sizeof(h) && header_valid(&h) &&
+            (!found || h.seq > best.seq))
+        {
+            best = h;
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        nvs_close(handle);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (best.state.has_night)
+    {
+        size_t len = sizeof(*night);
+        night_key(key, sizeof(key), best.seq);
+        if (nvs_get_blob(handle, key, night, &len) != ESP_OK || len != sizeof(*night) ||
+            crc_of(night, sizeof(*night)) != best.night_crc)
+        {
+            nvs_close(handle);
+            ESP_LOGW(TAG, "night accumulator corrupted, checkpoint dropped");
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+
+    nvs_close(handle);
+
+    /* epoch 从最新往前逐块恢复，先倒序放到数组尾部，最后整体前移；SD 卡不可用时窗口为空 */
+    const uint32_t total = best.state.total_epochs;
+    FILE *f = chunk_file_open(false);
+    size_t want = (max_epochs < total) ? max_epochs : total;
+    size_t got = 0;
+    uint32_t next = total;   /* 尚未恢复部分的上界（不含） */
+    while (f && got < want)
+    {
+        const uint32_t c = (next - 1U) / CHECKPOINT_CHUNK_EPOCHS;
+        ckpt_chunk_t chunk;
+        if (!chunk_read(f, c, &chunk) ||
+            chunk.crc != crc_of(&chunk, offsetof(ckpt_chunk_t, crc)) ||
+            chunk.base / CHECKPOINT_CHUNK_EPOCHS != c || chunk.base + chunk.count < next)
+        {
+            break;
+        }
+        /* 块可能比状态头新（写块后、写头前掉电），只取到 next 为止 */
+        while (next > chunk.base && got < want)
+        {
+            next--;
+            const size_t dst = want - 1U - got;
+            const uint32_t slot = next - c * CHECKPOINT_CHUNK_EPOCHS;
+            epochs[dst] = chunk.epochs[slot];
+            memset(&stages[dst], 0, sizeof(stages[dst]));
+            stages[dst].stage = (sleep_stage_t)chunk.stages[slot];
+            stages[dst].respiratory_rate_bpm = chunk.epochs[slot].respiratory_rate_bpm;
+            stages[dst].motion_index = chunk.epochs[slot].motion_index;
+            stages[dst].heart_rate_mean = chunk.epochs[slot].heart_rate_mean;
+            stages[dst].heart_rate_std = chunk.epochs[slot].heart_rate_std;
+            got++;
+        }
+        if (next > c * CHECKPOINT_CHUNK_EPOCHS)
+        {
+            break;   /* 块内前段缺失（回填起点），更早的数据不连续 */
+        }
+    }
+    if (f)
+    {
+        fclose(f);
+    }
+
+    if (got < want)
+    {
+        memmove(&epochs[0], &epochs[want - got], got * sizeof(epochs[0]));
+        memmove(&stages[0], &stages[want - got], got * sizeof(stages[0]));
+    }
+
+    *state = best.state;
+    *out_count = got;
+    s_seq = best.seq;
+    s_saved_total = total;
+    return ESP_OK;
+}
+
+esp_err_t checkpoint_store_clear(void)
+{
+    s_saved_total = 0;
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(CKPT_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    char key[12];
+    for (uint32_t side = 0; side < 2U; ++side)
+    {
+        header_key(key, sizeof(key), side);
+        esp_err_t e = nvs_erase_key(handle, key);
+        if (e != ESP_OK && e != ESP_ERR_NVS_NOT_FOUND)
+        {
+            err = e;
+        }
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sleep_analysis.h"
+#include "sleep_night_summary.h"
+
+/*
+ * 睡眠流水线断点（状态头与整晚累加器在 NVS，epoch 块在 SD 卡）
+ *
+ * - 状态头与整晚累加器按序号奇偶 A/B 双写，CRC32 校验，掉电时总有一份完整可用；
+ *   两侧合计约 1.6 KB，默认 24 KB 的 nvs 分区足够。空间不足时先擦除将被覆盖的一侧再重试
+ * - epoch 按 16 个一块增量写入 /sdcard/CKPT/EPOCHS.BIN（与趋势汇总、上传日志一样放在 SD 卡），
+ *   只重写最后一块与新增块；块按绝对序号在 33 个定长槽位中轮转，覆盖分期任务的 512 epoch 窗口。
+ *   SD 卡不可用时只保存状态头与累加器，恢复后 epoch 窗口为空
+ * - 写入顺序：epoch 块（fsync）→ 整晚累加器 → 状态头，状态头落盘即提交
+ */
+
+#define CHECKPOINT_CHUNK_EPOCHS    16U
+#define CHECKPOINT_WINDOW_EPOCHS   512U
+#define CHECKPOINT_CHUNK_SLOTS     (CHECKPOINT_WINDOW_EPOCHS / CHECKPOINT_CHUNK_EPOCHS + 1U)
+#define CHECKPOINT_BACKFILL_EPOCHS 64U    /* 新一轮断点首写时最多回填的历史 epoch（阈值窗口+入睡窗口） */
+
+/* 分期任务状态机（不含 epoch 数据） */
+typedef struct
+{
+    uint32_t saved_at;           /* 写入时刻 (unix s) */
+    uint32_t total_epochs;       /* 已存储 epoch 的绝对序号上界（不含） */
+    uint32_t settling_count;
+    uint32_t night_epochs;
+    uint32_t wake_count;
+    float baseline_hr;
+    uint8_t sleep_state;         /* app_sleep_phase_t */
+    uint8_t has_night;           /* 1 表示同时保存了整晚累加器 */
+    uint8_t reserved[2];
+} checkpoint_state_t;
+
+/**
+ * @brief 写入一次断点
+ *
+ * @param epochs/stages  分期任务窗口，epochs[count-1] 的绝对序号为 state->total_epochs-1
+ * @param night          入睡后传整晚累加器，否则 NULL
+ */
+esp_err_t checkpoint_store_save(const checkpoint_state_t *state,
+                                const sleep_epoch_t *epochs,
+                                const sleep_stage_result_t *stages,
+                                size_t count,
+                                const sleep_night_t *night);
+
+/**
+ * @brief 读取最新的有效断点
+ *
+ * epoch 从最新一块向前恢复，遇到缺失或校验失败的块即停止，只返回连续的最新部分。
+ * 成功后后续 save 接续该断点的序号。
+ *
+ * @param out_count  实际恢复的 epoch 数（≤ max_epochs）
+ * @return ESP_OK；无断点或全部校验失败返回 ESP_ERR_NOT_FOUND
+ */
+esp_err_t checkpoint_store_load(checkpoint_state_t *state,
+                                sleep_epoch_t *epochs,
+                                sleep_stage_result_t *stages,
+                                size_t max_epochs,
+                                size_t *out_count,
+                                sleep_night_t *night);
+
+/* 睡眠结束时作废断点（擦除两份状态头） */
+esp_err_t checkpoint_store_clear(void);
@@ -0,0 +1,72 @@
+#include "upload_batch.h"
+
+#include <string.h>
+
+void upload_batch_init(upload_batch_t *batch)
+{
+    if (batch)
+    {
+        memset(batch, 0, sizeof(*batch));
+    }
+}
+
+void upload_batch_push(upload_batch_t *batch, const health_data_t *item, uint32_t now_s)
+{
+    if (!batch || !item)
+    {
+        return;
+    }
+
+    if (batch->count == UPLOAD_BATCH_CAPACITY)
+    {
+        upload_batch_consume(batch, 1);
+        batch->dropped++;
+    }
+    batch->items[batch->count] = *item;
+    batch->enqueued_s[batch->count] = now_s;
+    batch->count++;
+}
+
+void upload_batch_mark_transition(upload_batch_t *batch)
+{
+    if (batch)
+    {
+        batch->transition = true;
+    }
+}
+
+bool upload_batch_due(const upload_batch_t *batch, const upload_flush_policy_t *policy, uint32_t now_s)
+{
+    if (!batch || !policy || batch->count == 0)
+    {
+        return false;
+    }
+
+    if (batch->count >= policy->max_items)
+    {
+        return true;
+    }
+    if (policy->flush_on_transition && batch->transition)
+    {
+        return true;
+    }
+    return (now_s - batch->enqueued_s[0]) >= policy->max_age_s;
+}
+
+void upload_batch_consume(upload_batch_t *batch, size_t n)
+{
+    if (!batch || n == 0)
+    {
+        return;
+    }
+
+    if (n >= batch->count)
+    {
+        batch->count = 0;
+        batch->transition = false;
+        return;
+    }
+    memmove(&batch->items[0], &batch->items[n], (batch->count - n) * sizeof(batch->items[0]));
+    memmove(&batch->enqueued_s[0], &batch->enqueued_s[n], (batch->count - n) * sizeof(batch->enqueued_s[0]));
+    batch->count -= n;
+}
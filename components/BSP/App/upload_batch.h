@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "http_request.h"
+
+/*
+ * 多 epoch 批量上传缓冲
+ *
+ * 上传任务把分期任务逐 epoch 入队的数据攒在这里，满足刷写策略时整批发出
+ * （服务器约定见 http_send_health_batch）。发送失败时数据留在缓冲中继续累积，
+ * 缓冲满则丢弃最旧的一条；服务器只确认前 N 条时只移除这 N 条，其余下次重发。
+ * 纯数据结构，不加锁，仅由上传任务访问。
+ */
+
+#define UPLOAD_BATCH_CAPACITY 64U     /* 约32分钟的 epoch，断网期间的缓冲上限 */
+
+/* 刷写策略，任一条件满足即发送 */
+typedef struct
+{
+    uint16_t max_items;          /* 攒满条数 */
+    uint16_t max_age_s;          /* 最早一条等待时长 */
+    bool flush_on_transition;    /* 入睡/醒来/离床等状态切换时立即发送 */
+} upload_flush_policy_t;
+
+typedef struct
+{
+    health_data_t items[UPLOAD_BATCH_CAPACITY];
+    uint32_t enqueued_s[UPLOAD_BATCH_CAPACITY];   /* 入缓冲时刻（单调秒） */
+    size_t count;
+    bool transition;             /* 自上次发送以来发生过状态切换 */
+    uint32_t dropped;            /* 缓冲满丢弃的条数 */
+} upload_batch_t;
+
+void upload_batch_init(upload_batch_t *batch);
+
+/* 追加一条；缓冲满时丢弃最旧一条 */
+void upload_batch_push(upload_batch_t *batch, const health_data_t *item, uint32_t now_s);
+
+/* 标记状态切换，配合 flush_on_transition 使用 */
+void upload_batch_mark_transition(upload_batch_t *batch);
+
+/* 是否应当发送 */
+bool upload_batch_due(const upload_batch_t *batch, const upload_flush_policy_t *policy, uint32_t now_s);
+
+/* 移除已被服务器确认的前 n 条；缓冲清空时清除切换标记 */
+void upload_batch_consume(upload_batch_t *batch, size_t n);
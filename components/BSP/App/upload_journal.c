@@ -0,0 +1,476 @@
+#include "upload_journal.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "audio_sdcard.h"
+
+#define JNL_DIR          AUDIO_SD_MOUNT_POINT "/UPQ"
+#define JNL_CURSOR_FILE  JNL_DIR "/CURSOR.BIN"
+#define JNL_FRAME_MAGIC  0x4C4E4A55U   /* 'UJNL' */
+#define JNL_CURSOR_MAGIC 0x52434A55U   /* 'UJCR' */
+#define JNL_SCAN_MAX     (UPLOAD_JOURNAL_MAX_SEGMENTS * 2U)
+#define JNL_PATH_LEN     32
+
+static const char *TAG = "upload_jnl";
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;
+    health_data_t item;
+    uint32_t crc;                /* 以上字段的 CRC32 */
+} jnl_frame_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t gen;                /* 写入代数，两槽取较大的有效者 */
+    uint32_t next_seq;           /* 下一条未确认的 seq */
+    uint32_t crc;
+} jnl_cursor_t;
+
+typedef struct
+{
+    uint32_t id;                 /* 文件名中的段号，单调递增 */
+    uint32_t first_seq;
+    uint32_t count;              /* 有效帧数，段内 seq 连续 */
+} jnl_segment_t;
+
+static jnl_segment_t s_segs[UPLOAD_JOURNAL_MAX_SEGMENTS];
+static size_t s_seg_count = 0;
+static bool s_ready = false;
+static bool s_roll = false;                  /* 最新段尾部损坏或写失败，下次追加另起新段 */
+static uint32_t s_next_id = 0;               /* 下一个新段的段号 */
+static uint32_t s_next_seq = 1;              /* 下一次追加的 seq */
+static uint32_t s_cursor = 1;                /* 下一条未确认的 seq */
+static uint32_t s_cursor_gen = 0;
+static uint32_t s_read_seq[UPLOAD_JOURNAL_READ_MAX];   /* 最近一次 read 返回各条的 seq */
+static size_t s_read_count = 0;
+static uint32_t s_read_end = 0;              /* 最近一次 read 扫描到的位置（不含） */
+static upload_journal_stats_t s_stats;
+
+static uint32_t crc_of(const void *buf, size_t len)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)buf, (uint32_t)len);
+}
+
+static void seg_path(char *path, size_t len, uint32_t id)
+{
+    snprintf(path, len, JNL_DIR "/%08lX.JNL", (unsigned long)id);
+}
+
+static bool frame_valid(const jnl_frame_t *fr, uint32_t seq)
+{
+    return fr->magic == JNL_FRAME_MAGIC && fr->seq == seq && fr->crc == crc_of(fr, offsetof(jnl_frame_t, crc));
+}
+
+/* 写入后刷到卡上，掉电时最多丢失正在写的一帧 */
+static bool file_sync(FILE *f)
+{
+    return fflush(f) == 0 && fsync(fileno(f)) == 0;
+}
+
+static uint32_t seg_end(const jnl_segment_t *seg)
+{
+    return seg->first_seq + seg->count;
+}
+
+/* 段中尚未确认的条数 */
+static uint32_t seg_pending(const jnl_segment_t *seg)
+{
+    const uint32_t from = (s_cursor > seg->first_seq) ? s_cursor : seg->first_seq;
+    return (seg_end(seg) > from) ? seg_end(seg) - from : 0U;
+}
+
+static void seg_remove_first(void)
+{
+    char path[JNL_PATH_LEN];
+    seg_path(path, sizeof(path), s_segs[0].id);
+    unlink(path);
+    memmove(&s_segs[0], &s_segs[1], (s_seg_count - 1U) * sizeof(s_segs[0]));
+    s_seg_count--;
+}
+
+/* 逐帧校验一段，返回有效前缀帧数；*torn 表示有效前缀之后还有数据（撕裂或损坏） */
+static uint32_t seg_scan(uint32_t id, uint32_t *first_seq, bool *torn)
+{
+    char path[JNL_PATH_LEN];
+    seg_path(path, sizeof(path), id);
+    *torn = false;
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return 0;
+    }
+
+    jnl_frame_t fr;
+    uint32_t count = 0;
+    while (count < UPLOAD_JOURNAL_SEGMENT_RECORDS)
+    {
+        const size_t got = fread(&fr, 1, sizeof(fr), f);
+        if (got == 0)
+        {
+            break;
+        }
+        if (count == 0 && got == sizeof(fr))
+        {
+            *first_seq = fr.seq;
+        }
+        if (got != sizeof(fr) || !frame_valid(&fr, *first_seq + count))
+        {
+            *torn = true;
+            break;
+        }
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+static bool cursor_load(jnl_cursor_t *out)
+{
+    FILE *f = fopen(JNL_CURSOR_FILE, "rb");
+    if (!f)
+    {
+        return false;
+    }
+    jnl_cursor_t slot[2];
+    const size_t n = fread(slot, sizeof(slot[0]), 2, f);
+    fclose(f);
+
+    bool found = false;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (slot[i].magic == JNL_CURSOR_MAGIC && slot[i].crc == crc_of(&slot[i], offsetof(jnl_cursor_t, crc)) &&
+            (!found || slot[i].gen > out->gen))
+        {
+            *out = slot[i];
+            found = true;
+        }
+    }
+    return found;
+}
+
+/* 游标写入与上次相反的一槽 */
+static esp_err_t cursor_store(void)
+{
+    jnl_cursor_t c = {
+        .magic = JNL_CURSOR_MAGIC,
+        .gen = s_cursor_gen + 1U,
+        .next_seq = s_cursor,
+    };
+    c.crc = crc_of(&c, offsetof(jnl_cursor_t, crc));
+
+    FILE *f = fopen(JNL_CURSOR_FILE, "r+b");
+    if (!f)
+    {
+        f = fopen(JNL_CURSOR_FILE, "wb");
+    }
+    bool ok = f && fseek(f, (long)((c.gen & 1U) * sizeof(c)), SEEK_SET) == 0 &&
+              fwrite(&c, sizeof(c), 1, f) == 1 && file_sync(f);
+    if (f)
+    {
+        fclose(f);
+    }
+    if (!ok)
+    {
+        s_stats.write_errors++;
+        return ESP_FAIL;
+    }
+    s_cursor_gen = c.gen;
+    return ESP_OK;
+}
+
+/* 删除已全部确认的段；最新段在写满或需换段时才删 */
+static void drop_acked_segments(void)
+{
+    while (s_seg_count > 0 && seg_pending(&s_segs[0]) == 0 &&
+           (s_seg_count > 1 || s_roll || s_segs[0].count >= UPLOAD_JOURNAL_SEGMENT_RECORDS))
+    {
+        seg_remove_first();
+    }
+}
+
+static int id_cmp(const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *)a;
+    const uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+esp_err_t upload_journal_init(void)
+{
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_ready = false;
+    s_seg_count = 0;
+    s_roll = false;
+    s_read_count = 0;
+
+    if (audio_sdcard_mount() != ESP_OK)
+    {
+        ESP_LOGW(TAG, "sd card unavailable, uploads buffered in RAM only");
+        return ESP_ERR_INVALID_STATE;
+    }
+    mkdir(JNL_DIR, 0775);
+
+    DIR *dir = opendir(JNL_DIR);
+    if (!dir)
+    {
+        ESP_LOGE(TAG, "open %s failed", JNL_DIR);
+        return ESP_FAIL;
+    }
+    uint32_t ids[JNL_SCAN_MAX];
+    size_t nids = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL && nids < JNL_SCAN_MAX)
+    {
+        char *end = NULL;
+        const unsigned long id = strtoul(de->d_name, &end, 16);
+        if (end == de->d_name + 8 && strcasecmp(end, ".JNL") == 0)
+        {
+            ids[nids++] = (uint32_t)id;
+        }
+    }
+    closedir(dir);
+    qsort(ids, nids, sizeof(ids[0]), id_cmp);
+    s_next_id = (nids > 0) ? ids[nids - 1U] + 1U : 0U;
+
+    /* 段数超过上限（上限改小后）时先删最旧的 */
+    size_t skip = (nids > UPLOAD_JOURNAL_MAX_SEGMENTS) ? nids - UPLOAD_JOURNAL_MAX_SEGMENTS : 0U;
+    char path[JNL_PATH_LEN];
+    for (size_t i = 0; i < nids; ++i)
+    {
+        uint32_t first = 0;
+        bool torn = false;
+        const uint32_t count = (i < skip) ? 0U : seg_scan(ids[i], &first, &torn);
+        if (torn)
+        {
+            s_stats.corrupt++;
+        }
+        if (count == 0 || (s_seg_count > 0 && first < seg_end(&s_segs[s_seg_count - 1U])))
+        {
+            seg_path(path, sizeof(path), ids[i]);
+            unlink(path);
+            continue;
+        }
+        s_segs[s_seg_count++] = (jnl_segment_t){.id = ids[i], .first_seq = first, .count = count};
+        s_roll = torn || count >= UPLOAD_JOURNAL_SEGMENT_RECORDS;
+    }
+
+    s_next_seq = (s_seg_count > 0) ? seg_end(&s_segs[s_seg_count - 1U]) : 1U;
+    jnl_cursor_t c;
+    if (cursor_load(&c))
+    {
+        s_cursor = c.next_seq;
+        s_cursor_gen = c.gen;
+        if (s_cursor > s_next_seq)
+        {
+            s_next_seq = s_cursor;   /* 段文件丢失而游标仍在：seq 不回退 */
+        }
+    }
+    else
+    {
+        s_cursor = (s_seg_count > 0) ? s_segs[0].first_seq : s_next_seq;
+        s_cursor_gen = 0;
+    }
+    if (s_seg_count > 0 && s_cursor < s_segs[0].first_seq)
+    {
+        s_cursor = s_segs[0].first_seq;
+    }
+    drop_acked_segments();
+
+    s_ready = true;
+    ESP_LOGI(TAG, "journal ready: %u segments, %lu pending", (unsigned)s_seg_count,
+             (unsigned long)upload_journal_pending());
+    return ESP_OK;
+}
+
+bool upload_journal_ready(void)
+{
+    return s_ready;
+}
+
+esp_err_t upload_journal_append(const health_data_t *item)
+{
+    if (!item)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_ready)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const bool new_seg = s_seg_count == 0 || s_roll ||
+                         s_segs[s_seg_count - 1U].count >= UPLOAD_JOURNAL_SEGMENT_RECORDS;
+    if (new_seg)
+    {
+        if (s_seg_count == UPLOAD_JOURNAL_MAX_SEGMENTS)
+        {
+            /* 满：整段淘汰最旧数据，游标随之前移（下次确认时落盘） */
+            s_stats.evicted += seg_pending(&s_segs[0]);
+            seg_remove_first();
+            const uint32_t oldest = (s_seg_count > 0) ? s_segs[0].first_seq : s_next_seq;
+            if (s_cursor < oldest)
+            {
+                s_cursor = oldest;
+            }
+        }
+        s_segs[s_seg_count++] = (jnl_segment_t){.id = s_next_id++, .first_seq = s_next_seq, .count = 0};
+        s_roll = false;
+    }
+    jnl_segment_t *seg = &s_segs[s_seg_count - 1U];
+
+    jnl_frame_t fr;
+    memset(&fr, 0, sizeof(fr));
+    fr.magic = JNL_FRAME_MAGIC;
+    fr.seq = s_next_seq;
+    fr.item = *item;
+    fr.crc = crc_of(&fr, offsetof(jnl_frame_t, crc));
+
+    char path[JNL_PATH_LEN];
+    seg_path(path, sizeof(path), seg->id);
+    FILE *f = fopen(path, new_seg ? "wb" : "ab");
+    const bool ok = f && fwrite(&fr, sizeof(fr), 1, f) == 1 && file_sync(f);
+    if (f)
+    {
+        fclose(f);
+    }
+    if (!ok)
+    {
+        /* 段尾可能留下半帧，之后另起新段；连新段都写不进则停用日志 */
+        s_stats.write_errors++;
+        s_roll = true;
+        if (seg->count == 0)
+        {
+            unlink(path);
+            s_seg_count--;
+            s_ready = false;
+            ESP_LOGE(TAG, "append to %s failed, journal disabled", path);
+        }
+        return ESP_FAIL;
+    }
+
+    seg->count++;
+    s_next_seq++;
+    s_stats.appended++;
+    return ESP_OK;
+}
+
+size_t upload_journal_read(health_data_t *out, size_t max)
+{
+    s_read_count = 0;
+    s_read_end = s_cursor;
+    if (!s_ready || !out || max == 0)
+    {
+        return 0;
+    }
+    if (max > UPLOAD_JOURNAL_READ_MAX)
+    {
+        max = UPLOAD_JOURNAL_READ_MAX;
+    }
+
+    size_t n = 0;
+    uint32_t seq = s_cursor;
+    char path[JNL_PATH_LEN];
+    for (size_t i = 0; i < s_seg_count && n < max; ++i)
+    {
+        const jnl_segment_t *seg = &s_segs[i];
+        if (seg_end(seg) <= seq)
+        {
+            continue;
+        }
+        if (seq < seg->first_seq)
+        {
+            seq = seg->first_seq;
+        }
+        seg_path(path, sizeof(path), seg->id);
+        FILE *f = fopen(path, "rb");
+        if (!f || fseek(f, (long)((seq - seg->first_seq) * sizeof(jnl_frame_t)), SEEK_SET) != 0)
+        {
+            /* 段不可读：整段按损坏跳过 */
+            s_stats.corrupt += seg_end(seg) - seq;
+            seq = seg_end(seg);
+            if (f)
+            {
+                fclose(f);
+            }
+            continue;
+        }
+        while (seq < seg_end(seg) && n < max)
+        {
+            jnl_frame_t fr;
+            const bool got = fread(&fr, sizeof(fr), 1, f) == 1;
+            if (!got || !frame_valid(&fr, seq))
+            {
+                s_stats.corrupt++;
+                seq++;
+                continue;
+            }
+            out[n] = fr.item;
+            s_read_seq[n] = seq;
+            n++;
+            seq++;
+        }
+        fclose(f);
+    }
+
+    if (n == 0)
+    {
+        s_cursor = seq;   /* 只跳过了损坏帧，游标直接越过 */
+    }
+    s_read_count = n;
+    s_read_end = seq;
+    return n;
+}
+
+esp_err_t upload_journal_ack(size_t n)
+{
+    if (!s_ready)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (n > s_read_count)
+    {
+        n = s_read_count;
+    }
+    if (n == 0)
+    {
+        return ESP_OK;
+    }
+
+    s_cursor = (n < s_read_count) ? s_read_seq[n] : s_read_end;
+    s_read_count = 0;
+    s_stats.acked += (uint32_t)n;
+    const esp_err_t err = cursor_store();
+    drop_acked_segments();
+    return err;
+}
+
+uint32_t upload_journal_pending(void)
+{
+    uint32_t pending = 0;
+    for (size_t i = 0; i < s_seg_count; ++i)
+    {
+        pending += seg_pending(&s_segs[i]);
+    }
+    return pending;
+}
+
+void upload_journal_get_stats(upload_journal_stats_t *out)
+{
+    if (!out)
+    {
+        return;
+    }
+    *out = s_stats;
+    out->pending = upload_journal_pending();
+    out->segments = (uint32_t)s_seg_count;
+}
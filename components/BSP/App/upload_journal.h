@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "http_request.h"
+
+/*
+ * 上传日志（SD 卡 /sdcard/UPQ）：断网、重启期间待上传 epoch 的持久队列
+ *
+ * - 只追加：每个 epoch 一帧 {magic, seq, health_data_t, crc32}，写入后 fsync
+ * - 分段：每段 UPLOAD_JOURNAL_SEGMENT_RECORDS 帧，一个文件（<段号>.JNL），
+ *   超过 UPLOAD_JOURNAL_MAX_SEGMENTS 段时整段删除最旧者（未上传的部分计入 evicted）
+ * - 读游标：已被服务器确认的下一条 seq，A/B 两槽轮流写入 CURSOR.BIN 并带 CRC，
+ *   只在服务器确认后推进，重启后从游标处续传（服务器按 ts 去重，掉电重发是幂等的）
+ * - 恢复：启动时逐段校验帧，段尾撕裂（写一半掉电）的帧丢弃，之后的追加另起新段
+ * 纯单任务使用，不加锁，仅由上传任务访问。
+ */
+
+#define UPLOAD_JOURNAL_SEGMENT_RECORDS 240U   /* 每段2小时 */
+#define UPLOAD_JOURNAL_MAX_SEGMENTS    24U    /* 上限约48小时、400KB */
+#define UPLOAD_JOURNAL_READ_MAX        32U    /* 单次读取上限，与上传单批条数一致 */
+
+typedef struct
+{
+    uint32_t pending;            /* 未确认条数 */
+    uint32_t appended;           /* 本次运行追加条数 */
+    uint32_t acked;              /* 本次运行确认条数 */
+    uint32_t evicted;            /* 超出上限被淘汰的未确认条数 */
+    uint32_t corrupt;            /* 校验失败跳过的帧数 */
+    uint32_t segments;
+    uint32_t write_errors;
+} upload_journal_stats_t;
+
+/* 打开/恢复日志（挂载SD）；SD 不可用返回错误，调用方退回仅内存缓冲 */
+esp_err_t upload_journal_init(void);
+
+bool upload_journal_ready(void);
+
+/* 追加一条并落盘 */
+esp_err_t upload_journal_append(const health_data_t *item);
+
+/**
+ * @brief 从游标处读取最多 max 条未确认数据（不移动游标）
+ * @return 读到的条数；之后以 upload_journal_ack 确认其中的前若干条
+ */
+size_t upload_journal_read(health_data_t *out, size_t max);
+
+/* 确认最近一次 read 结果的前 n 条，推进并持久化游标，删除已全部确认的旧段 */
+esp_err_t upload_journal_ack(size_t n);
+
+uint32_t upload_journal_pending(void);
+
+void upload_journal_get_stats(upload_journal_stats_t *out);
@@ -0,0 +1,473 @@
+#include "alarm_json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ALARM_WINDOW_MAX_MINUTES 120
+
+/* 语法状态 */
+enum {
+    ST_VALUE = 0,        /* 期待一个值 */
+    ST_VALUE_OR_END,     /* '[' 之后 */
+    ST_KEY_OR_END,       /* '{' 之后 */
+    ST_KEY,              /* 对象中 ',' 之后 */
+    ST_COLON,
+    ST_COMMA_OR_END,
+    ST_DONE,             /* 根值结束，只允许空白 */
+};
+
+/* 词法状态 */
+enum {
+    LEX_NONE = 0,
+    LEX_STRING,
+    LEX_ESCAPE,
+    LEX_UNICODE,
+    LEX_NUMBER,
+    LEX_LITERAL,
+};
+
+/* 目标路径各层：1 根对象，2 data 对象，3 alarms 数组，4 闹钟对象，5 repeatDays 数组 */
+enum {
+    LVL_ROOT = 1,
+    LVL_DATA,
+    LVL_ALARMS,
+    LVL_ITEM,
+    LVL_REPEAT,
+};
+
+static int weekday_index_from_number(int num)
+{
+    if (num < 1 || num > 7) {
+        return -1;
+    }
+    return (num == 7) ? 6 : (num - 1);
+}
+
+static uint8_t parse_repeat_mask_from_string(const char *str)
+{
+    if (!str) {
+        return 0;
+    }
+
+    uint8_t mask = 0;
+    const char *p = str;
+    while (*p) {
+        while (*p == ' ' || *p == ',' || *p == ';') {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+        int val = atoi(p);
+        int idx = weekday_index_from_number(val);
+        if (idx >= 0) {
+            mask |= (1U << idx);
+        }
+        while (*p && *p != ',' && *p != ';') {
+            p++;
+        }
+    }
+    return mask;
+}
+
+/* 截断复制（记号缓冲比目标字段长） */
+static void copy_field(char *dst, size_t cap, const char *src)
+{
+    const size_t n = strnlen(src, cap - 1);
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+}
+
+static bool is_object(const alarm_json_parser_t *p)
+{
+    return (p->is_object >> p->depth) & 1U;
+}
+
+static bool key_is(const alarm_json_parser_t *p, const char *name)
+{
+    return strcmp(p->key, name) == 0;
+}
+
+/* repeatDays 数组的一个元素 */
+static void repeat_add_day(alarm_json_parser_t *p, int val)
+{
+    alarm_info_t *dst = p->cur;
+    int idx = weekday_index_from_number(val);
+    if (idx < 0) {
+        return;
+    }
+    dst->repeat_mask |= (uint8_t)(1U << idx);
+    const size_t cap = sizeof(dst->repeat_days);
+    if (p->repeat_len < cap - 1) {
+        int n = snprintf(dst->repeat_days + p->repeat_len, cap - p->repeat_len,
+                         (p->repeat_len > 0) ? ",%d" : "%d", val);
+        if (n > 0) {
+            p->repeat_len = (uint8_t)((p->repeat_len + (size_t)n < cap) ? p->repeat_len + (size_t)n : cap);
+        }
+    }
+}
+
+static void field_number(alarm_json_parser_t *p)
+{
+    if (p->match == LVL_DATA) {
+        return;     /* 命令只接受字符串 */
+    }
+    const int val = (int)strtol(p->token, NULL, 10);
+    if (p->match == LVL_REPEAT) {
+        repeat_add_day(p, val);
+        return;
+    }
+
+    alarm_info_t *dst = p->cur;
+    if (key_is(p, "id")) {
+        dst->id = val;
+    } else if (key_is(p, "type")) {
+        dst->type = (alarm_type_t)val;
+    } else if (key_is(p, "status")) {
+        dst->status = val;
+    } else if (key_is(p, "smartWindow") && val > 0) {
+        dst->window_minutes = (uint16_t)((val > ALARM_WINDOW_MAX_MINUTES) ? ALARM_WINDOW_MAX_MINUTES : val);
+    }
+}
+
+static void field_string(alarm_json_parser_t *p)
+{
+    if (p->match == LVL_DATA) {
+        copy_field(p->command, sizeof(p->command), p->token);
+        return;
+    }
+    if (p->match == LVL_REPEAT) {
+        repeat_add_day(p, atoi(p->token));
+        return;
+    }
+
+    alarm_info_t *dst = p->cur;
+    if (key_is(p, "alarmTime")) {
+        copy_field(dst->alarm_time, sizeof(dst->alarm_time), p->token);
+    } else if (key_is(p, "targetDate")) {
+        copy_field(dst->target_date, sizeof(dst->target_date), p->token);
+    } else if (key_is(p, "repeatDays")) {
+        copy_field(dst->repeat_days, sizeof(dst->repeat_days), p->token);
+        dst->repeat_mask = parse_repeat_mask_from_string(p->token);
+    }
+}
+
+/* 当前深度的标量值是否需要保存：data.command、闹钟对象的字段或 repeatDays 的元素 */
+static bool want_value(const alarm_json_parser_t *p)
+{
+    if (p->depth == LVL_DATA) {
+        return p->match == LVL_DATA && key_is(p, "command");
+    }
+    return p->cur && p->match == p->depth && p->depth >= LVL_ITEM;
+}
+
+static void value_done(alarm_json_parser_t *p)
+{
+    p->state = (p->depth == 0) ? ST_DONE : ST_COMMA_OR_END;
+}
+
+static void token_put(alarm_json_parser_t *p, char c)
+{
+    if (!p->capture) {
+        return;
+    }
+    if (p->in_key) {
+        if (p->key_len + 1 < sizeof(p->key)) {
+            p->key[p->key_len++] = c;
+        } else {
+            p->key_overflow = true;
+        }
+    } else if (p->token_len + 1 < sizeof(p->token)) {
+        p->token[p->token_len++] = c;
+    }
+}
+
+static void string_begin(alarm_json_parser_t *p, bool key)
+{
+    p->lex = LEX_STRING;
+    p->in_key = key;
+    p->token_len = 0;
+    if (key) {
+        /* 只有路径匹配的对象才需要键名 */
+        p->capture = p->match == p->depth;
+        p->key_len = 0;
+        p->key_overflow = false;
+        if (p->capture) {
+            p->key[0] = '\0';
+        }
+    } else {
+        p->capture = want_value(p);
+    }
+}
+
+static void string_done(alarm_json_parser_t *p)
+{
+    p->lex = LEX_NONE;
+    if (p->in_key) {
+        if (p->capture) {
+            p->key[p->key_overflow ? 0 : p->key_len] = '\0';
+        }
+        p->in_key = false;
+        p->state = ST_COLON;
+        return;
+    }
+    if (p->capture) {
+        p->token[p->token_len] = '\0';
+        field_string(p);
+    }
+    value_done(p);
+}
+
+static void number_done(alarm_json_parser_t *p)
+{
+    p->lex = LEX_NONE;
+    if (p->capture) {
+        p->token[p->token_len] = '\0';
+        field_number(p);
+    }
+    value_done(p);
+}
+
+static bool container_open(alarm_json_parser_t *p, bool object)
+{
+    if (p->depth + 1 >= ALARM_JSON_MAX_DEPTH) {
+        return false;
+    }
+    /* 键属于父对象，进入子容器前判断路径 */
+    const bool parent_matched = p->match == p->depth;
+    p->depth++;
+    p->is_object = object ? (p->is_object | (1U << p->depth)) : (p->is_object & ~(1U << p->depth));
+    p->state = object ? ST_KEY_OR_END : ST_VALUE_OR_END;
+    if (!parent_matched) {
+        return true;
+    }
+
+    bool enter = false;
+    switch (p->depth) {
+        case LVL_ROOT:
+            enter = object;
+            break;
+        case LVL_DATA:
+            enter = object && key_is(p, "data");
+            break;
+        case LVL_ALARMS:
+            enter = !object && key_is(p, "alarms");
+            p->seen_alarms |= enter;
+            break;
+        case LVL_ITEM:
+            enter = object;
+            if (enter) {
+                alarm_list_t *out = p->out;
+                if (out->count < ALARM_MAX_COUNT) {
+                    p->cur = &out->items[out->count];
+                    memset(p->cur, 0, sizeof(*p->cur));
+                    p->cur->type = ALARM_TYPE_ONCE;
+                    p->cur->status = 1;
+                } else {
+                    p->cur = NULL;
+                    p->truncated = true;
+                }
+            }
+            break;
+        case LVL_REPEAT:
+            enter = !object && p->cur && key_is(p, "repeatDays");
+            if (enter) {
+                p->cur->repeat_days[0] = '\0';
+                p->cur->repeat_mask = 0;
+                p->repeat_len = 0;
+            }
+            break;
+        default:
+            break;
+    }
+    if (enter) {
+        p->match = p->depth;
+    }
+    return true;
+}
+
+static bool container_close(alarm_json_parser_t *p, bool object)
+{
+    if (p->depth == 0 || is_object(p) != object) {
+        return false;
+    }
+    if (p->match == p->depth) {
+        if (p->depth == LVL_ITEM && p->cur) {
+            p->out->count++;
+            p->cur = NULL;
+        }
+        p->match--;
+    }
+    p->depth--;
+    value_done(p);
+    return true;
+}
+
+static bool value_begin(alarm_json_parser_t *p, char c)
+{
+    if (c == '{' || c == '[') {
+        return container_open(p, c == '{');
+    }
+    if (c == '"') {
+        string_begin(p, false);
+        return true;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        p->lex = LEX_NUMBER;
+        p->in_key = false;
+        p->token_len = 0;
+        p->capture = want_value(p);
+        token_put(p, c);
+        return true;
+    }
+    p->lex = LEX_LITERAL;
+    p->literal = (c == 't') ? "rue" : (c == 'f') ? "alse" : (c == 'n') ? "ull" : NULL;
+    return p->literal != NULL;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool step(alarm_json_parser_t *p, char c)
+{
+    switch (p->lex) {
+        case LEX_STRING:
+            if (c == '"') {
+                string_done(p);
+            } else if (c == '\\') {
+                p->lex = LEX_ESCAPE;
+            } else if ((unsigned char)c < 0x20U) {
+                return false;
+            } else {
+                token_put(p, c);
+            }
+            return true;
+        case LEX_ESCAPE: {
+            static const char from[] = "\"\\/bfnrt";
+            static const char to[] = "\"\\/\b\f\n\r\t";
+            const char *hit = (c != '\0') ? strchr(from, c) : NULL;
+            p->lex = LEX_STRING;
+            if (c == 'u') {
+                p->lex = LEX_UNICODE;
+                p->unicode_left = 4;
+                p->unicode = 0;
+            } else if (hit) {
+                token_put(p, to[hit - from]);
+            } else {
+                return false;
+            }
+            return true;
+        }
+        case LEX_UNICODE: {
+            const int v = hex_value(c);
+            if (v < 0) {
+                return false;
+            }
+            p->unicode = (uint16_t)((p->unicode << 4) | (unsigned)v);
+            if (--p->unicode_left == 0) {
+                /* 关心的字段都是 ASCII，其余码点以 '?' 占位 */
+                token_put(p, (p->unicode < 0x80U) ? (char)p->unicode : '?');
+                p->lex = LEX_STRING;
+            }
+            return true;
+        }
+        case LEX_NUMBER:
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                token_put(p, c);
+                return true;
+            }
+            number_done(p);
+            break;   /* 结束数字的字符按结构字符继续处理 */
+        case LEX_LITERAL:
+            if (c != *p->literal) {
+                return false;
+            }
+            if (*++p->literal == '\0') {
+                p->lex = LEX_NONE;
+                value_done(p);
+            }
+            return true;
+        default:
+            break;
+    }
+
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+        return true;
+    }
+    switch (p->state) {
+        case ST_VALUE_OR_END:
+            if (c == ']') {
+                return container_close(p, false);
+            }
+            return value_begin(p, c);
+        case ST_VALUE:
+            return value_begin(p, c);
+        case ST_KEY_OR_END:
+            if (c == '}') {
+                return container_close(p, true);
+            }
+            /* fall through */
+        case ST_KEY:
+            if (c != '"') {
+                return false;
+            }
+            string_begin(p, true);
+            return true;
+        case ST_COLON:
+            if (c != ':') {
+                return false;
+            }
+            p->state = ST_VALUE;
+            return true;
+        case ST_COMMA_OR_END:
+            if (c == ',') {
+                p->state = is_object(p) ? ST_KEY : ST_VALUE;
+                return true;
+            }
+            if (c == '}' || c == ']') {
+                return container_close(p, c == '}');
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+void alarm_json_init(alarm_json_parser_t *p, alarm_list_t *out)
+{
+    memset(p, 0, sizeof(*p));
+    p->out = out;
+    memset(out, 0, sizeof(*out));
+}
+
+esp_err_t alarm_json_feed(alarm_json_parser_t *p, const char *data, size_t len)
+{
+    if (p->error) {
+        return ESP_FAIL;
+    }
+    p->bytes += len;
+    for (size_t i = 0; i < len; ++i) {
+        if (!step(p, data[i])) {
+            p->error = true;
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t alarm_json_finish(alarm_json_parser_t *p)
+{
+    if (!p->error && p->lex == LEX_NUMBER) {
+        number_done(p);
+    }
+    if (p->error || p->lex != LEX_NONE || p->state != ST_DONE || !p->seen_alarms) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,59 @@
+#ifndef ALARM_JSON_H
+#define ALARM_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "http_request.h"
+
+/*
+ * 闹钟列表的流式 JSON 解析：由 HTTP_EVENT_ON_DATA 分块喂入，逐字符扫描，
+ * 直接填写 alarm_list_t，不缓存响应、不建树，内存与响应长度无关。
+ *
+ * 只提取 {"data":{"alarms":[{...}, ...]}} 中各闹钟的 id、type、alarmTime、targetDate、
+ * repeatDays（字符串 "1,3,5" 或数组）、status、smartWindow，其余字段与嵌套结构跳过；
+ * 超过 ALARM_MAX_COUNT 的闹钟丢弃。字段缺省值与语义同 cJSON 版本。
+ * 推送通道的响应可在 data 下带一条设备命令 "command":"<名称>"，保存在 command 中。
+ */
+
+#define ALARM_JSON_MAX_DEPTH  32      /* 嵌套深度上限，超过视为格式错误 */
+#define ALARM_JSON_KEY_LEN    16      /* 只需区分上述字段名，更长的键不会匹配 */
+#define ALARM_JSON_TOKEN_LEN  ALARM_REPEAT_STR_LEN
+#define ALARM_JSON_CMD_LEN    24      /* 设备命令名，超长截断 */
+
+typedef struct {
+    alarm_list_t *out;
+    alarm_info_t *cur;                  /* 正在填写的闹钟，超出上限时为 NULL */
+    uint8_t state;                      /* 语法状态 */
+    uint8_t lex;                        /* 词法状态：字符串/转义/\u/数字/字面量 */
+    uint8_t depth;                      /* 当前容器深度，根对象为 1 */
+    uint8_t match;                      /* 与 data.alarms[*].repeatDays 路径匹配的层数 */
+    uint32_t is_object;                 /* 按深度的位图：1 对象，0 数组 */
+    bool in_key;                        /* 正在读的字符串是键 */
+    bool capture;                       /* 当前记号需要保存 */
+    bool key_overflow;
+    bool seen_alarms;
+    bool truncated;
+    bool error;
+    uint8_t repeat_len;                 /* repeatDays 数组已写入文本长度 */
+    uint8_t unicode_left;               /* \uXXXX 剩余的十六进制位数 */
+    uint16_t unicode;
+    const char *literal;                /* true/false/null 剩余待匹配的字符 */
+    size_t token_len;
+    size_t key_len;
+    char key[ALARM_JSON_KEY_LEN];
+    char token[ALARM_JSON_TOKEN_LEN];
+    size_t bytes;                       /* 已喂入的字节数 */
+    char command[ALARM_JSON_CMD_LEN];   /* data.command，无则为空串 */
+} alarm_json_parser_t;
+
+void alarm_json_init(alarm_json_parser_t *p, alarm_list_t *out);
+
+/* 喂入一块响应数据；格式错误后返回 ESP_FAIL，之后的数据被忽略 */
+esp_err_t alarm_json_feed(alarm_json_parser_t *p, const char *data, size_t len);
+
+/* 响应结束：文档完整且包含 data.alarms 数组时返回 ESP_OK */
+esp_err_t alarm_json_finish(alarm_json_parser_t *p);
+
+#endif // ALARM_JSON_H
@@ -0,0 +1,236 @@
+#include "gzip_stream.h"
+
+#include <string.h>
+#include "esp_rom_crc.h"
+
+#define GZ_NIL       0xFFFFU
+#define GZ_HASH_SIZE (1U << GZ_HASH_BITS)
+
+/* 长度码 257..285 的基值与扩展位数 */
+static const uint16_t s_len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const uint8_t s_len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+/* 距离码 0..29 */
+static const uint16_t s_dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+static const uint8_t s_dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+static void put_byte(gz_stream_t *z, uint8_t b)
+{
+    if (z->len < z->cap) {
+        z->out[z->len++] = b;
+    } else {
+        z->overflow = true;
+    }
+}
+
+/* 低位先出（扩展位、块头） */
+static void put_bits(gz_stream_t *z, uint32_t value, uint32_t n)
+{
+    z->bits |= value << z->nbits;
+    z->nbits += n;
+    while (z->nbits >= 8U) {
+        put_byte(z, (uint8_t)z->bits);
+        z->bits >>= 8;
+        z->nbits -= 8U;
+    }
+}
+
+/* Huffman 码高位先出，按位反转后写入 */
+static void put_code(gz_stream_t *z, uint32_t code, uint32_t n)
+{
+    uint32_t rev = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        rev = (rev << 1) | ((code >> i) & 1U);
+    }
+    put_bits(z, rev, n);
+}
+
+/* 固定码表中的字面量/长度符号 0..287 */
+static void put_symbol(gz_stream_t *z, uint32_t sym)
+{
+    if (sym < 144U) {
+        put_code(z, 0x30U + sym, 8);
+    } else if (sym < 256U) {
+        put_code(z, 0x190U + (sym - 144U), 9);
+    } else if (sym < 280U) {
+        put_code(z, sym - 256U, 7);
+    } else {
+        put_code(z, 0xC0U + (sym - 280U), 8);
+    }
+}
+
+static void put_match(gz_stream_t *z, uint32_t len, uint32_t dist)
+{
+    uint32_t i = 28;
+    while (s_len_base[i] > len) {
+        i--;
+    }
+    put_symbol(z, 257U + i);
+    put_bits(z, len - s_len_base[i], s_len_extra[i]);
+
+    uint32_t d = 29;
+    while (s_dist_base[d] > dist) {
+        d--;
+    }
+    put_code(z, d, 5);
+    put_bits(z, dist - s_dist_base[d], s_dist_extra[d]);
+}
+
+static uint32_t hash3(const uint8_t *p)
+{
+    const uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761U) >> (32U - GZ_HASH_BITS);
+}
+
+static void insert(gz_stream_t *z, size_t pos)
+{
+    const uint32_t h = hash3(&z->win[pos]);
+    z->prev[pos & (GZ_WINDOW - 1U)] = z->head[h];
+    z->head[h] = (uint16_t)pos;
+}
+
+/* 编码 win 中的数据；非 flush 时保留 GZ_MAX_MATCH 字节前瞻，等后续输入 */
+static void compress(gz_stream_t *z, bool flush)
+{
+    while (z->pos < z->fill && (flush || z->fill - z->pos >= GZ_MAX_MATCH)) {
+        const size_t pos = z->pos;
+        const size_t avail = z->fill - pos;
+        size_t best_len = 0;
+        size_t best_dist = 0;
+
+        if (avail >= GZ_MIN_MATCH) {
+            const size_t max_len = (avail < GZ_MAX_MATCH) ? avail : GZ_MAX_MATCH;
+            uint16_t cand = z->head[hash3(&z->win[pos])];
+            insert(z, pos);
+            for (int chain = GZ_MAX_CHAIN; chain > 0 && cand != GZ_NIL; --chain) {
+                /* 距离小于窗口的候选其链表项未被覆盖，链严格递减 */
+                if (cand >= pos || pos - cand >= GZ_WINDOW) {
+                    break;
+                }
+                const uint8_t *a = &z->win[cand];
+                const uint8_t *b = &z->win[pos];
+                if (a[best_len] == b[best_len]) {
+                    size_t l = 0;
+                    while (l < max_len && a[l] == b[l]) {
+                        l++;
+                    }
+                    if (l > best_len) {
+                        best_len = l;
+                        best_dist = pos - cand;
+                        if (l == max_len) {
+                            break;
+                        }
+                    }
+                }
+                const uint16_t next = z->prev[cand & (GZ_WINDOW - 1U)];
+                if (next >= cand) {
+                    break;
+                }
+                cand = next;
+            }
+        }
+
+        if (best_len >= GZ_MIN_MATCH) {
+            put_match(z, (uint32_t)best_len, (uint32_t)best_dist);
+            for (size_t i = 1; i < best_len; ++i) {
+                if (pos + i + GZ_MIN_MATCH <= z->fill) {
+                    insert(z, pos + i);
+                }
+            }
+            z->pos += best_len;
+        } else {
+            put_symbol(z, z->win[pos]);
+            z->pos++;
+        }
+    }
+}
+
+/* 输入缓冲满时丢弃最旧的一个窗口，位置整体前移 */
+static void slide(gz_stream_t *z)
+{
+    memmove(z->win, z->win + GZ_WINDOW, GZ_WINDOW);
+    z->fill -= GZ_WINDOW;
+    z->pos -= GZ_WINDOW;
+    for (size_t i = 0; i < GZ_HASH_SIZE; ++i) {
+        z->head[i] = (z->head[i] != GZ_NIL && z->head[i] >= GZ_WINDOW) ? (uint16_t)(z->head[i] - GZ_WINDOW) : GZ_NIL;
+    }
+    for (size_t i = 0; i < GZ_WINDOW; ++i) {
+        z->prev[i] = (z->prev[i] != GZ_NIL && z->prev[i] >= GZ_WINDOW) ? (uint16_t)(z->prev[i] - GZ_WINDOW) : GZ_NIL;
+    }
+}
+
+void gz_init(gz_stream_t *z, uint8_t *out, size_t cap)
+{
+    z->out = out;
+    z->cap = cap;
+    z->len = 0;
+    z->overflow = false;
+    z->bits = 0;
+    z->nbits = 0;
+    z->crc = 0;
+    z->total_in = 0;
+    z->fill = 0;
+    z->pos = 0;
+    memset(z->head, 0xFF, sizeof(z->head));
+    memset(z->prev, 0xFF, sizeof(z->prev));
+
+    /* ID1 ID2 CM=deflate FLG=0 MTIME=0 XFL=0 OS=unknown */
+    static const uint8_t header[10] = {0x1F, 0x8B, 0x08, 0, 0, 0, 0, 0, 0, 0xFF};
+    for (size_t i = 0; i < sizeof(header); ++i) {
+        put_byte(z, header[i]);
+    }
+    put_bits(z, 0, 1);     /* BFINAL=0，结束时另写一个空的末块 */
+    put_bits(z, 1, 2);     /* BTYPE=01 固定码表 */
+}
+
+esp_err_t gz_write(gz_stream_t *z, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    z->crc = esp_rom_crc32_le(z->crc, p, (uint32_t)len);
+    z->total_in += (uint32_t)len;
+    while (len > 0 && !z->overflow) {
+        if (z->fill == sizeof(z->win)) {
+            slide(z);
+        }
+        size_t n = sizeof(z->win) - z->fill;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(z->win + z->fill, p, n);
+        z->fill += n;
+        p += n;
+        len -= n;
+        compress(z, false);
+    }
+    return z->overflow ? ESP_ERR_INVALID_SIZE : ESP_OK;
+}
+
+size_t gz_finish(gz_stream_t *z)
+{
+    compress(z, true);
+    put_symbol(z, 256);    /* 块结束 */
+    put_bits(z, 1, 1);     /* 空的末块 */
+    put_bits(z, 1, 2);
+    put_symbol(z, 256);
+    if (z->nbits > 0) {
+        put_bits(z, 0, 8U - z->nbits);
+    }
+    for (int i = 0; i < 4; ++i) {
+        put_byte(z, (uint8_t)(z->crc >> (8 * i)));
+    }
+    for (int i = 0; i < 4; ++i) {
+        put_byte(z, (uint8_t)(z->total_in >> (8 * i)));
+    }
+    return z->overflow ? 0 : z->len;
+}
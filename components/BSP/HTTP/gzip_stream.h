@@ -0,0 +1,49 @@
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * 流式 gzip（RFC 1952/1951）压缩：分块喂入，直接写入调用方的定长输出缓冲，不分配堆。
+ *
+ * - LZ77 贪心匹配，匹配距离不超过 GZ_WINDOW，哈希链每次最多比较 GZ_MAX_CHAIN 个候选
+ * - 固定 Huffman 码表（BTYPE=01），无需统计与传码表，适合几 KB 的请求体
+ * - 状态约 10 KB（2×窗口输入缓冲 + 哈希表 + 链表），与输入总长无关
+ * 输出缓冲不足时置溢出标志并停止写入，gz_finish 返回 0，调用方改为不压缩发送。
+ */
+
+#define GZ_WINDOW      2048U     /* 匹配窗口（2 的幂） */
+#define GZ_HASH_BITS   10
+#define GZ_MAX_CHAIN   16
+#define GZ_MIN_MATCH   3U
+#define GZ_MAX_MATCH   258U
+
+typedef struct {
+    uint8_t *out;
+    size_t cap;
+    size_t len;
+    bool overflow;
+    uint32_t bits;                      /* 待输出的位，低位先出 */
+    uint32_t nbits;
+    uint32_t crc;                       /* 原文 CRC-32 */
+    uint32_t total_in;
+    size_t fill;                        /* win 中已有的字节数 */
+    size_t pos;                         /* 下一个待编码的位置 */
+    uint8_t win[2U * GZ_WINDOW];
+    uint16_t head[1U << GZ_HASH_BITS];  /* 哈希 -> 最近位置 */
+    uint16_t prev[GZ_WINDOW];           /* 位置 -> 同哈希的上一位置 */
+} gz_stream_t;
+
+/* 写入 gzip 头并开始压缩块 */
+void gz_init(gz_stream_t *z, uint8_t *out, size_t cap);
+
+/* 喂入一块原文；输出缓冲已满返回 ESP_ERR_INVALID_SIZE */
+esp_err_t gz_write(gz_stream_t *z, const void *data, size_t len);
+
+/* 编码剩余数据并写入 gzip 尾，返回输出总字节数；溢出返回 0 */
+size_t gz_finish(gz_stream_t *z);
+
+#endif // GZIP_STREAM_H
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <ctype.h>
+#include <strings.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
@@ -14,8 +15,13 @@
 #include "esp_log.h"
 #include "esp_http_client.h"
 #include "esp_netif.h"
-#include "cJSON.h"
+#include "esp_timer.h"
+#include "esp_random.h"
 #include "http_request.h"
+#include "telemetry_codec.h"
+#include "alarm_json.h"
+#include "net_worker.h"
+#include "gzip_stream.h"
 
 #define TAG "HTTP_CLIENT"
 
@@ -27,31 +33,96 @@
 
 // 服务器配置
 #define SERVER_URL     "http://192.168.1.108:6060/api/health/upload"
+#define BATCH_UPLOAD_URL  "http://192.168.1.108:6060/api/health/upload/batch"
+#define NIGHT_SUMMARY_URL "http://192.168.1.108:6060/api/health/night"
+#define HTTP_UPLOAD_KEEP_ALIVE   1     /* 0: 每次上传新建并释放客户端（旧行为，用于对比延迟与堆占用） */
+#define HTTP_UPLOAD_STATS_PERIOD 20    /* 每N次上传输出一次连接复用统计 */
+#define HTTP_UPLOAD_RESP_MAX     128   /* 上传响应只需读取确认字段 */
+#define HTTP_UPLOAD_BODY_MAX     6144  /* 编码缓冲：32 条 epoch 的 JSON 约 4KB */
+#define HTTP_UPLOAD_FORMAT       TELEMETRY_FORMAT_CBOR   /* 首选格式，服务器 415 时退回 JSON */
+#define HTTP_UPLOAD_GZIP         1     /* 0: 请求体一律不压缩 */
+#define HTTP_GZIP_MIN_BYTES      512   /* 小于此长度的请求体不压缩（gzip 头尾 18 字节，单条 epoch 压不小） */
 
 #define ALARM_DEFAULT_HOST   "192.168.1.108"
 #define ALARM_DEFAULT_PORT   6060
 #define ALARM_FETCH_PERIOD_MS 60000
-#define ALARM_TASK_STACK      6144
+#define ALARM_TASK_STACK      3072   /* 监视任务只做计算与回调，网络请求交给网络任务 */
 #define ALARM_TASK_PRIO       4
+#define ALARM_STATUS_ATTEMPTS 5      /* 状态回写失败重试（退避约 1+2+4+8 s） */
+#define ALARM_ETAG_MAX        64     /* 超长的 ETag 不保存，退回内容哈希比较 */
+#define ALARM_PUSH_ENABLE     1      /* 0: 只用周期轮询 */
+#define ALARM_PUSH_WAIT_S     25     /* 长轮询挂起时长，小于常见 NAT/代理的空闲超时 */
+#define ALARM_PUSH_TASK_STACK 4096   /* 长轮询任务：独立连接挂起请求，不占用网络任务 */
+#define ALARM_PUSH_TASK_PRIO  3
+#define ALARM_PUSH_MIN_HOLD_MS 2000  /* 未变化却早于此时间返回，视为服务器不支持挂起 */
+#define ALARM_PUSH_SHORT_LIMIT 3     /* 连续几次未挂起即退回轮询 */
+#define ALARM_PUSH_FAIL_LIMIT  6     /* 连续几次失败即退回轮询（退避约 31s 后） */
+#define ALARM_PUSH_IDLE_RETRY_MS 1000 /* 未挂起即返回时再次发起前的间隔 */
+#define ALARM_PUSH_RETRY_MS   600000 /* 退回轮询后隔多久再尝试推送 */
 
 static EventGroupHandle_t s_wifi_event_group;
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT      BIT1
 static int s_retry_num = 0;
-static TaskHandle_t s_wifi_reconnect_task = NULL;
-
-static void wifi_reconnect_task(void *arg);
+static int64_t s_wifi_reconnect_us = 0;
 
 static char s_alarm_host[64] = ALARM_DEFAULT_HOST;
 static uint16_t s_alarm_port = ALARM_DEFAULT_PORT;
 static char s_alarm_user[32] = "user123";
 static uint32_t s_alarm_fetch_period_ms = ALARM_FETCH_PERIOD_MS;
 static alarm_list_t s_alarm_list = {0};
+
+/* 条件拉取：上次成功拉取的 ETag 与正文哈希，列表未变时跳过复制与日志 */
+static char s_alarm_etag[ALARM_ETAG_MAX];
+static uint32_t s_alarm_hash = 0;
+static bool s_alarm_hash_valid = false;
+static http_alarm_fetch_stats_t s_alarm_fetch_stats = {0};
 static SemaphoreHandle_t s_alarm_mutex = NULL;
-static TaskHandle_t s_alarm_fetch_task = NULL;
 static TaskHandle_t s_alarm_monitor_task = NULL;
+static bool s_alarm_started = false;
+/* 闹钟接口的 keep-alive 连接：网络任务（轮询、状态回写）与长轮询任务各用一条 */
+typedef struct alarm_fetch_ctx alarm_fetch_ctx_t;
+typedef struct {
+    esp_http_client_handle_t client;
+    bool connected;              /* 本次请求是否新建了 TCP 连接 */
+    bool rx;                     /* 本次请求是否已收到响应 */
+    alarm_fetch_ctx_t *fetch;    /* 拉取时的解析上下文，其余请求为 NULL */
+} alarm_conn_t;
+static alarm_conn_t s_alarm_conn;
+static alarm_conn_t s_push_conn;
+/* ETag/哈希与拉取统计由两个任务共同更新 */
+static SemaphoreHandle_t s_alarm_fetch_lock = NULL;
+static alarm_list_t *s_alarm_latest = NULL;   /* 网络任务 */
+static alarm_list_t *s_push_latest = NULL;    /* 长轮询任务 */
+static TaskHandle_t s_alarm_push_task = NULL;
+static uint32_t s_push_failures = 0;
+static uint32_t s_push_short_holds = 0;
+/* 轮询链已提交（排队或执行中）；长轮询任务与网络任务都会读写，用原子操作，至多存在一条链 */
+static bool s_poll_chain_pending = false;
 static alarm_trigger_cb_t s_alarm_cb = NULL;
 static void *s_alarm_cb_ctx = NULL;
+static alarm_command_cb_t s_command_cb = NULL;
+static void *s_command_cb_ctx = NULL;
+
+/* 智能唤醒：窗口是否激活，以及最近一次浅睡信号 */
+static volatile bool s_wake_window_active = false;
+static volatile time_t s_sleep_signal_ts = 0;
+static volatile alarm_sleep_signal_t s_sleep_signal = ALARM_SLEEP_SIGNAL_REM;
+
+/* 上传长连接（仅上传任务使用，互斥锁防止并发调用） */
+static esp_http_client_handle_t s_upload_client = NULL;
+static SemaphoreHandle_t s_upload_mutex = NULL;
+static volatile bool s_upload_connected = false;   /* 本次请求是否新建了 TCP 连接 */
+static http_upload_stats_t s_upload_stats = {.format = HTTP_UPLOAD_FORMAT, .gzip = HTTP_UPLOAD_GZIP};
+static uint64_t s_upload_latency_sum_ms = 0;
+static char s_upload_resp[HTTP_UPLOAD_RESP_MAX];
+static uint8_t s_upload_body[HTTP_UPLOAD_BODY_MAX];
+static telemetry_format_t s_upload_format = HTTP_UPLOAD_FORMAT;
+/* gzip 请求体：压缩状态与输出缓冲静态分配，服务器拒收压缩（原文可收）后本次运行不再压缩 */
+static bool s_upload_gzip = HTTP_UPLOAD_GZIP;
+static gz_stream_t s_upload_gz_state;
+static uint8_t s_upload_gz[HTTP_UPLOAD_BODY_MAX];
+static size_t s_upload_resp_len = 0;
 
 static void log_alarm_snapshot(const alarm_list_t *list)
 {
@@ -87,12 +158,6 @@ static void log_alarm_snapshot(const alarm_list_t *list)
     }
 }
 
-typedef struct {
-    char *data;
-    size_t len;
-    size_t cap;
-} http_resp_buffer_t;
-
 bool wifi_is_connected(void)
 {
     if (s_wifi_event_group == NULL) return false;
@@ -183,65 +248,22 @@ void wifi_init_sta(void)
         ESP_LOGE(TAG, "UNEXPECTED EVENT");
     }
 
-    if (!s_wifi_reconnect_task) {
-        xTaskCreate(wifi_reconnect_task, "wifi_reconnect", 3072, NULL, 4, &s_wifi_reconnect_task);
-    }
-}
-
-static bool ensure_resp_capacity(http_resp_buffer_t *buf, size_t incoming)
-{
-    if (buf == NULL || buf->data == NULL) {
-        return false;
-    }
-
-    if (buf->len + incoming + 1 <= buf->cap) {
-        return true;
+    /* 断线重连由网络任务驱动（wifi_reconnect_poll） */
+    if (net_worker_start() != ESP_OK) {
+        ESP_LOGE(TAG, "net worker start failed");
     }
-
-    size_t new_cap = buf->cap;
-    while (new_cap < buf->len + incoming + 1 && new_cap < 16384) {
-        new_cap *= 2;
-    }
-
-    if (new_cap < buf->len + incoming + 1) {
-        return false;
-    }
-
-    char *new_data = (char *)realloc(buf->data, new_cap);
-    if (!new_data) {
-        return false;
-    }
-
-    buf->data = new_data;
-    buf->cap = new_cap;
-    return true;
 }
 
-static void wifi_reconnect_task(void *arg)
+void wifi_reconnect_poll(void)
 {
-    while (1) {
-        if (!wifi_is_connected()) {
-            ESP_LOGW(TAG, "Wi-Fi down, reconnecting...");
-            esp_wifi_disconnect();
-            esp_wifi_connect();
-        }
-        vTaskDelay(pdMS_TO_TICKS(WIFI_RECONNECT_PERIOD_MS));
-    }
-}
-
-static esp_err_t collect_http_event(esp_http_client_event_t *evt)
-{
-    if (evt->event_id == HTTP_EVENT_ON_DATA && evt->user_data) {
-        http_resp_buffer_t *ctx = (http_resp_buffer_t *)evt->user_data;
-        if (!ensure_resp_capacity(ctx, evt->data_len)) {
-            ESP_LOGE(TAG, "Response buffer overflow");
-            return ESP_FAIL;
-        }
-        memcpy(ctx->data + ctx->len, evt->data, evt->data_len);
-        ctx->len += evt->data_len;
-        ctx->data[ctx->len] = '\0';
+    const int64_t now_us = esp_timer_get_time();
+    if (wifi_is_connected() || now_us - s_wifi_reconnect_us < (int64_t)WIFI_RECONNECT_PERIOD_MS * 1000) {
+        return;
     }
-    return ESP_OK;
+    s_wifi_reconnect_us = now_us;
+    ESP_LOGW(TAG, "Wi-Fi down, reconnecting...");
+    esp_wifi_disconnect();
+    esp_wifi_connect();
 }
 
 static bool parse_time_of_day(const char *time_str, int *hour, int *minute, int *second)
@@ -312,89 +334,6 @@ static bool build_datetime(const char *date_str, const char *time_str, struct tm
     return true;
 }
 
-static int weekday_index_from_number(int num)
-{
-    if (num < 1 || num > 7) {
-        return -1;
-    }
-    return (num == 7) ? 6 : (num - 1);
-}
-
-static uint8_t parse_repeat_mask_from_string(const char *str)
-{
-    if (!str) {
-        return 0;
-    }
-
-    uint8_t mask = 0;
-    const char *p = str;
-    while (*p) {
-        while (*p == ' ' || *p == ',' || *p == ';') {
-            p++;
-        }
-        if (*p == '\0') {
-            break;
-        }
-        int val = atoi(p);
-        int idx = weekday_index_from_number(val);
-        if (idx >= 0) {
-            mask |= (1U << idx);
-        }
-        while (*p && *p != ',' && *p != ';') {
-            p++;
-        }
-    }
-    return mask;
-}
-
-static uint8_t parse_repeat_mask(const cJSON *node, char *repeat_buf, size_t buf_len)
-{
-    if (repeat_buf && buf_len > 0) {
-        repeat_buf[0] = '\0';
-    }
-
-    if (!node) {
-        return 0;
-    }
-
-    if (cJSON_IsString(node) && node->valuestring) {
-        if (repeat_buf && buf_len > 0) {
-            snprintf(repeat_buf, buf_len, "%s", node->valuestring);
-        }
-        return parse_repeat_mask_from_string(node->valuestring);
-    }
-
-    if (cJSON_IsArray(node)) {
-        uint8_t mask = 0;
-        size_t written = 0;
-        cJSON *child = NULL;
-        cJSON_ArrayForEach(child, node) {
-            int val = 0;
-            if (cJSON_IsNumber(child)) {
-                val = (int)child->valuedouble;
-            } else if (cJSON_IsString(child) && child->valuestring) {
-                val = atoi(child->valuestring);
-            } else {
-                continue;
-            }
-
-            int idx = weekday_index_from_number(val);
-            if (idx >= 0) {
-                mask |= (1U << idx);
-                if (repeat_buf && buf_len > 0 && written < buf_len - 1) {
-                    int n = snprintf(repeat_buf + written, buf_len - written, (written > 0) ? ",%d" : "%d", val);
-                    if (n > 0) {
-                        written += (size_t)n;
-                    }
-                }
-            }
-        }
-        return mask;
-    }
-
-    return 0;
-}
-
 static bool time_is_valid(time_t now)
 {
     return now > 1600000000; /* ~2020-09-13 */
@@ -436,75 +375,407 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
     return ESP_OK;
 }
 
-esp_err_t http_send_health_data(const health_data_t *data)
+/*
+ * 上传客户端：健康数据与整晚摘要共用一个长连接（同一主机端口，切换 URL 不断开）。
+ * 服务器保持连接时后续请求省去 TCP 握手与客户端的堆分配；
+ * 连接被对端关闭或 Wi-Fi 重连后首个请求失败，关闭后立即重试一次，对调用方透明。
+ */
+static esp_err_t upload_event_handler(esp_http_client_event_t *evt)
 {
-    char *post_data = NULL;
-    esp_err_t err = ESP_FAIL;
+    if (evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+        s_upload_connected = true;
+    } else if (evt->event_id == HTTP_EVENT_ON_DATA && s_upload_resp_len + 1 < sizeof(s_upload_resp)) {
+        size_t n = sizeof(s_upload_resp) - 1 - s_upload_resp_len;
+        if ((size_t)evt->data_len < n) {
+            n = (size_t)evt->data_len;
+        }
+        memcpy(s_upload_resp + s_upload_resp_len, evt->data, n);
+        s_upload_resp_len += n;
+        s_upload_resp[s_upload_resp_len] = '\0';
+    }
+    return http_event_handler(evt);
+}
 
-    if (!data) {
-        return ESP_ERR_INVALID_ARG;
+static esp_http_client_handle_t upload_client_get(void)
+{
+    if (s_upload_client) {
+        return s_upload_client;
     }
 
-    if (!wifi_wait_connected(5000)) {
-        ESP_LOGE(TAG, "Wi-Fi not connected, skip upload");
-        return ESP_FAIL;
+    esp_http_client_config_t config = {
+        .url = SERVER_URL,
+        .event_handler = upload_event_handler,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = 5000,
+        .keep_alive_enable = true,
+    };
+    s_upload_client = esp_http_client_init(&config);
+    if (!s_upload_client) {
+        ESP_LOGE(TAG, "upload client init failed");
     }
+    return s_upload_client;
+}
 
-    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-    if (netif) {
-        esp_netif_ip_info_t ip_info;
-        esp_netif_get_ip_info(netif, &ip_info);
-        if (ip_info.ip.addr == 0) {
-            ESP_LOGE(TAG, "Device has no IP address. Check Wi-Fi connection.");
-            return ESP_FAIL;
+static void upload_client_drop(void)
+{
+    if (s_upload_client) {
+        esp_http_client_cleanup(s_upload_client);
+        s_upload_client = NULL;
+    }
+}
+
+/* 上传客户端与编码缓冲的互斥（首次使用时创建）；请求都在网络任务中执行，只防网络任务启动前的直接调用 */
+static void upload_lock(void)
+{
+    if (!s_upload_mutex) {
+        s_upload_mutex = xSemaphoreCreateMutex();
+    }
+    xSemaphoreTake(s_upload_mutex, portMAX_DELAY);
+}
+
+static void upload_unlock(void)
+{
+    xSemaphoreGive(s_upload_mutex);
+}
+
+/* 把请求体压缩到 s_upload_gz；压缩后不更小或缓冲放不下时返回 0，按原文发送 */
+static size_t upload_gzip(const char *body, size_t len)
+{
+    const int64_t t0 = esp_timer_get_time();
+    gz_init(&s_upload_gz_state, s_upload_gz, sizeof(s_upload_gz));
+    gz_write(&s_upload_gz_state, body, len);
+    const size_t out = gz_finish(&s_upload_gz_state);
+    s_upload_stats.gzip_us += (uint32_t)(esp_timer_get_time() - t0);
+    s_upload_stats.gzip_in_bytes += (uint32_t)len;
+    if (out == 0 || out >= len) {
+        s_upload_stats.gzip_out_bytes += (uint32_t)len;
+        return 0;
+    }
+    s_upload_stats.gzip_out_bytes += (uint32_t)out;
+    s_upload_stats.gzip_bodies++;
+    return out;
+}
+
+/* 在上传长连接上发送一次请求体，复用的连接失效时用新连接重试一次；*status 为 HTTP 状态码（失败时为 0） */
+static esp_err_t upload_perform(const char *url, const char *content_type, const char *body, size_t len,
+                                bool gzip, int *status)
+{
+    *status = 0;
+    esp_err_t err = ESP_FAIL;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        esp_http_client_handle_t client = upload_client_get();
+        if (!client) {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+        esp_http_client_set_url(client, url);
+        esp_http_client_set_method(client, HTTP_METHOD_POST);
+        esp_http_client_set_header(client, "Content-Type", content_type);
+        if (gzip) {
+            esp_http_client_set_header(client, "Content-Encoding", "gzip");
+        } else {
+            esp_http_client_delete_header(client, "Content-Encoding");
+        }
+        esp_http_client_set_post_field(client, body, (int)len);
+
+        s_upload_connected = false;
+        s_upload_resp_len = 0;
+        s_upload_resp[0] = '\0';
+        err = esp_http_client_perform(client);
+        if (s_upload_connected) {
+            s_upload_stats.new_connections++;
+        } else if (err == ESP_OK) {
+            s_upload_stats.reused_connections++;
+        }
+        if (err == ESP_OK) {
+            *status = esp_http_client_get_status_code(client);
+            break;
         }
+
+        /* 复用的连接已失效（对端超时关闭/网络切换）：关闭后用新连接重试一次，句柄保留 */
+        esp_http_client_close(client);
+        if (s_upload_connected) {
+            break;   /* 新建的连接也失败，不再重试 */
+        }
+        s_upload_stats.retries++;
     }
+    return err;
+}
 
-    cJSON *root = cJSON_CreateObject();
-    if (root == NULL) {
-        ESP_LOGE(TAG, "Failed to create JSON object");
-        return ESP_FAIL;
+/* 在上传长连接上 POST 一次（调用方持锁），*status 为 HTTP 状态码（失败时为 0）。
+ * 请求体不小于 HTTP_GZIP_MIN_BYTES 时以 Content-Encoding: gzip 发送；服务器 415 时按原文重发一次，
+ * 重发计入 gzip_resends，整体仍按一次上传统计请求数、耗时与失败。 */
+static esp_err_t upload_post(const char *url, const char *content_type, const char *body, size_t len, int *status)
+{
+    const int64_t t0 = esp_timer_get_time();
+    const size_t gz_len = (s_upload_gzip && len >= HTTP_GZIP_MIN_BYTES) ? upload_gzip(body, len) : 0;
+    esp_err_t err = (gz_len > 0)
+                        ? upload_perform(url, content_type, (const char *)s_upload_gz, gz_len, true, status)
+                        : upload_perform(url, content_type, body, len, false, status);
+    if (err == ESP_OK && *status == 415 && gz_len > 0) {
+        /* 按原文重发：原文被接受才是不支持压缩；原文也 415 是载荷格式问题，交给调用方回退 */
+        s_upload_stats.gzip_resends++;
+        err = upload_perform(url, content_type, body, len, false, status);
+        if (err == ESP_OK && *status != 415) {
+            ESP_LOGW(TAG, "server rejected gzip body, uploads stay uncompressed");
+            s_upload_gzip = false;
+            s_upload_stats.gzip = 0;
+        }
+    }
+    if (!HTTP_UPLOAD_KEEP_ALIVE) {
+        upload_client_drop();
     }
-    cJSON_AddNumberToObject(root, "heartRate", data->heart_rate);
-    cJSON_AddNumberToObject(root, "breathingRate", data->breathing_rate);
-    cJSON_AddStringToObject(root, "sleepStatus", data->sleep_status[0] ? data->sleep_status : "UNKNOWN");
 
-    post_data = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
+    const uint32_t latency_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+    s_upload_stats.requests++;
+    if (err != ESP_OK) {
+        s_upload_stats.failures++;
+    }
+    s_upload_stats.last_latency_ms = latency_ms;
+    s_upload_latency_sum_ms += latency_ms;
+    s_upload_stats.avg_latency_ms = (uint32_t)(s_upload_latency_sum_ms / s_upload_stats.requests);
+    if (latency_ms > s_upload_stats.max_latency_ms) {
+        s_upload_stats.max_latency_ms = latency_ms;
+    }
+    s_upload_stats.heap_min_free = esp_get_minimum_free_heap_size();
+    if (s_upload_stats.requests % HTTP_UPLOAD_STATS_PERIOD == 0) {
+        ESP_LOGI(TAG, "upload: %lu req, %lu new / %lu reused conn, %lu retry, %lu fail, avg %lu ms max %lu ms, heap min %lu",
+                 (unsigned long)s_upload_stats.requests, (unsigned long)s_upload_stats.new_connections,
+                 (unsigned long)s_upload_stats.reused_connections, (unsigned long)s_upload_stats.retries,
+                 (unsigned long)s_upload_stats.failures, (unsigned long)s_upload_stats.avg_latency_ms,
+                 (unsigned long)s_upload_stats.max_latency_ms, (unsigned long)s_upload_stats.heap_min_free);
+    }
+    return err;
+}
 
-    if (post_data == NULL) {
-        ESP_LOGE(TAG, "Failed to print JSON string");
-        return ESP_FAIL;
+void http_upload_get_stats(http_upload_stats_t *out)
+{
+    if (out) {
+        *out = s_upload_stats;
     }
+}
 
-    esp_http_client_config_t config = {
-        .url = SERVER_URL,
-        .event_handler = http_event_handler,
-        .method = HTTP_METHOD_POST,
-        .timeout_ms = 5000,
-    };
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+typedef size_t (*upload_encode_fn_t)(telemetry_format_t format, const void *ctx, uint8_t *out, size_t cap);
+
+typedef struct {
+    uint32_t sent_at;
+    const health_data_t *items;
+    size_t count;
+    const sleep_quality_report_t *report;
+} batch_ctx_t;
+
+static size_t encode_health(telemetry_format_t format, const void *ctx, uint8_t *out, size_t cap)
+{
+    return telemetry_encode_health(format, (const health_data_t *)ctx, out, cap);
+}
+
+static size_t encode_batch(telemetry_format_t format, const void *ctx, uint8_t *out, size_t cap)
+{
+    const batch_ctx_t *b = (const batch_ctx_t *)ctx;
+    return telemetry_encode_batch(format, b->sent_at, b->items, b->count, b->report, out, cap);
+}
+
+/* 编码到静态缓冲并上传（调用方持锁）；服务器 415 时退回 JSON 重发并记住 */
+static esp_err_t upload_telemetry(const char *url, upload_encode_fn_t encode, const void *ctx, int *status)
+{
+    while (1) {
+        const telemetry_format_t format = s_upload_format;
+        const int64_t t0 = esp_timer_get_time();
+        const size_t len = encode(format, ctx, s_upload_body, sizeof(s_upload_body));
+        s_upload_stats.encode_us = (uint32_t)(esp_timer_get_time() - t0);
+        if (len == 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        esp_err_t err = upload_post(url, telemetry_content_type(format), (const char *)s_upload_body, len, status);
+        if (err == ESP_OK && *status == 415 && format != TELEMETRY_FORMAT_JSON) {
+            ESP_LOGW(TAG, "server rejected %s, falling back to JSON", telemetry_content_type(format));
+            s_upload_format = TELEMETRY_FORMAT_JSON;
+            s_upload_stats.format = (uint8_t)TELEMETRY_FORMAT_JSON;
+            continue;
+        }
+        if (err == ESP_OK) {
+            s_upload_stats.payload_bytes += len;
+        }
+        return err;
+    }
+}
+
+/* 在响应中查找 "key":<非负整数>，不解析整棵 JSON */
+static bool resp_find_uint(const char *resp, const char *key, uint32_t *out)
+{
+    char pattern[24];
+    snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+    const char *p = strstr(resp, pattern);
+    if (!p) {
+        return false;
+    }
+    p += strlen(pattern);
+    while (*p == ' ' || *p == ':') {
+        p++;
+    }
+    if (!isdigit((unsigned char)*p)) {
+        return false;
+    }
+    *out = (uint32_t)strtoul(p, NULL, 10);
+    return true;
+}
 
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, post_data, strlen(post_data));
+/* 以下 *_job 在网络任务中执行；断网时网络任务已等待过重连，这里只做非阻塞检查 */
+static esp_err_t health_data_job(void *arg)
+{
+    const health_data_t *data = (const health_data_t *)arg;
+    if (!wifi_is_connected()) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    err = esp_http_client_perform(client);
+    int status = 0;
+    upload_lock();
+    esp_err_t err = upload_telemetry(SERVER_URL, encode_health, data, &status);
+    upload_unlock();
     if (err == ESP_OK) {
-        ESP_LOGI(TAG, "HTTP POST Status = %d, content_length = %" PRId64,
-                 esp_http_client_get_status_code(client), 
-                 esp_http_client_get_content_length(client));
+        ESP_LOGI(TAG, "HTTP POST Status = %d, latency %lu ms", status, (unsigned long)s_upload_stats.last_latency_ms);
+        /* 非 2xx 未入库：返回失败，调用方保留该 epoch（日志游标不前移） */
+        if (status < 200 || status >= 300) {
+            err = ESP_FAIL;
+        }
     } else {
         ESP_LOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(err));
         ESP_LOGE(TAG, "Target URL: %s", SERVER_URL);
         ESP_LOGE(TAG, "Please check if Server IP is correct and Port 6060 is open.");
     }
+    return err;
+}
+
+esp_err_t http_send_health_data(const health_data_t *data)
+{
+    if (!data) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return net_worker_call(NET_PRIO_TELEMETRY, health_data_job, (void *)data, 1);
+}
+
+typedef struct {
+    const health_data_t *items;
+    size_t count;
+    const sleep_quality_report_t *report;
+    size_t *accepted;
+} batch_job_t;
 
-    esp_http_client_cleanup(client);
-    free(post_data);
+static esp_err_t health_batch_job(void *arg)
+{
+    const batch_job_t *job = (const batch_job_t *)arg;
+    const health_data_t *items = job->items;
+    const size_t count = job->count;
+    size_t *accepted = job->accepted;
+    if (!wifi_is_connected()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const time_t now = time(NULL);
+    const batch_ctx_t ctx = {
+        .sent_at = time_is_valid(now) ? (uint32_t)now : 0U,
+        .items = items,
+        .count = count,
+        .report = job->report,
+    };
+    int status = 0;
+    upload_lock();
+    esp_err_t err = upload_telemetry(BATCH_UPLOAD_URL, encode_batch, &ctx, &status);
+    uint32_t acc = (uint32_t)count;   /* 确认前缀：缺省视为全部接受 */
+    if (err == ESP_OK && resp_find_uint(s_upload_resp, "accepted", &acc) && acc > count) {
+        acc = (uint32_t)count;
+    }
+    upload_unlock();
+    if (err == ESP_ERR_INVALID_SIZE) {
+        return err;   /* 本地缓冲放不下，调用方减少条数 */
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Batch POST failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (status == 404 || status == 405) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (status == 413) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (status < 200 || status >= 300) {
+        ESP_LOGE(TAG, "Batch POST Status = %d", status);
+        return ESP_FAIL;
+    }
+
+    *accepted = acc;
+    ESP_LOGI(TAG, "Batch POST Status = %d, %u/%u accepted, latency %lu ms", status, (unsigned)*accepted,
+             (unsigned)count, (unsigned long)s_upload_stats.last_latency_ms);
+    return ESP_OK;
+}
+
+esp_err_t http_send_health_batch(const health_data_t *items, size_t count,
+                                 const sleep_quality_report_t *report, size_t *accepted)
+{
+    if (!items || count == 0 || !accepted) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *accepted = 0;
+    batch_job_t job = {
+        .items = items,
+        .count = count,
+        .report = report,
+        .accepted = accepted,
+    };
+    return net_worker_call(NET_PRIO_TELEMETRY, health_batch_job, &job, 1);
+}
+
+typedef struct {
+    const uint8_t *blob;
+    size_t len;
+} night_job_t;
+
+static esp_err_t night_summary_job(void *arg)
+{
+    const night_job_t *job = (const night_job_t *)arg;
+    const size_t len = job->len;
+    if (!wifi_is_connected()) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
+    int status = 0;
+    upload_lock();
+    esp_err_t err = upload_post(NIGHT_SUMMARY_URL, "application/octet-stream", (const char *)job->blob, len, &status);
+    upload_unlock();
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Night summary POST Status = %d, %u bytes", status, (unsigned)len);
+        if (status < 200 || status >= 300) {
+            err = ESP_FAIL;
+        }
+    } else {
+        ESP_LOGE(TAG, "Night summary POST failed: %s", esp_err_to_name(err));
+    }
     return err;
 }
 
+/* 整晚摘要：二进制包（布局见 sleep_night_summary.h）一次性上传 */
+esp_err_t http_send_night_summary(const uint8_t *blob, size_t len)
+{
+    if (!blob || len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    night_job_t job = {
+        .blob = blob,
+        .len = len,
+    };
+    return net_worker_call(NET_PRIO_TELEMETRY, night_summary_job, &job, 1);
+}
+
+/* 服务器或用户变更后旧版本标识失效 */
+static void alarm_fetch_reset_version(void)
+{
+    s_alarm_etag[0] = '\0';
+    s_alarm_hash_valid = false;
+}
+
 esp_err_t http_set_alarm_server(const char *host, uint16_t port)
 {
     if (!host || strlen(host) == 0 || strlen(host) >= sizeof(s_alarm_host) || port == 0) {
@@ -512,6 +783,7 @@ esp_err_t http_set_alarm_server(const char *host, uint16_t port)
     }
     snprintf(s_alarm_host, sizeof(s_alarm_host), "%s", host);
     s_alarm_port = port;
+    alarm_fetch_reset_version();
     return ESP_OK;
 }
 
@@ -521,6 +793,7 @@ esp_err_t http_set_alarm_user(const char *user_id)
         return ESP_ERR_INVALID_ARG;
     }
     snprintf(s_alarm_user, sizeof(s_alarm_user), "%s", user_id);
+    alarm_fetch_reset_version();
     return ESP_OK;
 }
 
@@ -598,216 +871,531 @@ bool alarm_is_due(const alarm_info_t *alarm, const struct tm *now_local)
     struct tm trigger_tm;
     localtime_r(&alarm->next_trigger, &trigger_tm);
     
-    /* Match by hour and minute only, not second */
-    return (now_local->tm_hour == trigger_tm.tm_hour && 
+    /* 按日期与时分匹配，不比较秒；提前唤醒后已推进到次日的重复闹钟当天截止时刻不再响 */
+    return (now_local->tm_year == trigger_tm.tm_year &&
+            now_local->tm_yday == trigger_tm.tm_yday &&
+            now_local->tm_hour == trigger_tm.tm_hour &&
             now_local->tm_min == trigger_tm.tm_min);
 }
 
-static esp_err_t http_fetch_raw(const char *url, http_resp_buffer_t *resp)
+struct alarm_fetch_ctx {
+    alarm_json_parser_t parser;
+    uint32_t hash;               /* 正文 FNV-1a */
+    uint32_t header_bytes;
+    int64_t handler_us;          /* 回调中哈希与解析的耗时 */
+    char etag[ALARM_ETAG_MAX];
+};
+
+/* 闹钟列表响应直接喂给流式解析器，不缓存整个响应；同时记录 ETag 与正文哈希 */
+static esp_err_t alarm_fetch_event(esp_http_client_event_t *evt, alarm_fetch_ctx_t *ctx)
 {
-    if (!url || !resp) {
-        return ESP_ERR_INVALID_ARG;
+    if (evt->event_id == HTTP_EVENT_ON_HEADER && evt->header_key && evt->header_value) {
+        ctx->header_bytes += (uint32_t)(strlen(evt->header_key) + strlen(evt->header_value) + 4U);
+        if (strcasecmp(evt->header_key, "ETag") == 0 && strlen(evt->header_value) < sizeof(ctx->etag)) {
+            snprintf(ctx->etag, sizeof(ctx->etag), "%s", evt->header_value);
+        }
+    } else if (evt->event_id == HTTP_EVENT_ON_DATA) {
+        const int64_t t0 = esp_timer_get_time();
+        const uint8_t *data = (const uint8_t *)evt->data;
+        uint32_t h = ctx->hash;
+        for (int i = 0; i < evt->data_len; ++i) {
+            h = (h ^ data[i]) * 16777619U;
+        }
+        ctx->hash = h;
+        /* 出错后剩余数据忽略，结果在 alarm_json_finish 时判定 */
+        (void)alarm_json_feed(&ctx->parser, (const char *)evt->data, (size_t)evt->data_len);
+        ctx->handler_us += esp_timer_get_time() - t0;
     }
+    return ESP_OK;
+}
 
-    esp_http_client_config_t config = {
-        .url = url,
-        .event_handler = collect_http_event,
-        .user_data = resp,
-        .method = HTTP_METHOD_GET,
-        .timeout_ms = 5000,
-    };
-
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) {
-        return ESP_FAIL;
+/* user_data 为所属的 alarm_conn_t */
+static esp_err_t alarm_client_event(esp_http_client_event_t *evt)
+{
+    alarm_conn_t *conn = (alarm_conn_t *)evt->user_data;
+    if (!conn) {
+        return ESP_OK;
     }
+    if (evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+        conn->connected = true;
+    } else if (evt->event_id == HTTP_EVENT_ON_HEADER || evt->event_id == HTTP_EVENT_ON_DATA) {
+        conn->rx = true;
+    }
+    return conn->fetch ? alarm_fetch_event(evt, conn->fetch) : ESP_OK;
+}
 
-    esp_err_t err = esp_http_client_perform(client);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "HTTP GET failed: %s", esp_err_to_name(err));
-    } else {
-        int status = esp_http_client_get_status_code(client);
-        if (status != 200) {
-            ESP_LOGE(TAG, "HTTP GET status %d", status);
-            err = ESP_FAIL;
+/**
+ * 在闹钟长连接上执行一次请求（每条连接只由一个任务使用）；复用的连接已失效且尚未收到数据时新建连接重试一次。
+ * if_none_match 非空时带条件头；*status 为 HTTP 状态码，2xx 与 304 返回 ESP_OK。
+ */
+static esp_err_t alarm_request(alarm_conn_t *conn, const char *url, esp_http_client_method_t method,
+                               alarm_fetch_ctx_t *ctx, const char *if_none_match, int timeout_ms, int *status)
+{
+    *status = 0;
+    esp_err_t err = ESP_FAIL;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!conn->client) {
+            esp_http_client_config_t config = {
+                .url = url,
+                .event_handler = alarm_client_event,
+                .user_data = conn,
+                .timeout_ms = timeout_ms,
+                .keep_alive_enable = true,
+            };
+            conn->client = esp_http_client_init(&config);
+            if (!conn->client) {
+                return ESP_ERR_NO_MEM;
+            }
+        }
+        esp_http_client_handle_t client = conn->client;
+        esp_http_client_set_url(client, url);
+        esp_http_client_set_method(client, method);
+        esp_http_client_set_timeout_ms(client, timeout_ms);
+        conn->fetch = ctx;
+        if (if_none_match && if_none_match[0] != '\0') {
+            esp_http_client_set_header(client, "If-None-Match", if_none_match);
+        } else {
+            esp_http_client_delete_header(client, "If-None-Match");
         }
-    }
 
-    esp_http_client_cleanup(client);
+        conn->connected = false;
+        conn->rx = false;
+        err = esp_http_client_perform(client);
+        if (err == ESP_OK) {
+            *status = esp_http_client_get_status_code(client);
+            break;
+        }
+        esp_http_client_close(client);
+        if (conn->connected || conn->rx) {
+            break;   /* 新建的连接也失败，或已部分接收，不再重试 */
+        }
+    }
+    conn->fetch = NULL;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "HTTP %s failed: %s", (method == HTTP_METHOD_PUT) ? "PUT" : "GET", esp_err_to_name(err));
+    } else if (*status != 304 && (*status < 200 || *status >= 300)) {
+        ESP_LOGE(TAG, "HTTP %s status %d", (method == HTTP_METHOD_PUT) ? "PUT" : "GET", *status);
+        err = ESP_FAIL;
+    }
     return err;
 }
 
-static esp_err_t http_put_no_body(const char *url)
+static void alarm_fetch_lock(void)
 {
-    if (!url) {
-        return ESP_ERR_INVALID_ARG;
+    if (s_alarm_fetch_lock) {
+        xSemaphoreTake(s_alarm_fetch_lock, portMAX_DELAY);
     }
+}
 
-    esp_http_client_config_t config = {
-        .url = url,
-        .method = HTTP_METHOD_PUT,
-        .timeout_ms = 5000,
-    };
-
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) {
-        return ESP_FAIL;
+static void alarm_fetch_unlock(void)
+{
+    if (s_alarm_fetch_lock) {
+        xSemaphoreGive(s_alarm_fetch_lock);
     }
+}
 
-    esp_err_t err = esp_http_client_perform(client);
+/* 记录拉取结果并更新 ETag/哈希（持 s_alarm_fetch_lock 调用） */
+static esp_err_t alarm_fetch_finish(alarm_list_t *out_list, bool conditional, alarm_fetch_ctx_t *ctx,
+                                    int64_t t0, esp_err_t err, int status, bool *changed)
+{
+    http_alarm_fetch_stats_t *st = &s_alarm_fetch_stats;
+    st->fetches++;
+    st->last_rx_bytes = ctx->header_bytes + (uint32_t)ctx->parser.bytes;
+    st->rx_bytes += st->last_rx_bytes;
+    st->last_latency_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+    st->last_handler_us = (uint32_t)ctx->handler_us;
+
+    if (err == ESP_OK && status == 304) {
+        st->not_modified++;
+        ESP_LOGD(TAG, "alarm list not modified (%lu B, %lu ms)",
+                 (unsigned long)st->last_rx_bytes, (unsigned long)st->last_latency_ms);
+        return ESP_OK;
+    }
+    if (err == ESP_OK && alarm_json_finish(&ctx->parser) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to parse alarm JSON (%u bytes)", (unsigned)ctx->parser.bytes);
+        err = ESP_FAIL;
+    }
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "HTTP PUT failed: %s", esp_err_to_name(err));
-    } else {
-        int status = esp_http_client_get_status_code(client);
-        if (status != 200) {
-            ESP_LOGE(TAG, "HTTP PUT status %d", status);
-            err = ESP_FAIL;
-        }
+        st->failures++;
+        memset(out_list, 0, sizeof(alarm_list_t));
+        return err;
+    }
+    if (ctx->parser.truncated) {
+        ESP_LOGW(TAG, "Alarm list truncated to %d", ALARM_MAX_COUNT);
+    }
+    if (ctx->parser.command[0] != '\0') {
+        st->commands++;
+    }
+
+    /* 服务器不支持 ETag 时按正文哈希判断 */
+    const bool same = s_alarm_hash_valid && ctx->hash == s_alarm_hash;
+    snprintf(s_alarm_etag, sizeof(s_alarm_etag), "%s", ctx->etag);
+    s_alarm_hash = ctx->hash;
+    s_alarm_hash_valid = true;
+    if (conditional && same) {
+        st->unchanged++;
+        return ESP_OK;
+    }
+
+    time_t now_ts = time(NULL);
+    struct tm now_tm = {0};
+    localtime_r(&now_ts, &now_tm);
+    for (size_t i = 0; i < out_list->count; ++i) {
+        alarm_info_t *dst = &out_list->items[i];
+        dst->next_trigger = time_is_valid(now_ts) ? alarm_compute_next_trigger(dst, &now_tm) : 0;
+    }
+    st->changed++;
+    *changed = true;
+    ESP_LOGI(TAG, "alarm list updated: %u alarms, %lu B, %lu ms, parse %lu us",
+             (unsigned)out_list->count, (unsigned long)st->last_rx_bytes,
+             (unsigned long)st->last_latency_ms, (unsigned long)st->last_handler_us);
+    return ESP_OK;
+}
+
+
+/**
+ * 拉取闹钟列表；conditional 时带 If-None-Match，*changed 为 false 表示列表与上次相同（out_list 未填写）。
+ * wait_s > 0 为长轮询：服务器最多挂起 wait_s 秒，期间列表变化或有命令才返回 200。
+ */
+static esp_err_t alarm_fetch(alarm_conn_t *conn, alarm_list_t *out_list, bool conditional, uint32_t wait_s, bool *changed)
+{
+    *changed = false;
+    memset(out_list, 0, sizeof(alarm_list_t));
+
+    if (!wifi_is_connected()) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    esp_http_client_cleanup(client);
+    char url[160];
+    int n = snprintf(url, sizeof(url), "http://%s:%u/api/alarms/list/%s", s_alarm_host, (unsigned)s_alarm_port, s_alarm_user);
+    if (wait_s > 0 && n > 0 && (size_t)n < sizeof(url)) {
+        snprintf(url + n, sizeof(url) - (size_t)n, "?wait=%lu", (unsigned long)wait_s);
+    }
+
+    alarm_fetch_ctx_t ctx = {.hash = 2166136261U};
+    alarm_json_init(&ctx.parser, out_list);
+    char etag[ALARM_ETAG_MAX] = "";
+    if (conditional) {
+        alarm_fetch_lock();
+        snprintf(etag, sizeof(etag), "%s", s_alarm_etag);
+        alarm_fetch_unlock();
+    }
+    const int64_t t0 = esp_timer_get_time();
+    int status = 0;
+    const int timeout_ms = 5000 + (int)wait_s * 1000;
+    esp_err_t err = alarm_request(conn, url, HTTP_METHOD_GET, &ctx, etag, timeout_ms, &status);
+
+    alarm_fetch_lock();
+    err = alarm_fetch_finish(out_list, conditional, &ctx, t0, err, status, changed);
+    alarm_fetch_unlock();
+
+    if (err == ESP_OK && status != 304 && ctx.parser.command[0] != '\0') {
+        ESP_LOGI(TAG, "device command: %s", ctx.parser.command);
+        if (s_command_cb) {
+            s_command_cb(ctx.parser.command, s_command_cb_ctx);
+        }
+    }
     return err;
 }
+typedef struct {
+    alarm_list_t *out;
+    bool conditional;
+    bool *changed;
+} fetch_job_t;
+
+static esp_err_t alarm_fetch_job(void *arg)
+{
+    fetch_job_t *job = (fetch_job_t *)arg;
+    return alarm_fetch(&s_alarm_conn, job->out, job->conditional, 0, job->changed);
+}
 
 esp_err_t http_fetch_alarms(alarm_list_t *out_list)
 {
     if (!out_list) {
         return ESP_ERR_INVALID_ARG;
     }
+    bool changed = false;
+    fetch_job_t job = {
+        .out = out_list,
+        .conditional = false,
+        .changed = &changed,
+    };
+    return net_worker_call(NET_PRIO_ALARM_FETCH, alarm_fetch_job, &job, 1);
+}
 
-    memset(out_list, 0, sizeof(alarm_list_t));
+esp_err_t http_fetch_alarms_if_changed(alarm_list_t *out_list, bool *changed)
+{
+    if (!out_list || !changed) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    fetch_job_t job = {
+        .out = out_list,
+        .conditional = true,
+        .changed = changed,
+    };
+    return net_worker_call(NET_PRIO_ALARM_FETCH, alarm_fetch_job, &job, 1);
+}
 
-    if (!wifi_wait_connected(5000)) {
-        ESP_LOGW(TAG, "Wi-Fi not connected, skip alarm fetch");
+void http_alarm_get_fetch_stats(http_alarm_fetch_stats_t *out)
+{
+    if (out) {
+        *out = s_alarm_fetch_stats;
+    }
+}
+
+typedef struct {
+    int alarm_id;
+    int status;
+} status_job_t;
+
+static esp_err_t alarm_status_job(void *arg)
+{
+    const status_job_t *job = (const status_job_t *)arg;
+    if (!wifi_is_connected()) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    char url[128];
-    snprintf(url, sizeof(url), "http://%s:%u/api/alarms/list/%s", s_alarm_host, (unsigned)s_alarm_port, s_alarm_user);
+    char url[160];
+    snprintf(url, sizeof(url), "http://%s:%u/api/alarms/%d/status?userId=%s&status=%d",
+             s_alarm_host, (unsigned)s_alarm_port, job->alarm_id, s_alarm_user, job->status);
+
+    int http_status = 0;
+    return alarm_request(&s_alarm_conn, url, HTTP_METHOD_PUT, NULL, NULL, 5000, &http_status);
+}
 
-    http_resp_buffer_t resp = {
-        .cap = 2048,
-        .len = 0,
-        .data = (char *)calloc(1, 2048)
+esp_err_t http_update_alarm_status(int alarm_id, int status)
+{
+    if (alarm_id <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    status_job_t job = {
+        .alarm_id = alarm_id,
+        .status = status,
     };
+    return net_worker_call(NET_PRIO_ALARM_STATUS, alarm_status_job, &job, ALARM_STATUS_ATTEMPTS);
+}
 
-    if (!resp.data) {
-        return ESP_ERR_NO_MEM;
+esp_err_t http_update_alarm_status_async(int alarm_id, int status, net_done_cb_t done, void *ctx)
+{
+    if (alarm_id <= 0) {
+        return ESP_ERR_INVALID_ARG;
     }
+    const status_job_t req = {
+        .alarm_id = alarm_id,
+        .status = status,
+    };
+    const net_job_t job = {
+        .run = alarm_status_job,
+        .done = done,
+        .ctx = ctx,
+        .max_attempts = ALARM_STATUS_ATTEMPTS,
+    };
+    return net_worker_submit(NET_PRIO_ALARM_STATUS, &job, &req, sizeof(req));
+}
 
-    esp_err_t err = http_fetch_raw(url, &resp);
-    if (err != ESP_OK) {
-        free(resp.data);
-        return err;
+static void alarm_skip_fired(alarm_info_t *alarm);
+
+/* 新拉取的列表替换共享列表（网络任务中调用）；按 id 保留本地响铃记录，刷新不会让同一截止时刻再响 */
+static void alarm_list_apply(alarm_list_t *latest)
+{
+    if (s_alarm_mutex && xSemaphoreTake(s_alarm_mutex, pdMS_TO_TICKS(2000)) == pdTRUE) {
+        for (size_t i = 0; i < latest->count; ++i) {
+            alarm_info_t *dst = &latest->items[i];
+            dst->fired_deadline = 0;
+            for (size_t j = 0; j < s_alarm_list.count; ++j) {
+                if (s_alarm_list.items[j].id == dst->id) {
+                    dst->fired_deadline = s_alarm_list.items[j].fired_deadline;
+                    break;
+                }
+            }
+            alarm_skip_fired(dst);
+        }
+        s_alarm_list = *latest;
+        log_alarm_snapshot(&s_alarm_list);
+        xSemaphoreGive(s_alarm_mutex);
     }
+}
 
-    cJSON *root = cJSON_Parse(resp.data);
-    if (!root) {
-        ESP_LOGE(TAG, "Failed to parse alarm JSON");
-        free(resp.data);
-        return ESP_FAIL;
+static void alarm_poll_submit(uint32_t delay_ms);
+
+/* 尚无轮询链时提交一条；已有链时由它继续轮询 */
+static void alarm_poll_chain_start(uint32_t delay_ms)
+{
+    if (!__atomic_exchange_n(&s_poll_chain_pending, true, __ATOMIC_SEQ_CST)) {
+        alarm_poll_submit(delay_ms);
     }
+}
 
-    cJSON *data = cJSON_GetObjectItem(root, "data");
-    cJSON *alarms = data ? cJSON_GetObjectItem(data, "alarms") : NULL;
-    if (!cJSON_IsArray(alarms)) {
-        ESP_LOGE(TAG, "Alarms field missing or invalid");
-        cJSON_Delete(root);
-        free(resp.data);
-        return ESP_FAIL;
+static esp_err_t alarm_poll_job(void *arg)
+{
+    bool changed = false;
+    esp_err_t err = alarm_fetch(&s_alarm_conn, s_alarm_latest, true, 0, &changed);
+    if (err == ESP_OK && changed) {
+        alarm_list_apply(s_alarm_latest);
     }
+    return err;
+}
 
-    time_t now_ts = time(NULL);
-    struct tm now_tm = {0};
-    localtime_r(&now_ts, &now_tm);
+/* 周期轮询链：每次完成后按周期再提交，推送恢复后停止 */
+static void alarm_poll_done(esp_err_t err, void *ctx)
+{
+    if (!__atomic_load_n(&s_alarm_fetch_stats.push_active, __ATOMIC_SEQ_CST)) {
+        alarm_poll_submit(s_alarm_fetch_period_ms);
+        return;
+    }
+    __atomic_store_n(&s_poll_chain_pending, false, __ATOMIC_SEQ_CST);
+    /* 清除前推送又已退回轮询（见到链仍在而未提交）时由这里接管，两边至多一方提交 */
+    if (!__atomic_load_n(&s_alarm_fetch_stats.push_active, __ATOMIC_SEQ_CST)) {
+        alarm_poll_chain_start(s_alarm_fetch_period_ms);
+    }
+}
 
-    size_t idx = 0;
-    cJSON *item = NULL;
-    cJSON_ArrayForEach(item, alarms) {
-        if (idx >= ALARM_MAX_COUNT) {
-            ESP_LOGW(TAG, "Alarm list truncated to %d", ALARM_MAX_COUNT);
-            break;
-        }
-        alarm_info_t *dst = &out_list->items[idx];
-        memset(dst, 0, sizeof(alarm_info_t));
+static void alarm_poll_submit(uint32_t delay_ms)
+{
+    const net_job_t job = {
+        .run = alarm_poll_job,
+        .arg = NULL,
+        .done = alarm_poll_done,
+        .max_attempts = 1,
+        .delay_ms = delay_ms,
+    };
+    if (net_worker_submit(NET_PRIO_ALARM_FETCH, &job, NULL, 0) != ESP_OK) {
+        ESP_LOGE(TAG, "alarm poll submit failed");
+        __atomic_store_n(&s_poll_chain_pending, false, __ATOMIC_SEQ_CST);
+    }
+}
 
-        cJSON *id = cJSON_GetObjectItem(item, "id");
-        cJSON *type = cJSON_GetObjectItem(item, "type");
-        cJSON *alarm_time = cJSON_GetObjectItem(item, "alarmTime");
-        cJSON *target_date = cJSON_GetObjectItem(item, "targetDate");
-        cJSON *repeat_days = cJSON_GetObjectItem(item, "repeatDays");
-        cJSON *status = cJSON_GetObjectItem(item, "status");
+/**
+ * 在长轮询任务的独立连接上发起一次长轮询，返回下次发起前的间隔。
+ * 挂起期间网络任务照常执行状态回写与上传；失败按退避重连，服务器不挂起或连续失败时
+ * 改为网络任务中的周期轮询（轮询链），ALARM_PUSH_RETRY_MS 后再回到这里尝试推送。
+ */
+static uint32_t alarm_push_once(void)
+{
+    http_alarm_fetch_stats_t *st = &s_alarm_fetch_stats;
+    __atomic_store_n(&st->push_active, true, __ATOMIC_SEQ_CST);
 
-        dst->id = cJSON_IsNumber(id) ? (int)id->valuedouble : 0;
-        dst->type = cJSON_IsNumber(type) ? (alarm_type_t)((int)type->valuedouble) : ALARM_TYPE_ONCE;
-        dst->status = cJSON_IsNumber(status) ? (int)status->valuedouble : 1;
+    bool changed = false;
+    const int64_t t0 = esp_timer_get_time();
+    esp_err_t err = alarm_fetch(&s_push_conn, s_push_latest, true, ALARM_PUSH_WAIT_S, &changed);
+    const int64_t held_ms = (esp_timer_get_time() - t0) / 1000;
+    if (err == ESP_OK && changed) {
+        alarm_list_apply(s_push_latest);
+    }
+    if (err == ESP_ERR_INVALID_STATE) {
+        return ALARM_PUSH_IDLE_RETRY_MS;   /* 断网，由网络任务负责重连 */
+    }
 
-        if (cJSON_IsString(alarm_time) && alarm_time->valuestring) {
-            snprintf(dst->alarm_time, sizeof(dst->alarm_time), "%s", alarm_time->valuestring);
-        }
+    uint32_t delay_ms = 0;
+    bool fallback = false;
+    if (err != ESP_OK) {
+        s_push_short_holds = 0;
+        st->push_reconnects++;
+        delay_ms = net_worker_backoff_ms(++s_push_failures);
+        fallback = s_push_failures >= ALARM_PUSH_FAIL_LIMIT;
+    } else {
+        s_push_failures = 0;
+        s_push_short_holds = (!changed && held_ms < ALARM_PUSH_MIN_HOLD_MS) ? s_push_short_holds + 1U : 0U;
+        /* 挂起到期或有变化立即发起下一次；未挂起时稍等，避免空转 */
+        delay_ms = (s_push_short_holds > 0) ? ALARM_PUSH_IDLE_RETRY_MS : 0;
+        fallback = s_push_short_holds >= ALARM_PUSH_SHORT_LIMIT;
+    }
+    if (fallback) {
+        ESP_LOGW(TAG, "alarm push unavailable (%s), polling every %lu ms",
+                 (err != ESP_OK) ? "errors" : "no hold", (unsigned long)s_alarm_fetch_period_ms);
+        st->push_fallbacks++;
+        __atomic_store_n(&st->push_active, false, __ATOMIC_SEQ_CST);
+        s_push_failures = 0;
+        s_push_short_holds = 0;
+        /* 上一轮的轮询链可能仍在排队（推送重试只持续几秒），此时不另起一条 */
+        alarm_poll_chain_start(s_alarm_fetch_period_ms);
+        delay_ms = ALARM_PUSH_RETRY_MS;
+    }
+    return delay_ms;
+}
 
-        if (cJSON_IsString(target_date) && target_date->valuestring) {
-            snprintf(dst->target_date, sizeof(dst->target_date), "%s", target_date->valuestring);
+static void alarm_push_task(void *arg)
+{
+    while (1) {
+        if (!wifi_wait_connected(ALARM_PUSH_WAIT_S * 1000U)) {
+            continue;
         }
-
-        dst->repeat_mask = parse_repeat_mask(repeat_days, dst->repeat_days, sizeof(dst->repeat_days));
-
-        if (time_is_valid(now_ts)) {
-            dst->next_trigger = alarm_compute_next_trigger(dst, &now_tm);
-        } else {
-            dst->next_trigger = 0;
+        const uint32_t delay_ms = alarm_push_once();
+        if (delay_ms > 0) {
+            vTaskDelay(pdMS_TO_TICKS(delay_ms));
         }
-
-        idx++;
     }
+}
 
-    out_list->count = idx;
-
-    cJSON_Delete(root);
-    free(resp.data);
-    return ESP_OK;
+static void alarm_status_done(esp_err_t err, void *ctx)
+{
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to update alarm %d status to 0: %s", (int)(intptr_t)ctx, esp_err_to_name(err));
+    }
 }
 
-esp_err_t http_update_alarm_status(int alarm_id, int status)
+/* 已为当前截止时刻响过铃时跳到其后的下一次；单次闹钟保持本地关闭（状态回写可能尚未到达服务器） */
+static void alarm_skip_fired(alarm_info_t *alarm)
 {
-    if (alarm_id <= 0) {
-        return ESP_ERR_INVALID_ARG;
+    if (alarm->fired_deadline == 0 || alarm->next_trigger == 0 || alarm->next_trigger > alarm->fired_deadline) {
+        return;
+    }
+    if (alarm->type == ALARM_TYPE_ONCE) {
+        alarm->next_trigger = 0;
+        alarm->status = 0;
+        return;
     }
+    const time_t base_ts = alarm->fired_deadline + 60;
+    struct tm base;
+    localtime_r(&base_ts, &base);
+    alarm->next_trigger = alarm_compute_next_trigger(alarm, &base);
+}
 
-    if (!wifi_wait_connected(5000)) {
-        ESP_LOGW(TAG, "Wi-Fi not connected, skip alarm status update");
-        return ESP_ERR_INVALID_STATE;
+/* 响铃并推进下一次触发时间；base_ts 之后的下一次才会再次触发 */
+static void alarm_fire(alarm_info_t *alarm, time_t base_ts)
+{
+    /* 记下本次截止时刻并清除浅睡信号，同一窗口内不会因旧信号再响 */
+    alarm->fired_deadline = alarm->next_trigger;
+    s_sleep_signal_ts = 0;
+    if (s_alarm_cb) {
+        s_alarm_cb(alarm, s_alarm_cb_ctx);
+    } else {
+        ESP_LOGI(TAG, "Alarm %d due at %s %s", alarm->id,
+                 (alarm->target_date[0] != '\0') ? alarm->target_date : "repeat",
+                 alarm->alarm_time);
     }
 
-    char url[160];
-    snprintf(url, sizeof(url), "http://%s:%u/api/alarms/%d/status?userId=%s&status=%d",
-             s_alarm_host, (unsigned)s_alarm_port, alarm_id, s_alarm_user, status);
+    if (alarm->type == ALARM_TYPE_ONCE) {
+        /* 先在本地关闭，同一分钟内不会重复触发；回写由网络任务异步执行并失败重试 */
+        alarm->next_trigger = 0;
+        alarm->status = 0;
+        if (http_update_alarm_status_async(alarm->id, 0, alarm_status_done, (void *)(intptr_t)alarm->id) != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to queue alarm %d status update", alarm->id);
+        }
+    } else {
+        /* Skip to next minute to avoid repeated triggers within same minute */
+        time_t next_base_ts = base_ts + 60;
+        struct tm next_base;
+        localtime_r(&next_base_ts, &next_base);
+        alarm->next_trigger = alarm_compute_next_trigger(alarm, &next_base);
+    }
+}
 
-    return http_put_no_body(url);
+bool alarm_service_wake_window_active(void)
+{
+    return s_wake_window_active;
 }
 
-static void alarm_fetch_task_fn(void *arg)
+void alarm_service_report_sleep_signal(alarm_sleep_signal_t signal)
 {
-    alarm_list_t *latest = (alarm_list_t *)calloc(1, sizeof(alarm_list_t));
-    if (!latest) {
-        ESP_LOGE(TAG, "alarm fetch alloc failed");
-        vTaskDelete(NULL);
+    if (!s_wake_window_active) {
         return;
     }
-    while (1) {
-        if (http_fetch_alarms(latest) == ESP_OK) {
-            if (!s_alarm_mutex) {
-                s_alarm_mutex = xSemaphoreCreateMutex();
-            }
-            if (s_alarm_mutex && xSemaphoreTake(s_alarm_mutex, pdMS_TO_TICKS(2000)) == pdTRUE) {
-                s_alarm_list = *latest;
-                log_alarm_snapshot(&s_alarm_list);
-                xSemaphoreGive(s_alarm_mutex);
-            }
-        }
-        vTaskDelay(pdMS_TO_TICKS(s_alarm_fetch_period_ms));
+    s_sleep_signal = signal;
+    s_sleep_signal_ts = time(NULL);
+    if (s_alarm_monitor_task) {
+        xTaskNotifyGive(s_alarm_monitor_task);
     }
-    free(latest);
 }
 
 static void alarm_monitor_task_fn(void *arg)
@@ -823,6 +1411,7 @@ static void alarm_monitor_task_fn(void *arg)
         localtime_r(&now_ts, &now_tm);
 
         if (s_alarm_mutex && xSemaphoreTake(s_alarm_mutex, pdMS_TO_TICKS(200)) == pdTRUE) {
+            bool window_active = false;
             for (size_t i = 0; i < s_alarm_list.count; ++i) {
                 alarm_info_t *alarm = &s_alarm_list.items[i];
                 if (alarm->status != 1) {
@@ -831,40 +1420,46 @@ static void alarm_monitor_task_fn(void *arg)
 
                 if (alarm->next_trigger == 0) {
                     alarm->next_trigger = alarm_compute_next_trigger(alarm, &now_tm);
+                    alarm_skip_fired(alarm);
+                    if (alarm->status != 1) {
+                        continue;
+                    }
                 }
 
                 if (alarm_is_due(alarm, &now_tm)) {
-                    if (s_alarm_cb) {
-                        s_alarm_cb(alarm, s_alarm_cb_ctx);
-                    } else {
-                        ESP_LOGI(TAG, "Alarm %d due at %s %s", alarm->id,
-                                 (alarm->target_date[0] != '\0') ? alarm->target_date : "repeat",
-                                 alarm->alarm_time);
-                    }
+                    /* 截止时刻必响 */
+                    alarm_fire(alarm, now_ts);
+                    continue;
+                }
 
-                    if (alarm->type == ALARM_TYPE_ONCE) {
-                        alarm->next_trigger = 0;
-                        if (http_update_alarm_status(alarm->id, 0) == ESP_OK) {
-                            alarm->status = 0;
-                        } else {
-                            ESP_LOGW(TAG, "Failed to update alarm %d status to 0", alarm->id);
+                /* 智能唤醒：窗口内首个 REM/清醒/微觉醒信号即提前响铃 */
+                if (alarm->window_minutes > 0 && alarm->next_trigger > 0) {
+                    const time_t window_start = alarm->next_trigger - (time_t)alarm->window_minutes * 60;
+                    if (now_ts >= window_start && now_ts < alarm->next_trigger) {
+                        window_active = true;
+                        if (s_sleep_signal_ts >= window_start) {
+                            ESP_LOGI(TAG, "Alarm %d smart wake (signal %d), %ld s before deadline",
+                                     alarm->id, (int)s_sleep_signal, (long)(alarm->next_trigger - now_ts));
+                            alarm_fire(alarm, alarm->next_trigger);
                         }
-                    } else {
-                        /* Skip to next minute to avoid repeated triggers within same minute */
-                        time_t next_base_ts = now_ts + 60;
-                        struct tm next_base;
-                        localtime_r(&next_base_ts, &next_base);
-                        alarm->next_trigger = alarm_compute_next_trigger(alarm, &next_base);
                     }
                 }
             }
+            s_wake_window_active = window_active;
             xSemaphoreGive(s_alarm_mutex);
         }
 
-        vTaskDelay(pdMS_TO_TICKS(500));
+        /* 窗口内有信号上报时立即唤醒，保证秒级响应 */
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(500));
     }
 }
 
+void alarm_service_set_command_cb(alarm_command_cb_t cb, void *cb_ctx)
+{
+    s_command_cb_ctx = cb_ctx;
+    s_command_cb = cb;
+}
+
 esp_err_t alarm_service_start(uint32_t fetch_interval_ms, alarm_trigger_cb_t cb, void *cb_ctx)
 {
     if (fetch_interval_ms >= 5000) {
@@ -881,12 +1476,40 @@ esp_err_t alarm_service_start(uint32_t fetch_interval_ms, alarm_trigger_cb_t cb,
     s_alarm_cb = cb;
     s_alarm_cb_ctx = cb_ctx;
 
-    if (!s_alarm_fetch_task) {
-        BaseType_t r = xTaskCreate(alarm_fetch_task_fn, "alarm_fetch", ALARM_TASK_STACK, NULL, ALARM_TASK_PRIO, &s_alarm_fetch_task);
-        if (r != pdPASS) {
-            s_alarm_fetch_task = NULL;
-            return ESP_FAIL;
+    /* 推送时长轮询在独立任务与连接上挂起，不阻塞网络任务；否则在网络任务中周期轮询 */
+    if (!s_alarm_started) {
+        if (!s_alarm_fetch_lock) {
+            s_alarm_fetch_lock = xSemaphoreCreateMutex();
+            if (!s_alarm_fetch_lock) {
+                return ESP_ERR_NO_MEM;
+            }
+        }
+        if (!s_alarm_latest) {
+            s_alarm_latest = (alarm_list_t *)calloc(1, sizeof(alarm_list_t));
+            if (!s_alarm_latest) {
+                return ESP_ERR_NO_MEM;
+            }
+        }
+        esp_err_t err = net_worker_start();
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (ALARM_PUSH_ENABLE) {
+            if (!s_push_latest) {
+                s_push_latest = (alarm_list_t *)calloc(1, sizeof(alarm_list_t));
+                if (!s_push_latest) {
+                    return ESP_ERR_NO_MEM;
+                }
+            }
+            if (xTaskCreate(alarm_push_task, "alarm_push", ALARM_PUSH_TASK_STACK, NULL, ALARM_PUSH_TASK_PRIO,
+                            &s_alarm_push_task) != pdPASS) {
+                s_alarm_push_task = NULL;
+                return ESP_FAIL;
+            }
+        } else {
+            alarm_poll_chain_start(0);
         }
+        s_alarm_started = true;
     }
 
     if (!s_alarm_monitor_task) {
@@ -6,13 +6,41 @@
 #include <stddef.h>
 #include <time.h>
 #include "esp_err.h"
+#include "sleep_analysis.h"
+#include "net_worker.h"
 
 typedef struct {
     int heart_rate;
     int breathing_rate;
     char sleep_status[32];
+    char radar_status[8];        /* 雷达片上睡眠状态 DEEP/LIGHT/AWAKE/NONE，空串表示未知 */
+    int radar_score;             /* 雷达整晚评分，0 表示尚无 */
+    int arousals;                /* 本 epoch 内逐采样检测到的微觉醒事件数 */
+    uint32_t timestamp;          /* epoch 结束时刻 (unix s)，0 表示设备时间未同步 */
 } health_data_t;
 
+/* 上传长连接统计 */
+typedef struct {
+    uint32_t requests;
+    uint32_t failures;
+    uint32_t new_connections;    /* 新建 TCP 连接次数 */
+    uint32_t reused_connections; /* 复用已有连接完成的请求数 */
+    uint32_t retries;            /* 复用连接失效后重连重试次数 */
+    uint32_t last_latency_ms;    /* 单次上传耗时（含重试） */
+    uint32_t avg_latency_ms;
+    uint32_t max_latency_ms;
+    uint32_t heap_min_free;      /* 系统堆历史最低剩余 (esp_get_minimum_free_heap_size) */
+    uint32_t payload_bytes;      /* 已发送的遥测载荷字节数 */
+    uint32_t encode_us;          /* 最近一次载荷编码耗时 */
+    uint8_t format;              /* 当前载荷格式 telemetry_format_t（0 JSON，1 CBOR） */
+    uint8_t gzip;                /* 当前是否压缩请求体（服务器 415 后为 0） */
+    uint32_t gzip_bodies;        /* 以 gzip 发送的请求数 */
+    uint32_t gzip_resends;       /* gzip 请求体被 415 拒绝后按原文重发的次数（不另计请求数） */
+    uint32_t gzip_in_bytes;      /* 尝试压缩的请求体原文累计字节数 */
+    uint32_t gzip_out_bytes;     /* 上述请求体实际发送的累计字节数（压不小的按原文计） */
+    uint32_t gzip_us;            /* 累计压缩耗时 */
+} http_upload_stats_t;
+
 #define ALARM_MAX_COUNT       16
 #define ALARM_TIME_STR_LEN    9   /* HH:MM:SS */
 #define ALARM_DATE_STR_LEN    11  /* YYYY-MM-DD */
@@ -31,7 +59,9 @@ typedef struct {
     char repeat_days[ALARM_REPEAT_STR_LEN];
     int status;
     uint8_t repeat_mask;
+    uint16_t window_minutes;     /* 智能唤醒窗口（分钟），0 表示准点响铃 */
     time_t next_trigger;
+    time_t fired_deadline;       /* 本地已响铃（含提前唤醒）的截止时刻，刷新列表时按 id 保留 */
 } alarm_info_t;
 
 typedef struct {
@@ -39,18 +69,92 @@ typedef struct {
     size_t count;
 } alarm_list_t;
 
+/* 闹钟条件拉取统计 */
+typedef struct {
+    uint32_t fetches;
+    uint32_t not_modified;       /* 304，未下载正文 */
+    uint32_t unchanged;          /* 200 但正文哈希与上次相同（服务器不支持 ETag） */
+    uint32_t changed;
+    uint32_t failures;
+    uint32_t rx_bytes;           /* 累计接收的响应头与正文字节 */
+    uint32_t last_rx_bytes;
+    uint32_t last_latency_ms;    /* 长轮询时含服务器挂起时间 */
+    uint32_t last_handler_us;    /* 上次拉取在接收回调中哈希与解析的耗时 */
+    bool push_active;            /* 当前为长轮询推送（否则为周期轮询） */
+    uint32_t push_reconnects;    /* 推送请求失败后的退避重连次数 */
+    uint32_t push_fallbacks;     /* 服务器不支持或连续失败而退回轮询的次数 */
+    uint32_t commands;           /* 收到的设备命令数 */
+} http_alarm_fetch_stats_t;
+
 typedef void (*alarm_trigger_cb_t)(const alarm_info_t *alarm, void *user_ctx);
 
+/* 推送通道下发的设备命令，在长轮询任务（或轮询时的网络任务）中回调，不应长时间阻塞 */
+typedef void (*alarm_command_cb_t)(const char *command, void *user_ctx);
+
+/* 智能唤醒窗口内由睡眠模块上报的浅睡信号 */
+typedef enum {
+    ALARM_SLEEP_SIGNAL_REM = 1,      /* 分期结果为 REM */
+    ALARM_SLEEP_SIGNAL_WAKE,         /* 入睡后醒来（已离开睡眠状态），观察期/未入睡不上报 */
+    ALARM_SLEEP_SIGNAL_AROUSAL,      /* 原始采样检测到的微觉醒（体动突增） */
+} alarm_sleep_signal_t;
+
 void wifi_init_sta(void);
 bool wifi_is_connected(void);
 bool wifi_wait_connected(uint32_t timeout_ms);
+/* Wi-Fi 断开时限频（WIFI_RECONNECT_PERIOD_MS）重连，由网络任务调用 */
+void wifi_reconnect_poll(void);
+/*
+ * 以下上传与闹钟请求都在网络任务（net_worker.h）中执行：同步接口提交后阻塞到完成，
+ * 在网络任务之外调用；闹钟状态回写另有异步接口。
+ */
+/* 单条上传；服务器回非 2xx 时返回 ESP_FAIL（该 epoch 未入库） */
 esp_err_t http_send_health_data(const health_data_t *data);
+/**
+ * @brief 批量上传多个 epoch（POST /api/health/upload/batch）
+ *
+ * 请求：{"sentAt":<unix s>,"items":[...],"report":{...}}，items 按时间升序，字段与单条上传相同，
+ *        ts 为 0 表示设备时间未同步（服务器可按 sentAt 与顺序推算）；report 为可选的当晚质量报告。
+ *        载荷为 CBOR（application/cbor，整数键）或 JSON，字段表见 telemetry_codec.h；
+ *        服务器不支持 CBOR 时回复 415，设备改用 JSON 重发并在本次运行内保持。
+ * 响应：2xx JSON {"code":0,"accepted":N}，N 为已处理（入库或判为无效丢弃）的前 N 条，
+ *        其余由设备下次重发；缺省 accepted 视为全部接受。服务器按 ts 去重，重发是幂等的。
+ *
+ * @param report    可为 NULL
+ * @param accepted  服务器确认的前缀条数
+ * @return ESP_OK 2xx；ESP_ERR_NOT_SUPPORTED 服务器无批量接口 (404/405)；
+ *         ESP_ERR_INVALID_SIZE 请求体过大 (413 或超出编码缓冲)；其他失败 ESP_FAIL
+ */
+esp_err_t http_send_health_batch(const health_data_t *items, size_t count,
+                                 const sleep_quality_report_t *report, size_t *accepted);
+esp_err_t http_send_night_summary(const uint8_t *blob, size_t len);
+void http_upload_get_stats(http_upload_stats_t *out);
 esp_err_t http_set_alarm_server(const char *host, uint16_t port);
 esp_err_t http_set_alarm_user(const char *user_id);
 esp_err_t http_fetch_alarms(alarm_list_t *out_list);
+/**
+ * @brief 条件拉取闹钟列表：带上次的 ETag 发 If-None-Match，304 时不下载正文；
+ *        服务器不返回 ETag 时比较正文哈希。
+ * @param changed  false 表示列表与上次成功拉取时相同，此时 out_list 内容无效
+ */
+esp_err_t http_fetch_alarms_if_changed(alarm_list_t *out_list, bool *changed);
+void http_alarm_get_fetch_stats(http_alarm_fetch_stats_t *out);
 esp_err_t http_update_alarm_status(int alarm_id, int status);
+/* 异步回写闹钟状态：失败按退避重试，done 在网络任务中回调，可为 NULL */
+esp_err_t http_update_alarm_status_async(int alarm_id, int status, net_done_cb_t done, void *ctx);
 time_t alarm_compute_next_trigger(const alarm_info_t *alarm, const struct tm *now_local);
 bool alarm_is_due(const alarm_info_t *alarm, const struct tm *now_local);
+/**
+ * @brief 启动闹钟服务
+ *
+ * ALARM_PUSH_ENABLE 时以长轮询作为推送通道：GET /api/alarms/list/<user>?wait=<s> 带 If-None-Match，
+ * 服务器挂起请求直到列表变化或有设备命令（回 200，命令在 data.command）或等待超时（回 304），
+ * 设备随即发起下一次请求，闹钟变更在一个往返内到达。请求失败按指数退避加抖动重连；
+ * 服务器不挂起请求（不支持 wait）或连续失败时退回 fetch_interval_ms 周期轮询，一段时间后再试推送。
+ * 长轮询在独立任务与连接上挂起，网络任务中的状态回写与上传不受影响。
+ */
 esp_err_t alarm_service_start(uint32_t fetch_interval_ms, alarm_trigger_cb_t cb, void *cb_ctx);
+void alarm_service_set_command_cb(alarm_command_cb_t cb, void *cb_ctx);
+bool alarm_service_wake_window_active(void);
+void alarm_service_report_sleep_signal(alarm_sleep_signal_t signal);
 
 #endif // HTTP_REQUEST_H
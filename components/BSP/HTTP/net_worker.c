@@ -0,0 +1,291 @@
+#include "net_worker.h"
+
+#include <stdint.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "http_request.h"
+
+#define TAG "NET_WORKER"
+
+#define NET_WORKER_STACK         6144
+#define NET_WORKER_PRIO          4
+#define NET_WORKER_LINK_WAIT_MS  5000    /* 断网时等待重连的时长，期间到期的请求计一次失败 */
+#define NET_WORKER_LINK_POLL_MS  1000
+#define NET_RETRY_BASE_MS        1000
+#define NET_RETRY_MAX_MS         30000
+
+typedef struct {
+    bool used;
+    uint8_t prio;
+    uint8_t attempts;
+    uint32_t seq;                /* 同级按提交顺序 */
+    int64_t due_us;
+    net_job_t job;
+    uint8_t data[NET_JOB_DATA_MAX];
+} net_slot_t;
+
+static net_slot_t s_slots[NET_WORKER_SLOTS];
+static SemaphoreHandle_t s_lock = NULL;
+static TaskHandle_t s_task = NULL;
+static uint32_t s_seq = 0;
+static net_worker_stats_t s_stats = {0};
+
+/* 调用方在 net_worker_call 中阻塞等待的完成信号 */
+typedef struct {
+    SemaphoreHandle_t sem;
+    esp_err_t err;
+} net_call_t;
+
+static void lock(void)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+}
+
+static void unlock(void)
+{
+    xSemaphoreGive(s_lock);
+}
+
+/* 参数、尺寸、不支持类错误重试也不会成功 */
+static bool retryable(esp_err_t err)
+{
+    return err != ESP_ERR_INVALID_ARG && err != ESP_ERR_INVALID_SIZE && err != ESP_ERR_NOT_SUPPORTED;
+}
+
+uint32_t net_worker_backoff_ms(uint32_t attempt)
+{
+    uint32_t base = NET_RETRY_BASE_MS;
+    while (attempt > 1 && base < NET_RETRY_MAX_MS) {
+        base *= 2U;
+        attempt--;
+    }
+    if (base > NET_RETRY_MAX_MS) {
+        base = NET_RETRY_MAX_MS;
+    }
+    /* 等量抖动：大量设备在服务器恢复时不会同时重连 */
+    const uint32_t half = base / 2U;
+    return half + esp_random() % (half + 1U);
+}
+
+/* 取已到期请求中优先级最高、提交最早者；*next_us 返回最早的未到期时间 */
+static int pick_due(int64_t now_us, int64_t *next_us)
+{
+    int best = -1;
+    *next_us = INT64_MAX;
+    lock();
+    for (int i = 0; i < NET_WORKER_SLOTS; ++i) {
+        const net_slot_t *s = &s_slots[i];
+        if (!s->used) {
+            continue;
+        }
+        if (s->due_us > now_us) {
+            if (s->due_us < *next_us) {
+                *next_us = s->due_us;
+            }
+            continue;
+        }
+        if (best < 0 || s->prio < s_slots[best].prio ||
+            (s->prio == s_slots[best].prio && (int32_t)(s->seq - s_slots[best].seq) < 0)) {
+            best = i;
+        }
+    }
+    unlock();
+    return best;
+}
+
+static void finish(int idx, esp_err_t err)
+{
+    net_slot_t *s = &s_slots[idx];
+    const uint8_t max_attempts = (s->job.max_attempts == 0) ? 1U : s->job.max_attempts;
+    if (err != ESP_OK && retryable(err) && ++s->attempts < max_attempts) {
+        const uint32_t delay_ms = net_worker_backoff_ms(s->attempts);
+        ESP_LOGD(TAG, "job prio %u failed (%s), retry %u in %lu ms", (unsigned)s->prio, esp_err_to_name(err),
+                 (unsigned)s->attempts, (unsigned long)delay_ms);
+        lock();
+        s->due_us = esp_timer_get_time() + (int64_t)delay_ms * 1000;
+        unlock();
+        s_stats.retries++;
+        return;
+    }
+
+    const net_done_cb_t done = s->job.done;
+    void *ctx = s->job.ctx;
+    lock();
+    s->used = false;
+    unlock();
+    if (err == ESP_OK) {
+        s_stats.completed++;
+    } else {
+        s_stats.failed++;
+    }
+    if (done) {
+        done(err, ctx);
+    }
+}
+
+static void run_slot(int idx, int64_t now_us, bool link)
+{
+    net_slot_t *s = &s_slots[idx];
+    const uint32_t wait_ms = (uint32_t)((now_us - s->due_us) / 1000);
+    if (wait_ms > s_stats.max_wait_ms) {
+        s_stats.max_wait_ms = wait_ms;
+    }
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    if (link) {
+        err = s->job.run(s->job.arg ? s->job.arg : s->data);
+    } else {
+        s_stats.offline++;
+    }
+    finish(idx, err);
+}
+
+static void net_worker_task(void *arg)
+{
+    int64_t offline_until_us = 0;
+    while (1) {
+        int64_t now_us = esp_timer_get_time();
+        bool link = wifi_is_connected();
+        if (!link) {
+            wifi_reconnect_poll();
+        }
+
+        int64_t next_us = INT64_MAX;
+        const int idx = pick_due(now_us, &next_us);
+        if (idx >= 0) {
+            /* 断网时只等待一次，之后一段时间内到期的请求直接计失败，调用方不会逐个等待 */
+            if (!link && now_us >= offline_until_us) {
+                link = wifi_wait_connected(NET_WORKER_LINK_WAIT_MS);
+                now_us = esp_timer_get_time();
+                if (!link) {
+                    offline_until_us = now_us + (int64_t)NET_WORKER_LINK_WAIT_MS * 1000;
+                }
+            }
+            run_slot(idx, now_us, link);
+            s_stats.stack_free = (uint32_t)uxTaskGetStackHighWaterMark(NULL);
+            continue;
+        }
+
+        int64_t wake_us = next_us;
+        if (!link && now_us + (int64_t)NET_WORKER_LINK_POLL_MS * 1000 < wake_us) {
+            wake_us = now_us + (int64_t)NET_WORKER_LINK_POLL_MS * 1000;
+        }
+        const TickType_t ticks = (wake_us == INT64_MAX) ? portMAX_DELAY :
+                                 pdMS_TO_TICKS((uint32_t)((wake_us - now_us + 999) / 1000));
+        /* 新请求提交时被通知唤醒 */
+        (void)ulTaskNotifyTake(pdTRUE, (ticks == 0) ? 1 : ticks);
+    }
+}
+
+esp_err_t net_worker_start(void)
+{
+    if (s_task) {
+        return ESP_OK;
+    }
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        if (!s_lock) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (xTaskCreate(net_worker_task, "net_worker", NET_WORKER_STACK, NULL, NET_WORKER_PRIO, &s_task) != pdPASS) {
+        s_task = NULL;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t net_worker_submit(net_prio_t prio, const net_job_t *job, const void *data, size_t len)
+{
+    if (!job || !job->run || prio >= NET_PRIO_COUNT || len > NET_JOB_DATA_MAX || (len > 0 && !data)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int idx = -1;
+    uint32_t depth = 0;
+    lock();
+    for (int i = 0; i < NET_WORKER_SLOTS; ++i) {
+        if (s_slots[i].used) {
+            depth++;
+        } else if (idx < 0) {
+            idx = i;
+        }
+    }
+    if (idx >= 0) {
+        net_slot_t *s = &s_slots[idx];
+        s->used = true;
+        s->prio = (uint8_t)prio;
+        s->attempts = 0;
+        s->seq = s_seq++;
+        s->due_us = esp_timer_get_time() + (int64_t)job->delay_ms * 1000;
+        s->job = *job;
+        if (len > 0) {
+            memcpy(s->data, data, len);
+        }
+        depth++;
+    }
+    unlock();
+
+    if (idx < 0) {
+        s_stats.rejected++;
+        ESP_LOGW(TAG, "queue full, job prio %u rejected", (unsigned)prio);
+        return ESP_ERR_NO_MEM;
+    }
+    s_stats.submitted++;
+    if (depth > s_stats.max_depth) {
+        s_stats.max_depth = depth;
+    }
+    xTaskNotifyGive(s_task);
+    return ESP_OK;
+}
+
+static void call_done(esp_err_t err, void *ctx)
+{
+    net_call_t *call = (net_call_t *)ctx;
+    call->err = err;
+    xSemaphoreGive(call->sem);
+}
+
+esp_err_t net_worker_call(net_prio_t prio, net_job_fn_t run, void *arg, uint8_t max_attempts)
+{
+    if (!run) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_task || xTaskGetCurrentTaskHandle() == s_task) {
+        return run(arg);
+    }
+
+    StaticSemaphore_t sem_buf;
+    net_call_t call = {
+        .sem = xSemaphoreCreateBinaryStatic(&sem_buf),
+        .err = ESP_FAIL,
+    };
+    const net_job_t job = {
+        .run = run,
+        .arg = arg,
+        .done = call_done,
+        .ctx = &call,
+        .max_attempts = max_attempts,
+    };
+    esp_err_t err = net_worker_submit(prio, &job, NULL, 0);
+    if (err != ESP_OK) {
+        return err;
+    }
+    /* 不设超时：请求槽引用本栈帧，必须等网络任务回调 */
+    xSemaphoreTake(call.sem, portMAX_DELAY);
+    return call.err;
+}
+
+void net_worker_get_stats(net_worker_stats_t *out)
+{
+    if (out) {
+        *out = s_stats;
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef NET_WORKER_H
+#define NET_WORKER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * 网络任务：执行上传与闹钟请求的任务，持有上传与闹钟两条 keep-alive 连接（闹钟长轮询另有任务与连接）。
+ *
+ * - 请求按优先级执行：闹钟状态回写 > 闹钟拉取 > 遥测上传；同级按提交顺序
+ * - 失败的请求（参数/尺寸/不支持类错误除外）按指数退避加抖动延期重试，直到 max_attempts
+ * - Wi-Fi 断开时只由本任务等待与限频重连，请求直接以 ESP_ERR_INVALID_STATE 计一次失败
+ * 请求槽为静态数组，不分配堆。
+ */
+
+#define NET_WORKER_SLOTS      12      /* 同时排队（含延期重试）的请求上限 */
+#define NET_JOB_DATA_MAX      24      /* 随请求复制的参数字节数上限 */
+
+typedef enum {
+    NET_PRIO_ALARM_STATUS = 0,   /* 闹钟状态回写 */
+    NET_PRIO_ALARM_FETCH,        /* 闹钟列表拉取 */
+    NET_PRIO_TELEMETRY,          /* 健康数据、整晚摘要 */
+    NET_PRIO_COUNT,
+} net_prio_t;
+
+/* 在网络任务中执行一次请求；返回 ESP_OK 为成功 */
+typedef esp_err_t (*net_job_fn_t)(void *arg);
+/* 请求最终完成（成功或重试用尽）时在网络任务中回调，不应阻塞 */
+typedef void (*net_done_cb_t)(esp_err_t err, void *ctx);
+
+typedef struct {
+    net_job_fn_t run;
+    void *arg;               /* 为 NULL 时 run 收到提交时复制的 data */
+    net_done_cb_t done;      /* 可为 NULL */
+    void *ctx;
+    uint8_t max_attempts;    /* 0 视为 1 */
+    uint32_t delay_ms;       /* 首次执行前的延迟 */
+} net_job_t;
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t failed;             /* 重试用尽或不可重试 */
+    uint32_t retries;
+    uint32_t rejected;           /* 请求槽已满 */
+    uint32_t offline;            /* 因 Wi-Fi 断开未执行的次数 */
+    uint32_t max_depth;          /* 排队请求数峰值 */
+    uint32_t max_wait_ms;        /* 到期后等待执行的最长时间 */
+    uint32_t stack_free;         /* 网络任务栈高水位余量 */
+} net_worker_stats_t;
+
+esp_err_t net_worker_start(void);
+
+/**
+ * @brief 异步提交请求
+ * @param data  复制进请求槽的参数（最多 NET_JOB_DATA_MAX 字节），job->arg 为 NULL 时传给 run
+ * @return ESP_ERR_NO_MEM 请求槽已满
+ */
+esp_err_t net_worker_submit(net_prio_t prio, const net_job_t *job, const void *data, size_t len);
+
+/**
+ * @brief 同步执行：提交后阻塞到完成，返回最后一次执行的结果。
+ *        在网络任务中调用或网络任务未启动时直接执行（不重试）。
+ */
+esp_err_t net_worker_call(net_prio_t prio, net_job_fn_t run, void *arg, uint8_t max_attempts);
+
+/* 第 attempt 次（从1起）失败后的退避：基数翻倍封顶后取 [一半, 全部] 的随机值 */
+uint32_t net_worker_backoff_ms(uint32_t attempt);
+
+void net_worker_get_stats(net_worker_stats_t *out);
+
+#endif // NET_WORKER_H
@@ -0,0 +1,362 @@
+#include "telemetry_codec.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define TW_MAX_DEPTH 4
+
+/* CBOR 主类型 */
+#define CBOR_UINT  0U
+#define CBOR_NINT  1U
+#define CBOR_TEXT  3U
+#define CBOR_ARRAY 4U
+#define CBOR_MAP   5U
+#define CBOR_FLOAT32 0xFAU
+
+/* 定长缓冲写入器，越界后只置溢出标志，不再写入 */
+typedef struct {
+    telemetry_format_t format;
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+    int depth;
+    bool is_map[TW_MAX_DEPTH];
+    uint16_t count[TW_MAX_DEPTH];   /* 当前容器已写入的元素/键数，JSON 据此加逗号 */
+} tw_t;
+
+static void tw_init(tw_t *w, telemetry_format_t format, uint8_t *out, size_t cap)
+{
+    memset(w, 0, sizeof(*w));
+    w->format = format;
+    w->buf = out;
+    w->cap = out ? cap : 0;
+    w->depth = -1;
+}
+
+static void tw_put(tw_t *w, const void *data, size_t n)
+{
+    if (w->overflow || n > w->cap - w->len) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, n);
+    w->len += n;
+}
+
+static void tw_byte(tw_t *w, uint8_t b)
+{
+    tw_put(w, &b, 1);
+}
+
+static void tw_str(tw_t *w, const char *s)
+{
+    tw_put(w, s, strlen(s));
+}
+
+static void cbor_head(tw_t *w, uint8_t major, uint64_t v)
+{
+    uint8_t h[9];
+    size_t n;
+    if (v < 24U) {
+        h[0] = (uint8_t)((major << 5) | v);
+        n = 1;
+    } else if (v <= 0xFFU) {
+        h[0] = (uint8_t)((major << 5) | 24U);
+        h[1] = (uint8_t)v;
+        n = 2;
+    } else if (v <= 0xFFFFU) {
+        h[0] = (uint8_t)((major << 5) | 25U);
+        h[1] = (uint8_t)(v >> 8);
+        h[2] = (uint8_t)v;
+        n = 3;
+    } else if (v <= 0xFFFFFFFFU) {
+        h[0] = (uint8_t)((major << 5) | 26U);
+        for (int i = 0; i < 4; ++i) {
+            h[1 + i] = (uint8_t)(v >> (24 - 8 * i));
+        }
+        n = 5;
+    } else {
+        h[0] = (uint8_t)((major << 5) | 27U);
+        for (int i = 0; i < 8; ++i) {
+            h[1 + i] = (uint8_t)(v >> (56 - 8 * i));
+        }
+        n = 9;
+    }
+    tw_put(w, h, n);
+}
+
+/* 十进制输出，不经 printf（newlib 浮点格式化会分配堆） */
+static void json_u64(tw_t *w, uint64_t v)
+{
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10U);
+        v /= 10U;
+    } while (v);
+    while (n) {
+        tw_byte(w, (uint8_t)tmp[--n]);
+    }
+}
+
+/* JSON 数组元素/对象键之前的逗号 */
+static void tw_sep(tw_t *w)
+{
+    if (w->format == TELEMETRY_FORMAT_JSON && w->depth >= 0 && w->count[w->depth]++ > 0) {
+        tw_byte(w, ',');
+    }
+}
+
+static void tw_value_sep(tw_t *w)
+{
+    if (w->depth >= 0 && !w->is_map[w->depth]) {
+        tw_sep(w);
+    }
+}
+
+static void tw_open(tw_t *w, bool is_map, size_t n)
+{
+    tw_value_sep(w);
+    if (w->format == TELEMETRY_FORMAT_CBOR) {
+        cbor_head(w, is_map ? CBOR_MAP : CBOR_ARRAY, n);
+    } else {
+        tw_byte(w, is_map ? '{' : '[');
+    }
+    if (w->depth + 1 >= TW_MAX_DEPTH) {
+        w->overflow = true;
+        return;
+    }
+    w->depth++;
+    w->is_map[w->depth] = is_map;
+    w->count[w->depth] = 0;
+}
+
+static void tw_close(tw_t *w)
+{
+    if (w->depth < 0) {
+        return;
+    }
+    if (w->format == TELEMETRY_FORMAT_JSON) {
+        tw_byte(w, w->is_map[w->depth] ? '}' : ']');
+    }
+    w->depth--;
+}
+
+static void tw_key(tw_t *w, unsigned idx, const char *name)
+{
+    tw_sep(w);
+    if (w->format == TELEMETRY_FORMAT_CBOR) {
+        cbor_head(w, CBOR_UINT, idx);
+    } else {
+        tw_byte(w, '"');
+        tw_str(w, name);
+        tw_str(w, "\":");
+    }
+}
+
+static void tw_int(tw_t *w, int64_t v)
+{
+    tw_value_sep(w);
+    if (w->format == TELEMETRY_FORMAT_CBOR) {
+        if (v >= 0) {
+            cbor_head(w, CBOR_UINT, (uint64_t)v);
+        } else {
+            cbor_head(w, CBOR_NINT, (uint64_t)(-(v + 1)));
+        }
+        return;
+    }
+    if (v < 0) {
+        tw_byte(w, '-');
+        json_u64(w, (uint64_t)(-(v + 1)) + 1U);
+    } else {
+        json_u64(w, (uint64_t)v);
+    }
+}
+
+static void tw_text(tw_t *w, const char *s)
+{
+    tw_value_sep(w);
+    const size_t n = strlen(s);
+    if (w->format == TELEMETRY_FORMAT_CBOR) {
+        cbor_head(w, CBOR_TEXT, n);
+        tw_put(w, s, n);
+        return;
+    }
+    tw_byte(w, '"');
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t c = (uint8_t)s[i];
+        if (c == '"' || c == '\\') {
+            tw_byte(w, '\\');
+            tw_byte(w, c);
+        } else if (c < 0x20U) {
+            static const char hex[] = "0123456789abcdef";
+            tw_str(w, "\\u00");
+            tw_byte(w, (uint8_t)hex[c >> 4]);
+            tw_byte(w, (uint8_t)hex[c & 0xFU]);
+        } else {
+            tw_byte(w, c);
+        }
+    }
+    tw_byte(w, '"');
+}
+
+/* 浮点：CBOR float32；JSON 定点小数，非有限值写 0 */
+/* 按 IEEE 754 指数位判断 NaN/Inf；组件以 -ffast-math 编译，v == v 之类的比较可能被优化掉 */
+static bool float_is_finite(float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return (bits & 0x7F800000U) != 0x7F800000U;
+}
+
+static void tw_float(tw_t *w, float v, unsigned decimals)
+{
+    tw_value_sep(w);
+    if (!float_is_finite(v)) {
+        v = 0.0f;
+    }
+    if (w->format == TELEMETRY_FORMAT_CBOR) {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        const uint8_t b[5] = {CBOR_FLOAT32, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16),
+                              (uint8_t)(bits >> 8), (uint8_t)bits};
+        tw_put(w, b, sizeof(b));
+        return;
+    }
+
+    uint32_t scale = 1;
+    for (unsigned i = 0; i < decimals; ++i) {
+        scale *= 10U;
+    }
+    if (v > 1e9f || v < -1e9f) {
+        v = 0.0f;
+    }
+    if (v < 0.0f) {
+        tw_byte(w, '-');
+        v = -v;
+    }
+    const uint64_t fixed = (uint64_t)((double)v * scale + 0.5);
+    json_u64(w, fixed / scale);
+    if (decimals) {
+        tw_byte(w, '.');
+        uint64_t frac = fixed % scale;
+        for (uint32_t d = scale / 10U; d > 0; d /= 10U) {
+            tw_byte(w, (uint8_t)('0' + (frac / d) % 10U));
+        }
+    }
+}
+
+static size_t tw_finish(const tw_t *w)
+{
+    return (w->overflow || w->depth != -1) ? 0 : w->len;
+}
+
+static void write_health(tw_t *w, const health_data_t *d)
+{
+    const size_t fields = 4U + (d->timestamp ? 1U : 0U) + (d->radar_status[0] ? 1U : 0U) +
+                          (d->radar_score > 0 ? 1U : 0U);
+    tw_open(w, true, fields);
+    if (d->timestamp) {
+        tw_key(w, 0, "ts");
+        tw_int(w, d->timestamp);
+    }
+    tw_key(w, 1, "heartRate");
+    tw_int(w, d->heart_rate);
+    tw_key(w, 2, "breathingRate");
+    tw_int(w, d->breathing_rate);
+    tw_key(w, 3, "sleepStatus");
+    tw_text(w, d->sleep_status[0] ? d->sleep_status : "UNKNOWN");
+    if (d->radar_status[0]) {
+        tw_key(w, 4, "radarSleepStatus");
+        tw_text(w, d->radar_status);
+    }
+    if (d->radar_score > 0) {
+        tw_key(w, 5, "radarSleepScore");
+        tw_int(w, d->radar_score);
+    }
+    tw_key(w, 6, "arousals");
+    tw_int(w, d->arousals);
+    tw_close(w);
+}
+
+static void write_quality(tw_t *w, const sleep_quality_report_t *r)
+{
+    tw_open(w, true, 10);
+    tw_key(w, 0, "wakeSeconds");
+    tw_int(w, r->wake_seconds);
+    tw_key(w, 1, "remSeconds");
+    tw_int(w, r->rem_seconds);
+    tw_key(w, 2, "nremSeconds");
+    tw_int(w, r->nrem_seconds);
+    tw_key(w, 3, "remRatio");
+    tw_float(w, r->rem_ratio, 4);
+    tw_key(w, 4, "sleepEfficiency");
+    tw_float(w, r->sleep_efficiency, 4);
+    tw_key(w, 5, "avgRespRate");
+    tw_float(w, r->average_resp_rate, 2);
+    tw_key(w, 6, "avgMotion");
+    tw_float(w, r->average_motion, 4);
+    tw_key(w, 7, "avgHeartRate");
+    tw_float(w, r->average_heart_rate, 2);
+    tw_key(w, 8, "avgHrv");
+    tw_float(w, r->average_hrv, 2);
+    tw_key(w, 9, "sleepScore");
+    tw_float(w, r->sleep_score, 2);
+    tw_close(w);
+}
+
+const char *telemetry_content_type(telemetry_format_t format)
+{
+    return (format == TELEMETRY_FORMAT_CBOR) ? "application/cbor" : "application/json";
+}
+
+size_t telemetry_encode_health(telemetry_format_t format, const health_data_t *item, uint8_t *out, size_t cap)
+{
+    if (!item) {
+        return 0;
+    }
+    tw_t w;
+    tw_init(&w, format, out, cap);
+    write_health(&w, item);
+    return tw_finish(&w);
+}
+
+size_t telemetry_encode_batch(telemetry_format_t format, uint32_t sent_at,
+                              const health_data_t *items, size_t count,
+                              const sleep_quality_report_t *report,
+                              uint8_t *out, size_t cap)
+{
+    if (!items && count > 0) {
+        return 0;
+    }
+    tw_t w;
+    tw_init(&w, format, out, cap);
+    tw_open(&w, true, report ? 3U : 2U);
+    tw_key(&w, 0, "sentAt");
+    tw_int(&w, sent_at);
+    tw_key(&w, 1, "items");
+    tw_open(&w, false, count);
+    for (size_t i = 0; i < count && !w.overflow; ++i) {
+        write_health(&w, &items[i]);
+    }
+    tw_close(&w);
+    if (report) {
+        tw_key(&w, 2, "report");
+        write_quality(&w, report);
+    }
+    tw_close(&w);
+    return tw_finish(&w);
+}
+
+size_t telemetry_encode_quality(telemetry_format_t format, const sleep_quality_report_t *report,
+                                uint8_t *out, size_t cap)
+{
+    if (!report) {
+        return 0;
+    }
+    tw_t w;
+    tw_init(&w, format, out, cap);
+    write_quality(&w, report);
+    return tw_finish(&w);
+}
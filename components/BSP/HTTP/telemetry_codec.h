@@ -0,0 +1,47 @@
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "http_request.h"
+#include "sleep_analysis.h"
+
+/*
+ * 上传载荷编码：直接写入调用方提供的定长缓冲，不分配堆、不构建 cJSON 树。
+ *
+ * 两种格式字段相同，由 Content-Type 区分：
+ *   application/json  紧凑 JSON，键名见下表
+ *   application/cbor  RFC 8949 CBOR，map 键为下表中的小整数（定长、省去键名字节）
+ *
+ * 单条 epoch（health_data_t）：
+ *   0 ts  1 heartRate  2 breathingRate  3 sleepStatus  4 radarSleepStatus*  5 radarSleepScore*  6 arousals
+ * 批量（POST /api/health/upload/batch）：
+ *   0 sentAt  1 items（上表 map 的数组）  2 report*（下表 map）
+ * 质量报告（sleep_quality_report_t）：
+ *   0 wakeSeconds  1 remSeconds  2 nremSeconds  3 remRatio  4 sleepEfficiency
+ *   5 avgRespRate  6 avgMotion  7 avgHeartRate  8 avgHrv  9 sleepScore
+ * 带 * 的字段缺省时省略；ts 为 0 时省略。整数为 CBOR 整数，比例与均值为 float32；
+ * JSON 中比例与运动指数保留4位小数、其余浮点保留2位。
+ *
+ * 各编码函数返回写入的字节数，缓冲不足返回 0。
+ */
+
+typedef enum {
+    TELEMETRY_FORMAT_JSON = 0,
+    TELEMETRY_FORMAT_CBOR,
+} telemetry_format_t;
+
+const char *telemetry_content_type(telemetry_format_t format);
+
+size_t telemetry_encode_health(telemetry_format_t format, const health_data_t *item, uint8_t *out, size_t cap);
+
+/* report 为 NULL 时省略 */
+size_t telemetry_encode_batch(telemetry_format_t format, uint32_t sent_at,
+                              const health_data_t *items, size_t count,
+                              const sleep_quality_report_t *report,
+                              uint8_t *out, size_t cap);
+
+size_t telemetry_encode_quality(telemetry_format_t format, const sleep_quality_report_t *report,
+                                uint8_t *out, size_t cap);
+
+#endif // TELEMETRY_CODEC_H
@@ -0,0 +1,256 @@
+#include "binlog.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#define BINLOG_TASK_STACK    3072U
+#define BINLOG_TASK_PRIO     1
+#define BINLOG_LINE_MAX      256U
+
+_Static_assert((BINLOG_RING_LEN & (BINLOG_RING_LEN - 1U)) == 0, "BINLOG_RING_LEN must be a power of two");
+
+static const char *TAG = "binlog";
+
+/*
+ * Vyukov 有界队列：每个槽位带序号 seq。
+ * 生产者：seq == pos 表示槽位空闲，CAS 推进 s_tail 占位后写入，再置 seq = pos+1 发布；
+ * 消费者：seq == pos+1 表示已发布，读出后置 seq = pos+LEN 归还给下一圈的生产者。
+ * 占位与发布分离，生产者之间只竞争一次 CAS，不会互相等待。
+ */
+typedef struct
+{
+    uint32_t seq;
+    uint32_t ts_us;              /* esp_timer 低32位，刷写时按上一条展开 */
+    const binlog_event_t *event;
+    uint32_t nargs;
+    binlog_arg_t args[BINLOG_MAX_ARGS];
+} binlog_record_t;
+
+static binlog_record_t s_ring[BINLOG_RING_LEN];
+static uint32_t s_tail = 0;       /* 生产者占位位置 */
+static uint32_t s_head = 0;       /* 消费者位置，仅刷写任务访问 */
+static volatile bool s_ready = false;
+
+static uint32_t s_written = 0;
+static uint32_t s_dropped = 0;
+static binlog_stats_t s_stats;    /* 刷写任务维护的部分 */
+
+volatile uint8_t g_binlog_level[BINLOG_MOD_COUNT] = {
+    [BINLOG_MOD_RADAR] = BINLOG_LEVEL_INFO,
+    [BINLOG_MOD_PRESENCE] = BINLOG_LEVEL_INFO,
+    [BINLOG_MOD_SLEEP] = BINLOG_LEVEL_INFO,
+    [BINLOG_MOD_REPORT] = BINLOG_LEVEL_INFO,
+};
+
+void binlog_write(const binlog_event_t *event, uint32_t nargs, const binlog_arg_t *args)
+{
+    if (!s_ready)
+    {
+        return;
+    }
+
+    binlog_record_t *rec;
+    uint32_t pos = __atomic_load_n(&s_tail, __ATOMIC_RELAXED);
+    for (;;)
+    {
+        rec = &s_ring[pos & (BINLOG_RING_LEN - 1U)];
+        const int32_t dif = (int32_t)(__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) - pos);
+        if (dif == 0)
+        {
+            if (__atomic_compare_exchange_n(&s_tail, &pos, pos + 1U, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (dif < 0)
+        {
+            __atomic_fetch_add(&s_dropped, 1U, __ATOMIC_RELAXED);   /* 环满：丢弃，不等待刷写 */
+            return;
+        }
+        else
+        {
+            pos = __atomic_load_n(&s_tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    rec->ts_us = (uint32_t)esp_timer_get_time();
+    rec->event = event;
+    rec->nargs = nargs;
+    for (uint32_t i = 0; i < nargs; ++i)
+    {
+        rec->args[i] = args[i];
+    }
+    __atomic_store_n(&rec->seq, pos + 1U, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&s_written, 1U, __ATOMIC_RELAXED);
+}
+
+/* 按格式串逐个转换说明符格式化，参数类型由转换字符决定 */
+static size_t binlog_format(char *out, size_t cap, const binlog_record_t *rec)
+{
+    const char *p = rec->event->fmt;
+    size_t len = 0;
+    uint32_t argi = 0;
+
+    while (*p && len + 1U < cap)
+    {
+        if (*p != '%')
+        {
+            out[len++] = *p++;
+            continue;
+        }
+        if (p[1] == '%')
+        {
+            out[len++] = '%';
+            p += 2;
+            continue;
+        }
+
+        /* 截取一个转换说明 "%-5.1f"/"%lu" 等 */
+        char spec[16];
+        size_t n = 0;
+        bool is_long = false;
+        spec[n++] = *p++;
+        while (*p && strchr("-+ #0123456789.hlzjt", *p) && n < sizeof(spec) - 2U)
+        {
+            is_long |= (*p == 'l');
+            spec[n++] = *p++;
+        }
+        if (!*p)
+        {
+            break;
+        }
+        const char conv = *p++;
+        spec[n++] = conv;
+        spec[n] = '\0';
+
+        const binlog_arg_t a = (argi < rec->nargs) ? rec->args[argi] : (binlog_arg_t){.u = 0};
+        argi++;
+
+        int w;
+        switch (conv)
+        {
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+            w = snprintf(out + len, cap - len, spec, (double)a.f);
+            break;
+        case 's':
+            w = snprintf(out + len, cap - len, spec, a.s ? a.s : "(null)");
+            break;
+        case 'd': case 'i': case 'c':
+            w = is_long ? snprintf(out + len, cap - len, spec, (long)a.i) : snprintf(out + len, cap - len, spec, (int)a.i);
+            break;
+        default:   /* u/x/X/o */
+            w = is_long ? snprintf(out + len, cap - len, spec, (unsigned long)a.u)
+                        : snprintf(out + len, cap - len, spec, (unsigned)a.u);
+            break;
+        }
+        if (w > 0)
+        {
+            len += ((size_t)w < cap - len) ? (size_t)w : cap - len - 1U;
+        }
+    }
+    out[len] = '\0';
+    return len;
+}
+
+static void binlog_flush_task(void *arg)
+{
+    static char line[BINLOG_LINE_MAX];
+    int64_t last_us = esp_timer_get_time();
+    uint32_t reported_drops = 0;
+
+    while (1)
+    {
+        const uint32_t depth = __atomic_load_n(&s_tail, __ATOMIC_RELAXED) - s_head;
+        if (depth > s_stats.max_depth)
+        {
+            s_stats.max_depth = depth;
+        }
+
+        for (;;)
+        {
+            binlog_record_t *rec = &s_ring[s_head & (BINLOG_RING_LEN - 1U)];
+            if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != s_head + 1U)
+            {
+                break;
+            }
+
+            /* 32位时间戳约71分钟回绕，按上一条记录展开；并发写入时相邻记录可能略有倒序 */
+            last_us += (int32_t)(rec->ts_us - (uint32_t)last_us);
+            size_t len = 0;
+#if BINLOG_TIMESTAMP
+            len = (size_t)snprintf(line, sizeof(line), "(%lu) ", (unsigned long)(last_us / 1000U));
+#endif
+            binlog_format(line + len, sizeof(line) - len, rec);
+            __atomic_store_n(&rec->seq, s_head + BINLOG_RING_LEN, __ATOMIC_RELEASE);
+            s_head++;
+
+            fputs(line, stdout);
+            s_stats.flushed++;
+            const int64_t lag_ms = (esp_timer_get_time() - last_us) / 1000;
+            if (lag_ms > (int64_t)s_stats.max_lag_ms)
+            {
+                s_stats.max_lag_ms = (uint32_t)lag_ms;
+            }
+        }
+
+        const uint32_t drops = __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+        if (drops != reported_drops)
+        {
+            printf("[日志] 环满丢弃 %lu 条\n", (unsigned long)(drops - reported_drops));
+            reported_drops = drops;
+        }
+        fflush(stdout);
+        vTaskDelay(pdMS_TO_TICKS(BINLOG_FLUSH_MS));
+    }
+}
+
+esp_err_t binlog_init(void)
+{
+    if (s_ready)
+    {
+        return ESP_OK;
+    }
+
+    for (uint32_t i = 0; i < BINLOG_RING_LEN; ++i)
+    {
+        s_ring[i].seq = i;
+    }
+    s_tail = 0;
+    s_head = 0;
+
+    if (xTaskCreate(binlog_flush_task, "binlog_flush", BINLOG_TASK_STACK, NULL, BINLOG_TASK_PRIO, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "create flush task failed");
+        return ESP_FAIL;
+    }
+    __atomic_store_n(&s_ready, true, __ATOMIC_RELEASE);
+    return ESP_OK;
+}
+
+void binlog_set_level(binlog_module_t module, binlog_level_t level)
+{
+    if (module < BINLOG_MOD_COUNT && level <= BINLOG_LEVEL_DEBUG)
+    {
+        g_binlog_level[module] = (uint8_t)level;
+    }
+}
+
+binlog_level_t binlog_get_level(binlog_module_t module)
+{
+    return (module < BINLOG_MOD_COUNT) ? (binlog_level_t)g_binlog_level[module] : BINLOG_LEVEL_NONE;
+}
+
+void binlog_get_stats(binlog_stats_t *out)
+{
+    if (!out)
+    {
+        return;
+    }
+    *out = s_stats;
+    out->written = __atomic_load_n(&s_written, __ATOMIC_RELAXED);
+    out->dropped = __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+}
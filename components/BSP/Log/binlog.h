@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * 延迟格式化的二进制日志
+ *
+ * 热路径只写入定长记录（事件描述符 + 时间戳 + 参数字），不做格式化与串口输出：
+ * - 记录进入无锁环（Vyukov 有界队列，多生产者 CAS 占位、单消费者），环满即丢弃并计数，从不阻塞
+ * - 低优先级刷写任务取出记录，按描述符中的 printf 格式串格式化后输出到控制台
+ * - 各模块独立日志级别，级别判断在宏内完成，被过滤的调用不进入 binlog_write
+ *
+ * 用法与 printf 相同：BINLOG_I(BINLOG_MOD_RADAR, "心率: %d bpm\n", hr);
+ * 格式串必须是字面量；%s 参数必须指向静态字符串（刷写时才读取），不可传栈上缓冲区。
+ * 参数最多 BINLOG_MAX_ARGS 个，按 32 位字保存（float 原样保存，double 降为 float）。
+ */
+
+#define BINLOG_RING_LEN      128U     /* 记录数，必须为2的幂 */
+#define BINLOG_MAX_ARGS      8U
+#define BINLOG_FLUSH_MS      100U     /* 刷写任务轮询周期 */
+#define BINLOG_TIMESTAMP     0        /* 1: 每条记录前输出 "(毫秒) " 时间戳 */
+
+typedef enum
+{
+    BINLOG_MOD_RADAR = 0,        /* 雷达帧解析（心率/呼吸/体动逐条） */
+    BINLOG_MOD_PRESENCE,         /* 在床/离床 */
+    BINLOG_MOD_SLEEP,            /* 入睡状态机与分期事件 */
+    BINLOG_MOD_REPORT,           /* 每 epoch 的监测报告 */
+    BINLOG_MOD_COUNT
+} binlog_module_t;
+
+typedef enum
+{
+    BINLOG_LEVEL_NONE = 0,
+    BINLOG_LEVEL_ERROR,
+    BINLOG_LEVEL_WARN,
+    BINLOG_LEVEL_INFO,
+    BINLOG_LEVEL_DEBUG,
+} binlog_level_t;
+
+/* 调用点的静态描述符，其地址即事件 id */
+typedef struct
+{
+    const char *fmt;
+    uint8_t module;
+    uint8_t level;
+} binlog_event_t;
+
+typedef union
+{
+    uint32_t u;
+    int32_t i;
+    float f;
+    const char *s;
+} binlog_arg_t;
+
+typedef struct
+{
+    uint32_t written;            /* 已入环记录数 */
+    uint32_t dropped;            /* 环满丢弃数 */
+    uint32_t flushed;            /* 已输出记录数 */
+    uint32_t max_lag_ms;         /* 写入到输出的最大延迟 */
+    uint32_t max_depth;          /* 刷写时观察到的最大积压 */
+} binlog_stats_t;
+
+/* 各模块当前级别，宏内直接读取 */
+extern volatile uint8_t g_binlog_level[BINLOG_MOD_COUNT];
+
+/* 初始化环并启动刷写任务；之前的写入直接丢弃 */
+esp_err_t binlog_init(void);
+
+void binlog_set_level(binlog_module_t module, binlog_level_t level);
+binlog_level_t binlog_get_level(binlog_module_t module);
+
+/* 写入一条记录（由宏调用），可在任意任务中使用 */
+void binlog_write(const binlog_event_t *event, uint32_t nargs, const binlog_arg_t *args);
+
+void binlog_get_stats(binlog_stats_t *out);
+
+/* 参数按类型转成 32 位字 */
+static inline binlog_arg_t binlog_arg_f(double v) { binlog_arg_t a; a.f = (float)v; return a; }
+static inline binlog_arg_t binlog_arg_s(const char *v) { binlog_arg_t a; a.s = v; return a; }
+static inline binlog_arg_t binlog_arg_i(long long v) { binlog_arg_t a; a.i = (int32_t)v; return a; }
+
+#define BINLOG_ARG(x) _Generic((x),                  \
+        float: binlog_arg_f, double: binlog_arg_f,    \
+        char *: binlog_arg_s, const char *: binlog_arg_s, \
+        default: binlog_arg_i)(x)
+
+#define BINLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define BINLOG_NARGS(...) BINLOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define BINLOG_MAP_0()                     { .u = 0 }
+#define BINLOG_MAP_1(a)                    BINLOG_ARG(a)
+#define BINLOG_MAP_2(a, b)                 BINLOG_ARG(a), BINLOG_ARG(b)
+#define BINLOG_MAP_3(a, b, c)              BINLOG_MAP_2(a, b), BINLOG_ARG(c)
+#define BINLOG_MAP_4(a, b, c, d)           BINLOG_MAP_3(a, b, c), BINLOG_ARG(d)
+#define BINLOG_MAP_5(a, b, c, d, e)        BINLOG_MAP_4(a, b, c, d), BINLOG_ARG(e)
+#define BINLOG_MAP_6(a, b, c, d, e, f)     BINLOG_MAP_5(a, b, c, d, e), BINLOG_ARG(f)
+#define BINLOG_MAP_7(a, b, c, d, e, f, g)  BINLOG_MAP_6(a, b, c, d, e, f), BINLOG_ARG(g)
+#define BINLOG_MAP_8(a, b, c, d, e, f, g, h) BINLOG_MAP_7(a, b, c, d, e, f, g), BINLOG_ARG(h)
+#define BINLOG_CAT_(a, b) a##b
+#define BINLOG_CAT(a, b) BINLOG_CAT_(a, b)
+
+#define BINLOG(mod, lvl, fmt_, ...)                                                            \
+    do {                                                                                       \
+        if ((lvl) <= g_binlog_level[(mod)]) {                                                  \
+            static const binlog_event_t binlog_ev_ = {(fmt_), (uint8_t)(mod), (uint8_t)(lvl)}; \
+            const binlog_arg_t binlog_args_[] = {                                              \
+                BINLOG_CAT(BINLOG_MAP_, BINLOG_NARGS(__VA_ARGS__))(__VA_ARGS__)};              \
+            _Static_assert(BINLOG_NARGS(__VA_ARGS__) <= BINLOG_MAX_ARGS, "too many log args"); \
+            binlog_write(&binlog_ev_, BINLOG_NARGS(__VA_ARGS__), binlog_args_);                \
+        }                                                                                      \
+    } while (0)
+
+#define BINLOG_E(mod, fmt_, ...) BINLOG(mod, BINLOG_LEVEL_ERROR, fmt_, ##__VA_ARGS__)
+#define BINLOG_W(mod, fmt_, ...) BINLOG(mod, BINLOG_LEVEL_WARN, fmt_, ##__VA_ARGS__)
+#define BINLOG_I(mod, fmt_, ...) BINLOG(mod, BINLOG_LEVEL_INFO, fmt_, ##__VA_ARGS__)
+#define BINLOG_D(mod, fmt_, ...) BINLOG(mod, BINLOG_LEVEL_DEBUG, fmt_, ##__VA_ARGS__)
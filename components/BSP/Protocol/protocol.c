@@ -83,6 +83,55 @@ int protocol_pack_motion_query(uint8_t *out_buf, uint16_t *out_len)
     return protocol_build_frame(CTRL_HUMAN_PRESENCE, CMD_BODY_MOVEMENT, &data, 1, out_buf, out_len);
 }
 
+int protocol_pack_presence_query(uint8_t *out_buf, uint16_t *out_len)
+{
+    uint8_t data = DATA_QUERY;
+    return protocol_build_frame(CTRL_HUMAN_PRESENCE, CMD_PRESENCE_QUERY, &data, 1, out_buf, out_len);
+}
+
+int protocol_pack_sleep_switch(uint8_t enable, uint8_t *out_buf, uint16_t *out_len)
+{
+    uint8_t data = enable ? 0x01 : 0x00;
+    return protocol_build_frame(CTRL_SLEEP, CMD_SLEEP_SWITCH, &data, 1, out_buf, out_len);
+}
+
+int protocol_decode_sleep_comprehensive(const uint8_t *data, uint16_t data_len, radar_sleep_comprehensive_t *out)
+{
+    if (data == NULL || out == NULL || data_len < 8) {
+        return -1;
+    }
+
+    out->presence = data[0];
+    out->sleep_state = data[1];
+    out->avg_breath = data[2];
+    out->avg_heart_rate = data[3];
+    out->turnovers = data[4];
+    out->large_move_pct = data[5];
+    out->small_move_pct = data[6];
+    out->apnea_count = data[7];
+    return 0;
+}
+
+int protocol_decode_sleep_quality(const uint8_t *data, uint16_t data_len, radar_sleep_quality_t *out)
+{
+    if (data == NULL || out == NULL || data_len < 12) {
+        return -1;
+    }
+
+    out->score = data[0];
+    out->total_minutes = (uint16_t)((data[1] << 8) | data[2]); // 大端序
+    out->awake_pct = data[3];
+    out->light_pct = data[4];
+    out->deep_pct = data[5];
+    out->out_of_bed_minutes = data[6];
+    out->out_of_bed_count = data[7];
+    out->turnovers = data[8];
+    out->avg_breath = data[9];
+    out->avg_heart_rate = data[10];
+    out->apnea_count = data[11];
+    return 0;
+}
+
 int protocol_parse_frame(const uint8_t *buffer, uint16_t len, uint8_t *out_ctrl, uint8_t *out_cmd, uint8_t **out_data, uint16_t *out_data_len)
 {
     if (len < MIN_FRAME_LEN) {
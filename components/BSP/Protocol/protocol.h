@@ -29,12 +29,24 @@
 #define CMD_HEART_RATE_REPORT 0x02
 
 // 命令字 - 人体存在/运动 (CTRL_HUMAN_PRESENCE 0x80)
+#define CMD_PRESENCE_REPORT   0x01 // 存在信息上报 (状态变化时)
 #define CMD_MOTION_INFO       0x02 // 运动信息 (静止/活跃)
+#define CMD_PRESENCE_QUERY    0x81 // 存在信息查询
+#define CMD_MOTION_INFO_QUERY 0x82 // 运动信息查询
 #define CMD_BODY_MOVEMENT     0x83 // 体动参数 (查询命令字)
 #define CMD_BODY_MOVEMENT_RPT 0x83 // 体动参数回复 (数据包含1B标识)
 #define CMD_HUMAN_DISTANCE    0x04 // 人体距离
 #define CMD_HUMAN_ORIENTATION 0x05 // 人体方位
 
+// 存在信息
+#define PRESENCE_NONE         0x00 // 无人
+#define PRESENCE_SOMEONE      0x01 // 有人
+
+// 运动信息
+#define MOTION_INFO_NONE      0x00 // 无
+#define MOTION_INFO_STATIC    0x01 // 静止
+#define MOTION_INFO_ACTIVE    0x02 // 活跃
+
 // 查询命令数据标识
 #define DATA_QUERY            0x0F // 查询指令数据
 #define DATA_REPORT           0x1B // 上报数据标识
@@ -43,13 +55,53 @@
 #define CMD_BREATH_VALUE      0x02 // 呼吸数值
 
 // 命令字 - 睡眠 (CTRL_SLEEP 0x84)
+#define CMD_SLEEP_SWITCH        0x00 // 睡眠监测开关
+#define CMD_SLEEP_STATE         0x02 // 睡眠状态上报
+#define CMD_SLEEP_SCORE         0x06 // 睡眠质量评分上报 (睡眠结束时)
 #define CMD_SLEEP_COMPREHENSIVE 0x0C // 睡眠综合状态上报
 #define CMD_SLEEP_QUALITY       0x0D // 睡眠质量分析上报
 
+// 雷达睡眠状态 (CMD_SLEEP_STATE / 综合状态第2字节)
+#define RADAR_SLEEP_DEEP        0x00 // 深睡
+#define RADAR_SLEEP_LIGHT       0x01 // 浅睡
+#define RADAR_SLEEP_AWAKE       0x02 // 清醒
+#define RADAR_SLEEP_NONE        0x03 // 离床/无人
+
 // 开关状态
 #define HEART_RATE_ON  0x01
 #define HEART_RATE_OFF 0x00
 
+/**
+ * @brief 睡眠综合状态 (5359 84 0C 0008)，十分钟上报一次
+ */
+typedef struct {
+    uint8_t presence;           // 1 有人, 0 无人
+    uint8_t sleep_state;        // RADAR_SLEEP_*
+    uint8_t avg_breath;         // 10 分钟平均呼吸
+    uint8_t avg_heart_rate;     // 10 分钟平均心跳
+    uint8_t turnovers;          // 翻身次数
+    uint8_t large_move_pct;     // 大幅度体动占比 0~100
+    uint8_t small_move_pct;     // 小幅度体动占比 0~100
+    uint8_t apnea_count;        // 呼吸暂停次数
+} radar_sleep_comprehensive_t;
+
+/**
+ * @brief 睡眠质量分析 (5359 84 0D 000C)，睡眠过程结束时上报
+ */
+typedef struct {
+    uint8_t score;              // 睡眠质量评分 0~100
+    uint16_t total_minutes;     // 睡眠总时长 (分钟)
+    uint8_t awake_pct;          // 清醒时长占比
+    uint8_t light_pct;          // 浅睡时长占比
+    uint8_t deep_pct;           // 深睡时长占比
+    uint8_t out_of_bed_minutes; // 离床时长
+    uint8_t out_of_bed_count;   // 离床次数
+    uint8_t turnovers;          // 翻身次数
+    uint8_t avg_breath;         // 平均呼吸
+    uint8_t avg_heart_rate;     // 平均心跳
+    uint8_t apnea_count;        // 呼吸暂停次数 (预留)
+} radar_sleep_quality_t;
+
 /**
  * @brief 构建协议帧
  * 
@@ -97,4 +149,47 @@ int protocol_parse_frame(const uint8_t *buffer, uint16_t len, uint8_t *out_ctrl,
  */
 int protocol_pack_motion_query(uint8_t *out_buf, uint16_t *out_len);
 
+/**
+ * @brief 构建存在信息查询指令帧
+ * 
+ * 帧结构: 53 59 80 81 00 01 0F BD 54 43
+ * 
+ * @param out_buf   输出缓冲区
+ * @param out_len   输入时为缓冲区大小，输出时为实际帧长度
+ * @return int      0: 成功, -1: 缓冲区过小
+ */
+int protocol_pack_presence_query(uint8_t *out_buf, uint16_t *out_len);
+
+/**
+ * @brief 构建睡眠监测开关指令帧
+ * 
+ * 帧结构: 53 59 84 00 00 01 01/00 sum 54 43
+ * 
+ * @param enable    1: 开启, 0: 关闭
+ * @param out_buf   输出缓冲区
+ * @param out_len   输入时为缓冲区大小，输出时为实际帧长度
+ * @return int      0: 成功, -1: 缓冲区过小
+ */
+int protocol_pack_sleep_switch(uint8_t enable, uint8_t *out_buf, uint16_t *out_len);
+
+/**
+ * @brief 解析睡眠综合状态数据 (CMD_SLEEP_COMPREHENSIVE)
+ * 
+ * @param data      帧数据 (protocol_parse_frame 输出)
+ * @param data_len  数据长度，至少 8 字节
+ * @param out       输出结构
+ * @return int      0: 成功, -1: 长度不足
+ */
+int protocol_decode_sleep_comprehensive(const uint8_t *data, uint16_t data_len, radar_sleep_comprehensive_t *out);
+
+/**
+ * @brief 解析睡眠质量分析数据 (CMD_SLEEP_QUALITY)
+ * 
+ * @param data      帧数据 (protocol_parse_frame 输出)
+ * @param data_len  数据长度，至少 12 字节
+ * @param out       输出结构
+ * @return int      0: 成功, -1: 长度不足
+ */
+int protocol_decode_sleep_quality(const uint8_t *data, uint16_t data_len, radar_sleep_quality_t *out);
+
 #endif // PROTOCOL_H
@@ -0,0 +1,309 @@
+#include "sleep_rollup.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "audio_sdcard.h"
+
+#define ROLLUP_DIR        AUDIO_SD_MOUNT_POINT "/TREND"
+#define ROLLUP_FILE       ROLLUP_DIR "/ROLLUP.BIN"
+#define ROLLUP_MAGIC      0x50554C52U  /* "RLUP" */
+#define ROLLUP_VERSION    1U
+#define ROLLUP_EPOCH_MIN  0.5f         /* 每个epoch 30s */
+#define ROLLUP_MAX_SPAN   2048U        /* 单次查询最多遍历的桶数 */
+
+static const char *TAG = "rollup";
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t bucket_size;
+    uint32_t capacity[ROLLUP_RES_COUNT];
+} rollup_file_header_t;
+
+static const uint32_t s_period[ROLLUP_RES_COUNT] = {300U, 3600U, 86400U};
+static const uint32_t s_capacity[ROLLUP_RES_COUNT] = {
+    ROLLUP_5MIN_CAPACITY, ROLLUP_HOUR_CAPACITY, ROLLUP_NIGHT_CAPACITY
+};
+
+static rollup_bucket_t s_open[ROLLUP_RES_COUNT];
+static SemaphoreHandle_t s_mutex = NULL;
+static bool s_file_ready = false;
+
+uint32_t sleep_rollup_period(rollup_resolution_t res)
+{
+    return (res < ROLLUP_RES_COUNT) ? s_period[res] : 0;
+}
+
+/* 每晚桶以本地中午为界；5分钟/小时桶按UTC整除即可（时区为整小时偏移） */
+static uint32_t bucket_start(rollup_resolution_t res, uint32_t ts)
+{
+    if (res != ROLLUP_RES_NIGHT)
+    {
+        return ts - (ts % s_period[res]);
+    }
+
+    time_t t = (time_t)ts;
+    struct tm lt;
+    localtime_r(&t, &lt);
+    if (lt.tm_hour < 12)
+    {
+        lt.tm_mday -= 1;
+    }
+    lt.tm_hour = 12;
+    lt.tm_min = 0;
+    lt.tm_sec = 0;
+    lt.tm_isdst = -1;
+    return (uint32_t)mktime(&lt);
+}
+
+static long slot_offset(rollup_resolution_t res, uint32_t start)
+{
+    long base = (long)sizeof(rollup_file_header_t);
+    for (int r = 0; r < (int)res; ++r)
+    {
+        base += (long)(s_capacity[r] * sizeof(rollup_bucket_t));
+    }
+    const uint32_t slot = (start / s_period[res]) % s_capacity[res];
+    return base + (long)(slot * sizeof(rollup_bucket_t));
+}
+
+static void bucket_reset(rollup_bucket_t *b, uint32_t start)
+{
+    memset(b, 0, sizeof(*b));
+    b->start = start;
+}
+
+static void channel_add(rollup_channel_stats_t *c, float v)
+{
+    if (c->count == 0)
+    {
+        c->min = v;
+        c->max = v;
+    }
+    else
+    {
+        if (v < c->min) c->min = v;
+        if (v > c->max) c->max = v;
+    }
+    c->count++;
+    c->sum += v;
+    c->sumsq += v * v;
+}
+
+static bool slot_write(FILE *f, rollup_resolution_t res, const rollup_bucket_t *b)
+{
+    if (fseek(f, slot_offset(res, b->start), SEEK_SET) != 0)
+    {
+        return false;
+    }
+    return fwrite(b, sizeof(*b), 1, f) == 1;
+}
+
+static bool slot_read(FILE *f, rollup_resolution_t res, uint32_t start, rollup_bucket_t *out)
+{
+    if (fseek(f, slot_offset(res, start), SEEK_SET) != 0)
+    {
+        return false;
+    }
+    return fread(out, sizeof(*out), 1, f) == 1 && out->start == start;
+}
+
+static bool header_matches(const rollup_file_header_t *h)
+{
+    if (h->magic != ROLLUP_MAGIC || h->version != ROLLUP_VERSION ||
+        h->bucket_size != sizeof(rollup_bucket_t))
+    {
+        return false;
+    }
+    for (int r = 0; r < ROLLUP_RES_COUNT; ++r)
+    {
+        if (h->capacity[r] != s_capacity[r])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* 创建环文件：写文件头并把所有槽位清零 */
+static bool rollup_file_create(void)
+{
+    FILE *f = fopen(ROLLUP_FILE, "wb");
+    if (!f)
+    {
+        return false;
+    }
+
+    rollup_file_header_t hdr = {
+        .magic = ROLLUP_MAGIC,
+        .version = ROLLUP_VERSION,
+        .bucket_size = sizeof(rollup_bucket_t),
+    };
+    for (int r = 0; r < ROLLUP_RES_COUNT; ++r)
+    {
+        hdr.capacity[r] = s_capacity[r];
+    }
+
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+    const rollup_bucket_t empty = {0};
+    const uint32_t total = ROLLUP_5MIN_CAPACITY + ROLLUP_HOUR_CAPACITY + ROLLUP_NIGHT_CAPACITY;
+    for (uint32_t i = 0; ok && i < total; ++i)
+    {
+        ok = fwrite(&empty, sizeof(empty), 1, f) == 1;
+    }
+    fclose(f);
+    return ok;
+}
+
+esp_err_t sleep_rollup_init(void)
+{
+    if (!s_mutex)
+    {
+        s_mutex = xSemaphoreCreateMutex();
+        if (!s_mutex)
+        {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    memset(s_open, 0, sizeof(s_open));
+    s_file_ready = false;
+
+    if (audio_sdcard_mount() != ESP_OK)
+    {
+        ESP_LOGW(TAG, "sd card unavailable, rollups kept in RAM only");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    mkdir(ROLLUP_DIR, 0775);
+
+    rollup_file_header_t hdr = {0};
+    FILE *f = fopen(ROLLUP_FILE, "rb");
+    const bool valid = f && fread(&hdr, sizeof(hdr), 1, f) == 1 && header_matches(&hdr);
+    if (f)
+    {
+        fclose(f);
+    }
+
+    if (!valid && !rollup_file_create())
+    {
+        ESP_LOGE(TAG, "create %s failed", ROLLUP_FILE);
+        return ESP_FAIL;
+    }
+
+    s_file_ready = true;
+    ESP_LOGI(TAG, "rollup rings ready (%s)", valid ? "existing" : "new");
+    return ESP_OK;
+}
+
+esp_err_t sleep_rollup_add_epoch(uint32_t timestamp, const sleep_epoch_t *epoch, sleep_stage_t stage)
+{
+    if (!epoch || !s_mutex)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timestamp < 1600000000U)
+    {
+        return ESP_ERR_INVALID_STATE; /* 时间未同步，无法归桶 */
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+
+    FILE *f = s_file_ready ? fopen(ROLLUP_FILE, "r+b") : NULL;
+    for (int r = 0; r < ROLLUP_RES_COUNT; ++r)
+    {
+        rollup_bucket_t *b = &s_open[r];
+        const uint32_t start = bucket_start((rollup_resolution_t)r, timestamp);
+        if (b->start != start)
+        {
+            /* 跨桶：旧桶每个epoch都已回写，直接切换；若该桶已在SD中（重启后）则续写 */
+            bucket_reset(b, start);
+            if (f)
+            {
+                rollup_bucket_t stored;
+                if (slot_read(f, (rollup_resolution_t)r, start, &stored))
+                {
+                    *b = stored;
+                }
+            }
+        }
+
+        b->epochs++;
+        if ((unsigned)stage < 4U)
+        {
+            b->stage_minutes[stage] += ROLLUP_EPOCH_MIN;
+        }
+        if (epoch->heart_rate_mean > 0.0f)
+        {
+            channel_add(&b->ch[ROLLUP_CH_HR], epoch->heart_rate_mean);
+            channel_add(&b->ch[ROLLUP_CH_HRV], epoch->heart_rate_std);
+        }
+        if (epoch->respiratory_rate_bpm > 0.0f)
+        {
+            channel_add(&b->ch[ROLLUP_CH_RR], epoch->respiratory_rate_bpm);
+        }
+        channel_add(&b->ch[ROLLUP_CH_MOTION], epoch->motion_index);
+
+        if (f && !slot_write(f, (rollup_resolution_t)r, b))
+        {
+            ESP_LOGW(TAG, "write slot failed (res %d)", r);
+        }
+    }
+    if (f)
+    {
+        fclose(f);
+    }
+
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+size_t sleep_rollup_query(rollup_resolution_t res, uint32_t from, uint32_t to,
+                          rollup_bucket_t *out, size_t max_out)
+{
+    if (res >= ROLLUP_RES_COUNT || !out || max_out == 0 || !s_mutex || to < from)
+    {
+        return 0;
+    }
+
+    const uint32_t period = s_period[res];
+    uint32_t first = bucket_start(res, from);
+    const uint32_t last = bucket_start(res, to);
+
+    /* 超出环容量的部分早已被覆盖，从最近可用的桶开始 */
+    const uint32_t span_limit = (s_capacity[res] < ROLLUP_MAX_SPAN) ? s_capacity[res] : ROLLUP_MAX_SPAN;
+    if ((last - first) / period >= span_limit)
+    {
+        first = last - (span_limit - 1U) * period;
+    }
+
+    size_t n = 0;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    FILE *f = s_file_ready ? fopen(ROLLUP_FILE, "rb") : NULL;
+    for (uint32_t start = first; start <= last && n < max_out; start += period)
+    {
+        if (s_open[res].start == start)
+        {
+            out[n++] = s_open[res];
+        }
+        else if (f && slot_read(f, res, start, &out[n]))
+        {
+            n++;
+        }
+        if (start > UINT32_MAX - period)
+        {
+            break;
+        }
+    }
+    if (f)
+    {
+        fclose(f);
+    }
+    xSemaphoreGive(s_mutex);
+    return n;
+}
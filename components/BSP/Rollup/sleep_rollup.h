@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sleep_analysis.h"
+
+/**
+ * 多分辨率睡眠趋势汇总
+ *
+ * 由 30s epoch 流驱动，维护 5 分钟 / 1 小时 / 每晚 三级聚合桶，
+ * 各级为 SD 卡上的定长环形区（/sdcard/TREND/ROLLUP.BIN）：
+ * - 更新 O(1)：当前桶驻留内存，每个 epoch 回写其所在槽位
+ * - 查询 O(range)：按桶起始时间逐槽读取并校验时间戳
+ * 槽位 = (桶起始时间 / 桶周期) % 环容量，覆盖即淘汰最旧数据。
+ */
+
+typedef enum {
+    ROLLUP_RES_5MIN = 0,
+    ROLLUP_RES_HOUR,
+    ROLLUP_RES_NIGHT,            /* 以本地中午12:00为界的24小时，避免一晚被切断 */
+    ROLLUP_RES_COUNT
+} rollup_resolution_t;
+
+typedef enum {
+    ROLLUP_CH_HR = 0,            /* 心率均值 (bpm) */
+    ROLLUP_CH_RR,                /* 呼吸率 (次/分) */
+    ROLLUP_CH_MOTION,            /* 体动指数 (0-100) */
+    ROLLUP_CH_HRV,               /* 心率标准差 */
+    ROLLUP_CH_COUNT
+} rollup_channel_t;
+
+/* 环容量：5分钟桶2天，小时桶6周，每晚桶约13个月 */
+#define ROLLUP_5MIN_CAPACITY   576U
+#define ROLLUP_HOUR_CAPACITY   1008U
+#define ROLLUP_NIGHT_CAPACITY  400U
+
+typedef struct {
+    uint32_t count;              /* 有效样本数（无效的0值不计入） */
+    float sum;
+    float sumsq;
+    float min;
+    float max;
+} rollup_channel_stats_t;
+
+typedef struct {
+    uint32_t start;              /* 桶起始时间戳 (s)，0 表示空槽 */
+    uint32_t epochs;             /* 桶内 epoch 数 */
+    float stage_minutes[4];      /* 按 sleep_stage_t 索引的各阶段分钟数 */
+    rollup_channel_stats_t ch[ROLLUP_CH_COUNT];
+} rollup_bucket_t;
+
+/* 初始化（挂载SD并打开/创建环文件）；SD不可用时仅保留内存中的当前桶 */
+esp_err_t sleep_rollup_init(void);
+
+/* 喂入一个已分期的 epoch，timestamp 为 epoch 结束时刻 */
+esp_err_t sleep_rollup_add_epoch(uint32_t timestamp, const sleep_epoch_t *epoch, sleep_stage_t stage);
+
+/**
+ * @brief 读取 [from, to] 时间范围内的非空桶（按时间升序）
+ * @return 写入 out 的桶数
+ */
+size_t sleep_rollup_query(rollup_resolution_t res, uint32_t from, uint32_t to,
+                          rollup_bucket_t *out, size_t max_out);
+
+/* 桶周期（秒） */
+uint32_t sleep_rollup_period(rollup_resolution_t res);
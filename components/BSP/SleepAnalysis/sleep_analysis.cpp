@@ -1,4 +1,5 @@
 #include "sleep_analysis.h"
+#include "sleep_stage_tree_model.h"
 
 #include <algorithm>
 #include <cmath>
@@ -47,7 +48,7 @@ struct Statistics {
  * @brief 计算统计量（均值、标准差、最小值、最大值）
  * 论文公式 (8) 和 (11)
  */
-Statistics compute_statistics(const sleep_epoch_t *epochs, size_t count, bool use_motion) {
+Statistics compute_statistics(const sleep_epoch_t *epochs, size_t count, float sleep_epoch_t::*field) {
     if (count == 0 || epochs == nullptr) {
         return {};
     }
@@ -57,7 +58,7 @@ Statistics compute_statistics(const sleep_epoch_t *epochs, size_t count, bool us
     float max_val = -1e9f;
     
     for (size_t i = 0; i < count; ++i) {
-        float v = use_motion ? epochs[i].motion_index : epochs[i].respiratory_rate_bpm;
+        const float v = epochs[i].*field;
         sum += v;
         if (v < min_val) min_val = v;
         if (v > max_val) max_val = v;
@@ -66,8 +67,7 @@ Statistics compute_statistics(const sleep_epoch_t *epochs, size_t count, bool us
 
     float var = 0.0f;
     for (size_t i = 0; i < count; ++i) {
-        const float v = use_motion ? epochs[i].motion_index : epochs[i].respiratory_rate_bpm;
-        const float d = v - mean;
+        const float d = epochs[i].*field - mean;
         var += d * d;
     }
     /* 使用 N-1 计算样本标准差 */
@@ -76,6 +76,60 @@ Statistics compute_statistics(const sleep_epoch_t *epochs, size_t count, bool us
     return {mean, stddev, min_val, max_val};
 }
 
+/**
+ * @brief 由四个通道的统计量套用阈值公式（论文公式 + 心率扩展）
+ */
+void apply_threshold_formulas(const Statistics &rr, const Statistics &mv,
+                              const Statistics &hr, const Statistics &hrv,
+                              sleep_thresholds_t *out) {
+    /* 
+     * 论文核心阈值计算：
+     * - resp_rate_threshold: 用于判断 REM（呼吸率 > 阈值）
+     * - motion_threshold: 用于修正 REM 误判（高运动排除 REM）
+     * - wake_motion_threshold: 用于判断 Wake（运动 > 平均值）
+     */
+    out->resp_rate_threshold = rr.mean + rr.stddev;
+    out->motion_threshold = mv.mean + mv.stddev;
+    out->wake_motion_threshold = mv.mean;  /* 论文公式 (12) */
+
+    /*
+     * 心率相关阈值计算（扩展算法）：
+     * 
+     * 睡眠生理学基础：
+     * - Wake: 心率较高（交感神经活跃）
+     * - REM: 心率变异性高（类似清醒状态）
+     * - NREM: 心率低且稳定（副交感神经主导）
+     */
+    out->heart_rate_mean = hr.mean;
+    /* 清醒时心率通常高于平均值 */
+    out->heart_rate_wake_threshold = hr.mean + 0.5f * hr.stddev;
+    /* REM期HRV通常高于平均值 */
+    out->hrv_rem_threshold = hrv.mean + hrv.stddev;
+}
+
+/**
+ * @brief 基线与当晚统计按权重 w 混合（两分布混合的均值与方差）
+ */
+Statistics blend_with_baseline(const sleep_channel_baseline_t &base, const Statistics &night, float w) {
+    const float base_var = std::max(base.var, 0.0f);
+    const float night_var = night.stddev * night.stddev;
+    const float d = night.mean - base.mean;
+    Statistics out{};
+    out.mean = (1.0f - w) * base.mean + w * night.mean;
+    out.stddev = std::sqrt((1.0f - w) * base_var + w * night_var + w * (1.0f - w) * d * d);
+    return out;
+}
+
+/**
+ * @brief 单晚统计融合进基线通道（指数加权，含均值漂移项）
+ */
+void merge_channel(sleep_channel_baseline_t &base, const Statistics &night, float alpha) {
+    const float night_var = night.stddev * night.stddev;
+    const float d = night.mean - base.mean;
+    base.var = (1.0f - alpha) * base.var + alpha * night_var + alpha * (1.0f - alpha) * d * d;
+    base.mean = (1.0f - alpha) * base.mean + alpha * night.mean;
+}
+
 /**
  * @brief 中值滤波（3点），用于平滑运动数据
  * 论文中提到使用中值滤波减少瞬时运动的影响
@@ -92,6 +146,37 @@ float median5(float a, float b, float c, float d, float e) {
     std::sort(arr, arr + 5);
     return arr[2];
 }
+
+/**
+ * @brief 第 i 个 epoch 的平滑运动值：中间 5 点中值，边界 3 点中值
+ */
+float smoothed_motion(const sleep_epoch_t *epochs, size_t count, size_t i) {
+    if (count >= 5 && i >= 2 && i + 2 < count) {
+        return median5(
+            epochs[i - 2].motion_index,
+            epochs[i - 1].motion_index,
+            epochs[i].motion_index,
+            epochs[i + 1].motion_index,
+            epochs[i + 2].motion_index
+        );
+    }
+    const float prev = (i == 0) ? epochs[i].motion_index : epochs[i - 1].motion_index;
+    const float curr = epochs[i].motion_index;
+    const float next = (i + 1 < count) ? epochs[i + 1].motion_index : epochs[i].motion_index;
+    return median3(prev, curr, next);
+}
+
+/**
+ * @brief 孤立阶段修正：前后相同而当前不同，则改为前后的阶段
+ */
+void smooth_isolated_stages(sleep_stage_result_t *out_results, size_t count) {
+    for (size_t i = 1; i + 1 < count; ++i) {
+        if (out_results[i - 1].stage == out_results[i + 1].stage &&
+            out_results[i].stage != out_results[i - 1].stage) {
+            out_results[i].stage = out_results[i - 1].stage;
+        }
+    }
+}
 }
 
 /**
@@ -215,57 +300,102 @@ extern "C" void sleep_analysis_compute_thresholds(const sleep_epoch_t *epochs,
     }
 
     /* 论文公式 (8): RRthres = mean(RR) + std(RR) */
-    const Statistics rr_stats = compute_statistics(epochs, count, /*use_motion=*/false);
+    const Statistics rr_stats = compute_statistics(epochs, count, &sleep_epoch_t::respiratory_rate_bpm);
     
     /* 论文公式 (11): Movthres = mean(Mov) + std(Mov) */
-    const Statistics mv_stats = compute_statistics(epochs, count, /*use_motion=*/true);
+    const Statistics mv_stats = compute_statistics(epochs, count, &sleep_epoch_t::motion_index);
 
-    /* 
-     * 论文核心阈值计算：
-     * - resp_rate_threshold: 用于判断 REM（呼吸率 > 阈值）
-     * - motion_threshold: 用于修正 REM 误判（高运动排除 REM）
-     * - wake_motion_threshold: 用于判断 Wake（运动 > 平均值）
-     */
-    out_thresholds->resp_rate_threshold = rr_stats.mean + rr_stats.stddev;
-    out_thresholds->motion_threshold = mv_stats.mean + mv_stats.stddev;
-    out_thresholds->wake_motion_threshold = mv_stats.mean;  /* 论文公式 (12) */
-    
-    /*
-     * 心率相关阈值计算（扩展算法）：
-     * 
-     * 睡眠生理学基础：
-     * - Wake: 心率较高（交感神经活跃）
-     * - REM: 心率变异性高（类似清醒状态）
-     * - NREM: 心率低且稳定（副交感神经主导）
-     */
-    float hr_sum = 0.0f;
-    float hrv_sum = 0.0f;
-    float hr_var_sum = 0.0f;
-    float hrv_var_sum = 0.0f;
-    
-    for (size_t i = 0; i < count; ++i) {
-        hr_sum += epochs[i].heart_rate_mean;
-        hrv_sum += epochs[i].heart_rate_std;
+    const Statistics hr_stats = compute_statistics(epochs, count, &sleep_epoch_t::heart_rate_mean);
+    const Statistics hrv_stats = compute_statistics(epochs, count, &sleep_epoch_t::heart_rate_std);
+
+    apply_threshold_formulas(rr_stats, mv_stats, hr_stats, hrv_stats, out_thresholds);
+}
+
+extern "C" int sleep_analysis_baseline_is_valid(const sleep_baseline_t *baseline) {
+    return baseline != nullptr &&
+           baseline->version == SLEEP_BASELINE_VERSION &&
+           baseline->nights > 0;
+}
+
+/**
+ * @brief 个人基线预置阈值
+ * 
+ * 冷启动时 compute_thresholds 需要至少 10 个 epoch 才脱离人群默认值，
+ * 这里用近几晚的个人统计作为先验，当晚数据按 1-exp(-n/τ) 的权重渐进融入：
+ * n=0 时完全使用基线，n≈3τ 后基本由当晚数据主导。
+ * n 取本次睡眠已持续的 epoch 数而非统计窗口长度，窗口封顶后权重仍会趋近 1。
+ */
+extern "C" void sleep_analysis_compute_thresholds_seeded(const sleep_epoch_t *epochs,
+                                                          size_t count,
+                                                          size_t elapsed_epochs,
+                                                          const sleep_baseline_t *baseline,
+                                                          sleep_thresholds_t *out_thresholds) {
+    if (out_thresholds == nullptr) {
+        return;
     }
-    
-    float hr_mean = hr_sum / static_cast<float>(count);
-    float hrv_mean = hrv_sum / static_cast<float>(count);
-    
-    for (size_t i = 0; i < count; ++i) {
-        float hr_diff = epochs[i].heart_rate_mean - hr_mean;
-        float hrv_diff = epochs[i].heart_rate_std - hrv_mean;
-        hr_var_sum += hr_diff * hr_diff;
-        hrv_var_sum += hrv_diff * hrv_diff;
+    if (!sleep_analysis_baseline_is_valid(baseline)) {
+        sleep_analysis_compute_thresholds(epochs, count, out_thresholds);
+        return;
+    }
+    if (epochs == nullptr) {
+        count = 0;
+    }
+    if (count == 0) {
+        elapsed_epochs = 0;
+    }
+
+    const float w = 1.0f - std::exp(-static_cast<float>(elapsed_epochs) / SLEEP_BASELINE_DECAY_EPOCHS);
+
+    const Statistics rr = blend_with_baseline(baseline->rr,
+        compute_statistics(epochs, count, &sleep_epoch_t::respiratory_rate_bpm), w);
+    const Statistics mv = blend_with_baseline(baseline->motion,
+        compute_statistics(epochs, count, &sleep_epoch_t::motion_index), w);
+    const Statistics hr = blend_with_baseline(baseline->hr,
+        compute_statistics(epochs, count, &sleep_epoch_t::heart_rate_mean), w);
+    const Statistics hrv = blend_with_baseline(baseline->hrv,
+        compute_statistics(epochs, count, &sleep_epoch_t::heart_rate_std), w);
+
+    apply_threshold_formulas(rr, mv, hr, hrv, out_thresholds);
+}
+
+/**
+ * @brief 整晚统计融合进个人基线
+ * 
+ * 前 SLEEP_BASELINE_MAX_NIGHTS 晚按累积平均（alpha = 1/(n+1)），
+ * 之后固定 alpha = 1/SLEEP_BASELINE_MAX_NIGHTS，即约一周的指数窗口。
+ */
+extern "C" void sleep_analysis_baseline_merge_night(sleep_baseline_t *baseline,
+                                                     const sleep_epoch_t *epochs,
+                                                     size_t count) {
+    if (baseline == nullptr || epochs == nullptr || count < 2) {
+        return;
+    }
+
+    const Statistics rr = compute_statistics(epochs, count, &sleep_epoch_t::respiratory_rate_bpm);
+    const Statistics mv = compute_statistics(epochs, count, &sleep_epoch_t::motion_index);
+    const Statistics hr = compute_statistics(epochs, count, &sleep_epoch_t::heart_rate_mean);
+    const Statistics hrv = compute_statistics(epochs, count, &sleep_epoch_t::heart_rate_std);
+
+    if (!sleep_analysis_baseline_is_valid(baseline)) {
+        *baseline = {};
+        baseline->version = SLEEP_BASELINE_VERSION;
+        baseline->nights = 1;
+        baseline->rr = {rr.mean, rr.stddev * rr.stddev};
+        baseline->motion = {mv.mean, mv.stddev * mv.stddev};
+        baseline->hr = {hr.mean, hr.stddev * hr.stddev};
+        baseline->hrv = {hrv.mean, hrv.stddev * hrv.stddev};
+        return;
+    }
+
+    const uint32_t n = std::min(baseline->nights, SLEEP_BASELINE_MAX_NIGHTS);
+    const float alpha = 1.0f / static_cast<float>(std::min(n + 1U, SLEEP_BASELINE_MAX_NIGHTS));
+    merge_channel(baseline->rr, rr, alpha);
+    merge_channel(baseline->motion, mv, alpha);
+    merge_channel(baseline->hr, hr, alpha);
+    merge_channel(baseline->hrv, hrv, alpha);
+    if (baseline->nights < SLEEP_BASELINE_MAX_NIGHTS) {
+        baseline->nights++;
     }
-    
-    float hr_std = (count > 1) ? std::sqrt(hr_var_sum / static_cast<float>(count - 1)) : 0.0f;
-    float hrv_std = (count > 1) ? std::sqrt(hrv_var_sum / static_cast<float>(count - 1)) : 0.0f;
-    
-    out_thresholds->heart_rate_mean = hr_mean;
-    /* 清醒时心率通常高于平均值 */
-    out_thresholds->heart_rate_wake_threshold = hr_mean + 0.5f * hr_std;
-    /* REM期HRV通常高于平均值 */
-    out_thresholds->hrv_rem_threshold = hrv_mean + hrv_std;
 }
 
 /**
@@ -295,23 +425,7 @@ extern "C" void sleep_analysis_detect_stages(const sleep_epoch_t *epochs,
     /* 第一遍：计算平滑后的运动指数并初步判断 */
     for (size_t i = 0; i < count; ++i) {
         /* 使用中值滤波平滑运动数据，减少瞬时运动噪声 */
-        float motion_smoothed;
-        if (count >= 5 && i >= 2 && i + 2 < count) {
-            /* 5点中值滤波 */
-            motion_smoothed = median5(
-                epochs[i - 2].motion_index,
-                epochs[i - 1].motion_index,
-                epochs[i].motion_index,
-                epochs[i + 1].motion_index,
-                epochs[i + 2].motion_index
-            );
-        } else {
-            /* 边界使用3点中值滤波 */
-            float prev = (i == 0) ? epochs[i].motion_index : epochs[i - 1].motion_index;
-            float curr = epochs[i].motion_index;
-            float next = (i + 1 < count) ? epochs[i + 1].motion_index : epochs[i].motion_index;
-            motion_smoothed = median3(prev, curr, next);
-        }
+        const float motion_smoothed = smoothed_motion(epochs, count, i);
 
         /* 获取当前epoch的心率特征 */
         const float hr_mean = epochs[i].heart_rate_mean;
@@ -394,91 +508,63 @@ extern "C" void sleep_analysis_detect_stages(const sleep_epoch_t *epochs,
 
     /* 第二遍：平滑处理，避免孤立的阶段判断 */
     /* 论文中没有明确提到，但实际应用中常用于提高一致性 */
-    for (size_t i = 1; i + 1 < count; ++i) {
-        /* 如果前后都是同一阶段，当前不同，则修正为前后的阶段 */
-        if (out_results[i - 1].stage == out_results[i + 1].stage &&
-            out_results[i].stage != out_results[i - 1].stage) {
-            out_results[i].stage = out_results[i - 1].stage;
-        }
-    }
+    smooth_isolated_stages(out_results, count);
 }
 
 /**
- * @brief 睡眠质量评估
+ * @brief 决策树分期（模型由 tools/stage_tree_trainer.py 生成）
  * 
- * 基于检测结果计算：
- * - 各阶段时长
- * - 睡眠效率 = (REM + NREM) / 总时长
- * - REM占比（正常成人约 20-25%）
- * - 综合评分（0-100）
+ * 特征：平滑运动、原始 RR/HR/HRV 及其相对各阈值的差值。训练工具按 App 的用法
+ * 只复现最新一个 epoch 的特征（末端 3 点平滑、当次的基线预置阈值），
+ * 较早 epoch 用 5 点平滑与最新阈值重算的结果仅用于整晚报告。
+ * 模型为 constexpr 嵌套分支，每个 epoch 至多 kDepth 次比较。
  */
-extern "C" void sleep_analysis_build_quality(const sleep_epoch_t *epochs,
-                                              const sleep_stage_result_t *stages,
-                                              size_t count,
-                                              sleep_quality_report_t *out_report) {
-    if (out_report == nullptr) {
-        return;
-    }
-    *out_report = {};
-
-    if (epochs == nullptr || stages == nullptr || count == 0) {
+extern "C" void sleep_analysis_detect_stages_tree(const sleep_epoch_t *epochs,
+                                                   size_t count,
+                                                   const sleep_thresholds_t *thresholds,
+                                                   sleep_stage_result_t *out_results) {
+    if (epochs == nullptr || thresholds == nullptr || out_results == nullptr || count == 0) {
         return;
     }
 
-    float total_seconds = 0.0f;
-    float sleep_seconds = 0.0f;
-    float rem_seconds = 0.0f;
-    float nrem_seconds = 0.0f;
-    float wake_seconds = 0.0f;
-    float resp_sum = 0.0f;
-    float motion_sum = 0.0f;
-    float hr_sum = 0.0f;
-    float hrv_sum = 0.0f;
-    
-    /* 计算阶段转换次数（用于评估睡眠稳定性） */
-    size_t stage_transitions = 0;
-    sleep_stage_t prev_stage = SLEEP_STAGE_UNKNOWN;
-
     for (size_t i = 0; i < count; ++i) {
-        const float dur = safe_duration(epochs[i]);
-        total_seconds += dur;
-        resp_sum += epochs[i].respiratory_rate_bpm;
-        motion_sum += stages[i].motion_index;
-        hr_sum += stages[i].heart_rate_mean;
-        hrv_sum += stages[i].heart_rate_std;
+        const float motion_smoothed = smoothed_motion(epochs, count, i);
+        const float rr = epochs[i].respiratory_rate_bpm;
+        const float hr_mean = epochs[i].heart_rate_mean;
+        const float hr_std = epochs[i].heart_rate_std;
+
+        const float x[sleep_stage_tree::kFeatureCount] = {
+            motion_smoothed,
+            rr,
+            hr_mean,
+            hr_std,
+            rr - thresholds->resp_rate_threshold,
+            motion_smoothed - thresholds->motion_threshold,
+            motion_smoothed - thresholds->wake_motion_threshold,
+            hr_mean - thresholds->heart_rate_wake_threshold,
+            hr_std - thresholds->hrv_rem_threshold,
+        };
+
+        out_results[i].stage = sleep_stage_tree::predict(x);
+        out_results[i].respiratory_rate_bpm = rr;
+        out_results[i].motion_index = motion_smoothed;
+        out_results[i].heart_rate_mean = hr_mean;
+        out_results[i].heart_rate_std = hr_std;
+    }
 
-        if (prev_stage != SLEEP_STAGE_UNKNOWN && stages[i].stage != prev_stage) {
-            stage_transitions++;
-        }
-        prev_stage = stages[i].stage;
+    smooth_isolated_stages(out_results, count);
+}
 
-        switch (stages[i].stage) {
-            case SLEEP_STAGE_WAKE:
-                wake_seconds += dur;
-                break;
-            case SLEEP_STAGE_REM:
-                rem_seconds += dur;
-                sleep_seconds += dur;
-                break;
-            case SLEEP_STAGE_NREM:
-                nrem_seconds += dur;
-                sleep_seconds += dur;
-                break;
-            default:
-                break;
-        }
+/**
+ * @brief 由效率、REM 占比、平均体动与阶段转换次数计算综合评分
+ */
+extern "C" float sleep_analysis_quality_score(const sleep_quality_report_t *report,
+                                              size_t stage_transitions,
+                                              float total_seconds) {
+    if (report == nullptr) {
+        return 0.0f;
     }
 
-    out_report->wake_seconds = static_cast<uint32_t>(wake_seconds);
-    out_report->rem_seconds = static_cast<uint32_t>(rem_seconds);
-    out_report->nrem_seconds = static_cast<uint32_t>(nrem_seconds);
-    out_report->sleep_efficiency = (total_seconds > 0.0f) ? (sleep_seconds / total_seconds) : 0.0f;
-    out_report->rem_ratio = (sleep_seconds > 0.0f) ? (rem_seconds / sleep_seconds) : 0.0f;
-    out_report->average_resp_rate = resp_sum / static_cast<float>(count);
-    out_report->average_motion = motion_sum / static_cast<float>(count);
-    out_report->average_heart_rate = hr_sum / static_cast<float>(count);
-    out_report->average_hrv = hrv_sum / static_cast<float>(count);
-
     /*
      * 睡眠评分计算（综合多个因素）:
      * 
@@ -498,7 +584,7 @@ extern "C" void sleep_analysis_build_quality(const sleep_epoch_t *epochs,
      */
     
     /* 效率得分：85%以上满分，低于50%得0分 */
-    const float efficiency_pct = out_report->sleep_efficiency * 100.0f;
+    const float efficiency_pct = report->sleep_efficiency * 100.0f;
     float efficiency_score;
     if (efficiency_pct >= 85.0f) {
         efficiency_score = 100.0f;
@@ -509,7 +595,7 @@ extern "C" void sleep_analysis_build_quality(const sleep_epoch_t *epochs,
     }
     
     /* REM占比得分：22%最佳，偏离过大扣分 */
-    const float rem_pct = out_report->rem_ratio * 100.0f;
+    const float rem_pct = report->rem_ratio * 100.0f;
     const float rem_deviation = std::fabs(rem_pct - 22.0f);
     float rem_score;
     if (rem_deviation <= 5.0f) {
@@ -524,12 +610,12 @@ extern "C" void sleep_analysis_build_quality(const sleep_epoch_t *epochs,
     /* 稳定性得分：运动指数越低越好 */
     /* 体动参数范围 0-100，< 10 为非常稳定，> 50 为不稳定 */
     float stability_score;
-    if (out_report->average_motion <= 10.0f) {
+    if (report->average_motion <= 10.0f) {
         stability_score = 100.0f;
-    } else if (out_report->average_motion <= 50.0f) {
-        stability_score = 100.0f - (out_report->average_motion - 10.0f) * 1.875f;  /* (100-25)/(50-10) */
+    } else if (report->average_motion <= 50.0f) {
+        stability_score = 100.0f - (report->average_motion - 10.0f) * 1.875f;  /* (100-25)/(50-10) */
     } else {
-        stability_score = 25.0f - (out_report->average_motion - 50.0f) * 0.5f;
+        stability_score = 25.0f - (report->average_motion - 50.0f) * 0.5f;
     }
     stability_score = clamp(stability_score, 0.0f, 100.0f);
     
@@ -553,5 +639,84 @@ extern "C" void sleep_analysis_build_quality(const sleep_epoch_t *epochs,
                            0.30f * rem_score + 
                            0.20f * stability_score +
                            0.10f * continuity_score;
-    out_report->sleep_score = clamp(weighted, 0.0f, 100.0f);
+    return clamp(weighted, 0.0f, 100.0f);
+}
+
+/**
+ * @brief 睡眠质量评估
+ * 
+ * 基于检测结果计算：
+ * - 各阶段时长
+ * - 睡眠效率 = (REM + NREM) / 总时长
+ * - REM占比（正常成人约 20-25%）
+ * - 综合评分（0-100）
+ */
+extern "C" void sleep_analysis_build_quality(const sleep_epoch_t *epochs,
+                                              const sleep_stage_result_t *stages,
+                                              size_t count,
+                                              sleep_quality_report_t *out_report) {
+    if (out_report == nullptr) {
+        return;
+    }
+    *out_report = {};
+
+    if (epochs == nullptr || stages == nullptr || count == 0) {
+        return;
+    }
+
+    float total_seconds = 0.0f;
+    float sleep_seconds = 0.0f;
+    float rem_seconds = 0.0f;
+    float nrem_seconds = 0.0f;
+    float wake_seconds = 0.0f;
+    float resp_sum = 0.0f;
+    float motion_sum = 0.0f;
+    float hr_sum = 0.0f;
+    float hrv_sum = 0.0f;
+    
+    /* 计算阶段转换次数（用于评估睡眠稳定性） */
+    size_t stage_transitions = 0;
+    sleep_stage_t prev_stage = SLEEP_STAGE_UNKNOWN;
+
+    for (size_t i = 0; i < count; ++i) {
+        const float dur = safe_duration(epochs[i]);
+        total_seconds += dur;
+        resp_sum += epochs[i].respiratory_rate_bpm;
+        motion_sum += stages[i].motion_index;
+        hr_sum += stages[i].heart_rate_mean;
+        hrv_sum += stages[i].heart_rate_std;
+
+        if (prev_stage != SLEEP_STAGE_UNKNOWN && stages[i].stage != prev_stage) {
+            stage_transitions++;
+        }
+        prev_stage = stages[i].stage;
+
+        switch (stages[i].stage) {
+            case SLEEP_STAGE_WAKE:
+                wake_seconds += dur;
+                break;
+            case SLEEP_STAGE_REM:
+                rem_seconds += dur;
+                sleep_seconds += dur;
+                break;
+            case SLEEP_STAGE_NREM:
+                nrem_seconds += dur;
+                sleep_seconds += dur;
+                break;
+            default:
+                break;
+        }
+    }
+
+    out_report->wake_seconds = static_cast<uint32_t>(wake_seconds);
+    out_report->rem_seconds = static_cast<uint32_t>(rem_seconds);
+    out_report->nrem_seconds = static_cast<uint32_t>(nrem_seconds);
+    out_report->sleep_efficiency = (total_seconds > 0.0f) ? (sleep_seconds / total_seconds) : 0.0f;
+    out_report->rem_ratio = (sleep_seconds > 0.0f) ? (rem_seconds / sleep_seconds) : 0.0f;
+    out_report->average_resp_rate = resp_sum / static_cast<float>(count);
+    out_report->average_motion = motion_sum / static_cast<float>(count);
+    out_report->average_heart_rate = hr_sum / static_cast<float>(count);
+    out_report->average_hrv = hrv_sum / static_cast<float>(count);
+
+    out_report->sleep_score = sleep_analysis_quality_score(out_report, stage_transitions, total_seconds);
 }
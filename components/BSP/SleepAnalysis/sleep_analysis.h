@@ -52,6 +52,28 @@ typedef struct {
     float sleep_score;           // 简易 0-100 评分
 } sleep_quality_report_t;
 
+/* 单通道的跨夜基线统计 */
+typedef struct {
+    float mean;
+    float var;                   // 方差（样本方差）
+} sleep_channel_baseline_t;
+
+/**
+ * @brief 用户个人基线（近几晚的 RR/体动/HR/HRV 统计），持久化于 NVS
+ */
+typedef struct {
+    uint32_t version;            // 结构版本，见 SLEEP_BASELINE_VERSION
+    uint32_t nights;             // 已融合的夜晚数（上限 SLEEP_BASELINE_MAX_NIGHTS）
+    sleep_channel_baseline_t rr;
+    sleep_channel_baseline_t motion;
+    sleep_channel_baseline_t hr;
+    sleep_channel_baseline_t hrv;
+} sleep_baseline_t;
+
+#define SLEEP_BASELINE_VERSION     1U
+#define SLEEP_BASELINE_MAX_NIGHTS  7U      /* 指数平均的等效窗口（晚） */
+#define SLEEP_BASELINE_DECAY_EPOCHS 20.0f  /* 当晚数据权重的时间常数（epoch） */
+
 /**
  * @brief 原始采样数据（来自雷达芯片，每3秒一次）
  * 
@@ -92,6 +114,32 @@ void sleep_analysis_compute_thresholds(const sleep_epoch_t *epochs,
                                        size_t count,
                                        sleep_thresholds_t *out_thresholds);
 
+/**
+ * @brief 以个人基线预置阈值，并按指数衰减逐步融入当晚数据。
+ *        当晚权重 w = 1 - exp(-elapsed_epochs / SLEEP_BASELINE_DECAY_EPOCHS)，
+ *        均值/方差按 (1-w)*基线 + w*当晚 的混合分布计算。
+ *        baseline 无效时等同于 sleep_analysis_compute_thresholds。
+ * @param epochs/count    当晚统计所用的 epoch（可为滑动窗口）
+ * @param elapsed_epochs  本次睡眠已持续的 epoch 数，决定权重；不随窗口长度封顶
+ */
+void sleep_analysis_compute_thresholds_seeded(const sleep_epoch_t *epochs,
+                                              size_t count,
+                                              size_t elapsed_epochs,
+                                              const sleep_baseline_t *baseline,
+                                              sleep_thresholds_t *out_thresholds);
+
+/**
+ * @brief 基线是否可用于预置阈值（版本匹配且至少融合过一晚）
+ */
+int sleep_analysis_baseline_is_valid(const sleep_baseline_t *baseline);
+
+/**
+ * @brief 将一整晚的 epoch 统计融合进基线（指数加权，首晚直接采用）
+ */
+void sleep_analysis_baseline_merge_night(sleep_baseline_t *baseline,
+                                         const sleep_epoch_t *epochs,
+                                         size_t count);
+
 /**
  * @brief 依据阈值进行睡眠阶段判定，包含 REM 纠错逻辑。
  */
@@ -100,6 +148,15 @@ void sleep_analysis_detect_stages(const sleep_epoch_t *epochs,
                                   const sleep_thresholds_t *thresholds,
                                   sleep_stage_result_t *out_results);
 
+/**
+ * @brief 决策树分期，接口与 sleep_analysis_detect_stages 相同，可直接替换规则级联。
+ *        模型见 sleep_stage_tree_model.h（tools/stage_tree_trainer.py 生成）。
+ */
+void sleep_analysis_detect_stages_tree(const sleep_epoch_t *epochs,
+                                       size_t count,
+                                       const sleep_thresholds_t *thresholds,
+                                       sleep_stage_result_t *out_results);
+
 /**
  * @brief 基于阶段结果做睡眠质量评估（效率、占比与简单评分）。
  */
@@ -108,6 +165,14 @@ void sleep_analysis_build_quality(const sleep_epoch_t *epochs,
                                   size_t count,
                                   sleep_quality_report_t *out_report);
 
+/**
+ * @brief 综合评分 0-100：效率 40%、REM 占比 30%、平均体动 20%、每小时阶段转换次数 10%。
+ *        report 中需已填好 sleep_efficiency/rem_ratio/average_motion。
+ */
+float sleep_analysis_quality_score(const sleep_quality_report_t *report,
+                                   size_t stage_transitions,
+                                   float total_seconds);
+
 #ifdef __cplusplus
 }
 #endif
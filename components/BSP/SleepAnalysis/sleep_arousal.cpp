@@ -0,0 +1,110 @@
+#include "sleep_arousal.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+constexpr float kSlack = 0.5f;          /* K，单位 σ */
+constexpr float kThreshold = 4.0f;      /* H，单位 σ */
+constexpr float kAlpha = 1.0f / 32.0f;  /* 基线 EWMA 系数（约 1.6 分钟） */
+
+/* 各通道标准差下限，防止静息时方差过小导致噪声误报 */
+constexpr float kStdFloor[SLEEP_AROUSAL_CH_COUNT] = {
+    3.0f,   /* 体动 (0-100) */
+    2.0f,   /* 心率 bpm */
+    1.5f,   /* 呼吸 次/分 */
+};
+
+/* 更新一个通道，返回当前 S/H */
+float channel_update(sleep_arousal_channel_state_t &c, float x, sleep_arousal_channel_t id,
+                     bool armed, bool learn) {
+    if (c.count == 0) {
+        c.mean = x;
+        c.var = 0.0f;
+        c.cusum = 0.0f;
+        c.count = 1;
+        return 0.0f;
+    }
+
+    const float sd = std::fmax(std::sqrt(c.var), kStdFloor[id]);
+    const float z = (x - c.mean) / sd;
+
+    if (armed) {
+        c.cusum = std::fmax(0.0f, c.cusum + z - kSlack);
+    }
+
+    /* 未越界且不在抑制期时才学习基线 */
+    if (learn && c.cusum < kThreshold) {
+        const float d = x - c.mean;
+        c.mean += kAlpha * d;
+        c.var = (1.0f - kAlpha) * (c.var + kAlpha * d * d);
+    }
+    if (c.count < 0xFFFFU) {
+        c.count++;
+    }
+    return c.cusum / kThreshold;
+}
+}
+
+extern "C" void sleep_arousal_init(sleep_arousal_detector_t *det) {
+    if (det == nullptr) {
+        return;
+    }
+    std::memset(det, 0, sizeof(*det));
+}
+
+extern "C" int sleep_arousal_update(sleep_arousal_detector_t *det, const radar_sample_t *sample,
+                                    sleep_arousal_event_t *event) {
+    if (det == nullptr || sample == nullptr) {
+        return 0;
+    }
+
+    float ratio[SLEEP_AROUSAL_CH_COUNT] = {0.0f, 0.0f, 0.0f};
+    const bool learn = det->refractory == 0;
+    const auto armed = [det](sleep_arousal_channel_t id) {
+        return det->ch[id].count >= SLEEP_AROUSAL_WARMUP_SAMPLES && det->refractory == 0;
+    };
+
+    /* 无效值（心率 0/超范围、呼吸 0）跳过该通道 */
+    ratio[SLEEP_AROUSAL_CH_MOTION] = channel_update(det->ch[SLEEP_AROUSAL_CH_MOTION],
+        static_cast<float>(sample->motion_level), SLEEP_AROUSAL_CH_MOTION, armed(SLEEP_AROUSAL_CH_MOTION), learn);
+    if (sample->heart_rate_bpm >= 60 && sample->heart_rate_bpm <= 120) {
+        ratio[SLEEP_AROUSAL_CH_HR] = channel_update(det->ch[SLEEP_AROUSAL_CH_HR],
+            static_cast<float>(sample->heart_rate_bpm), SLEEP_AROUSAL_CH_HR, armed(SLEEP_AROUSAL_CH_HR), learn);
+    }
+    if (sample->respiratory_rate_bpm > 0 && sample->respiratory_rate_bpm <= 35) {
+        ratio[SLEEP_AROUSAL_CH_RR] = channel_update(det->ch[SLEEP_AROUSAL_CH_RR],
+            static_cast<float>(sample->respiratory_rate_bpm), SLEEP_AROUSAL_CH_RR, armed(SLEEP_AROUSAL_CH_RR), learn);
+    }
+
+    if (det->refractory > 0) {
+        det->refractory--;
+        return 0;
+    }
+
+    float score = 0.0f;
+    uint8_t channels = 0;
+    for (int i = 0; i < SLEEP_AROUSAL_CH_COUNT; ++i) {
+        score = std::fmax(score, ratio[i]);
+        if (ratio[i] >= 0.5f) {
+            channels |= static_cast<uint8_t>(1U << i);
+        }
+    }
+    if (score < 1.0f) {
+        return 0;
+    }
+
+    /* 触发：清零累积和并进入抑制期，基线从下一个采样起恢复学习 */
+    for (int i = 0; i < SLEEP_AROUSAL_CH_COUNT; ++i) {
+        det->ch[i].cusum = 0.0f;
+    }
+    det->refractory = SLEEP_AROUSAL_REFRACTORY;
+    det->events++;
+
+    if (event != nullptr) {
+        event->timestamp = sample->timestamp;
+        event->channels = channels;
+        event->score = score;
+    }
+    return 1;
+}
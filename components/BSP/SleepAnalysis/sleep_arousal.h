@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include "sleep_analysis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 逐采样微觉醒检测（单边 CUSUM）
+ *
+ * 每个通道维护 EWMA 均值/方差基线与一个累积和：
+ *   z = (x - mean) / max(std, floor),  S = max(0, S + z - K)
+ * S 超过 H 即判定为变点。K=0.5σ、H=4σ 时，4.5σ 以上的阶跃在 1 个采样内触发，
+ * 2.5σ 以上的阶跃在 2 个采样内触发。每通道状态为 3 个浮点数加一个计数，O(1) 内存与计算。
+ * 基线只在未报警时更新，避免觉醒过程本身被学习进去。
+ */
+
+typedef enum {
+    SLEEP_AROUSAL_CH_MOTION = 0,
+    SLEEP_AROUSAL_CH_HR,
+    SLEEP_AROUSAL_CH_RR,
+    SLEEP_AROUSAL_CH_COUNT
+} sleep_arousal_channel_t;
+
+#define SLEEP_AROUSAL_WARMUP_SAMPLES  10U   /* 基线学习期，不报警 */
+#define SLEEP_AROUSAL_REFRACTORY      5U    /* 报警后抑制 5 个采样（3s 轮询约 15s，快速轮询时 5s） */
+
+typedef struct {
+    float mean;
+    float var;
+    float cusum;
+    uint16_t count;              /* 已学习的有效采样数 */
+} sleep_arousal_channel_state_t;
+
+typedef struct {
+    sleep_arousal_channel_state_t ch[SLEEP_AROUSAL_CH_COUNT];
+    uint16_t refractory;         /* 剩余抑制采样数 */
+    uint32_t events;             /* 累计事件数 */
+} sleep_arousal_detector_t;
+
+typedef struct {
+    uint32_t timestamp;          /* 触发采样的时间戳 */
+    uint8_t channels;            /* 参与通道位图 (1 << sleep_arousal_channel_t) */
+    float score;                 /* 触发时最大的 S/H 比值 */
+} sleep_arousal_event_t;
+
+void sleep_arousal_init(sleep_arousal_detector_t *det);
+
+/**
+ * @brief 喂入一个原始采样（1/3/6s 一次，随自适应轮询变化）
+ * @return 1 表示本采样触发微觉醒事件并写入 event，否则 0
+ */
+int sleep_arousal_update(sleep_arousal_detector_t *det, const radar_sample_t *sample,
+                         sleep_arousal_event_t *event);
+
+#ifdef __cplusplus
+}
+#endif
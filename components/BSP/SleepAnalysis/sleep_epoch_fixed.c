@@ -0,0 +1,140 @@
+#include "sleep_epoch_fixed.h"
+
+#define FIXED_EPOCH_SECONDS     30U
+#define FIXED_DEFAULT_RR_Q8     (15U * SLEEP_FIXED_ONE)
+#define FIXED_DEFAULT_HR_Q8     (70U * SLEEP_FIXED_ONE)
+#define FIXED_DEFAULT_STD_Q8    (2U * SLEEP_FIXED_ONE)
+
+/* 逐位试商开方，16 次迭代，仅移位/加减 */
+uint32_t sleep_fixed_isqrt(uint32_t x)
+{
+    uint32_t root = 0;
+    uint32_t rem = x;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > rem) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (rem >= root + bit) {
+            rem -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    /* 此时 rem = x - root^2；rem > root 说明更接近 root+1 */
+    return (rem > root) ? root + 1U : root;
+}
+
+/* num / den，四舍五入 */
+static uint32_t div_round(uint32_t num, uint32_t den)
+{
+    return (num + den / 2U) / den;
+}
+
+void sleep_epoch_acc_reset(sleep_epoch_acc_t *acc)
+{
+    if (acc == NULL) {
+        return;
+    }
+    acc->rr_sum = 0;
+    acc->hr_sum = 0;
+    acc->hr_sumsq = 0;
+    acc->rr_count = 0;
+    acc->hr_count = 0;
+    acc->motion_max = 0;
+    acc->samples = 0;
+}
+
+int sleep_epoch_acc_add(sleep_epoch_acc_t *acc, uint8_t heart_rate_bpm,
+                        uint8_t respiratory_rate_bpm, uint8_t motion_level)
+{
+    if (acc == NULL || acc->samples >= SLEEP_FIXED_MAX_SAMPLES) {
+        return 0;
+    }
+
+    /* 有效范围与浮点路径一致：呼吸 1-35，心率 60-120 */
+    if (respiratory_rate_bpm > 0 && respiratory_rate_bpm <= 35) {
+        acc->rr_sum += respiratory_rate_bpm;
+        acc->rr_count++;
+    }
+    if (heart_rate_bpm >= 60 && heart_rate_bpm <= 120) {
+        acc->hr_sum += heart_rate_bpm;
+        acc->hr_sumsq += (uint32_t)heart_rate_bpm * heart_rate_bpm;
+        acc->hr_count++;
+    }
+    if (motion_level > acc->motion_max) {
+        acc->motion_max = motion_level;
+    }
+    acc->samples++;
+    return 1;
+}
+
+int sleep_epoch_acc_finish(const sleep_epoch_acc_t *acc, sleep_epoch_fixed_t *out)
+{
+    if (acc == NULL || out == NULL || acc->samples == 0) {
+        return 0;
+    }
+
+    out->motion_index = acc->motion_max;
+    out->samples = acc->samples;
+    out->respiratory_rate_q8 = (acc->rr_count > 0)
+        ? (uint16_t)div_round((uint32_t)acc->rr_sum << SLEEP_FIXED_Q, acc->rr_count)
+        : (uint16_t)FIXED_DEFAULT_RR_Q8;
+
+    if (acc->hr_count == 0) {
+        out->heart_rate_mean_q8 = (uint16_t)FIXED_DEFAULT_HR_Q8;
+        out->heart_rate_std_q8 = (uint16_t)FIXED_DEFAULT_STD_Q8;
+        return 1;
+    }
+
+    const uint32_t n = acc->hr_count;
+    const uint32_t sum = acc->hr_sum;
+    out->heart_rate_mean_q8 = (uint16_t)div_round(sum << SLEEP_FIXED_Q, n);
+
+    if (n < 2U) {
+        out->heart_rate_std_q8 = 0;
+        return 1;
+    }
+
+    /*
+     * 样本方差 = (n*Σx² - (Σx)²) / (n(n-1))
+     * 心率跨度 ≤ 60，n ≤ 64 时分子 ≤ n²·900 ≈ 3.7e6，左移 8 位仍在 32 位内；
+     * 先得到 Q8 方差，再左移 8 位开方得 Q8 标准差。
+     */
+    const uint32_t num = n * acc->hr_sumsq - sum * sum;
+    const uint32_t var_q8 = div_round(num << SLEEP_FIXED_Q, n * (n - 1U));
+    out->heart_rate_std_q8 = (uint16_t)sleep_fixed_isqrt(var_q8 << SLEEP_FIXED_Q);
+    return 1;
+}
+
+int sleep_epoch_fixed_aggregate(const radar_sample_t *samples, uint32_t count, sleep_epoch_fixed_t *out)
+{
+    if (samples == NULL || out == NULL) {
+        return 0;
+    }
+
+    sleep_epoch_acc_t acc;
+    sleep_epoch_acc_reset(&acc);
+    for (uint32_t i = 0; i < count && i < SLEEP_FIXED_MAX_SAMPLES; ++i) {
+        (void)sleep_epoch_acc_add(&acc, samples[i].heart_rate_bpm,
+                                  samples[i].respiratory_rate_bpm, samples[i].motion_level);
+    }
+    return sleep_epoch_acc_finish(&acc, out);
+}
+
+void sleep_epoch_fixed_to_float(const sleep_epoch_fixed_t *in, sleep_epoch_t *out)
+{
+    if (in == NULL || out == NULL) {
+        return;
+    }
+    const float scale = 1.0f / (float)SLEEP_FIXED_ONE;
+    out->respiratory_rate_bpm = (float)in->respiratory_rate_q8 * scale;
+    out->motion_index = (float)in->motion_index;
+    out->heart_rate_mean = (float)in->heart_rate_mean_q8 * scale;
+    out->heart_rate_std = (float)in->heart_rate_std_q8 * scale;
+    out->duration_seconds = FIXED_EPOCH_SECONDS;
+}
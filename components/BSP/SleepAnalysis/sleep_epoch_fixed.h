@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include "sleep_analysis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 定点 epoch 聚合内核
+ *
+ * 与 sleep_analysis_aggregate_samples 等价的纯整数实现（无浮点、无 libm），
+ * 仅使用 32 位乘除，可同时编译到 ESP32-S3 ULP RISC-V 协处理器与主机：
+ * ULP 逐个采样调用 sleep_epoch_acc_add()，累加器仅 16 字节，可常驻 RTC 内存，
+ * epoch 结束时 sleep_epoch_acc_finish() 输出 Q8.8 结果，主核唤醒后再转为浮点。
+ *
+ * 输出为 Q8.8（值 * 256，四舍五入）；心率标准差为样本标准差 (n-1)，
+ * 经整数平方根 sleep_fixed_isqrt() 求得，与浮点路径误差 < 0.01 bpm。
+ */
+
+#define SLEEP_FIXED_Q           8U                       /* Q8.8 */
+#define SLEEP_FIXED_ONE         (1U << SLEEP_FIXED_Q)
+#define SLEEP_FIXED_MAX_SAMPLES 64U                      /* 单个 epoch 最多采样数，保证中间量不溢出 32 位 */
+
+typedef struct {
+    uint16_t rr_sum;             /* 有效呼吸率 (1-35) 之和 */
+    uint16_t hr_sum;             /* 有效心率 (60-120) 之和 */
+    uint32_t hr_sumsq;           /* 有效心率平方和 */
+    uint8_t rr_count;
+    uint8_t hr_count;
+    uint8_t motion_max;          /* 体动最大值 (0-100) */
+    uint8_t samples;             /* 已累加采样数 */
+} sleep_epoch_acc_t;
+
+typedef struct {
+    uint16_t respiratory_rate_q8;  /* 呼吸率 Q8.8，无有效值时为默认 15 */
+    uint16_t heart_rate_mean_q8;   /* 心率均值 Q8.8，无有效值时为默认 70 */
+    uint16_t heart_rate_std_q8;    /* 心率标准差 Q8.8，无有效值时为默认 2 */
+    uint8_t motion_index;          /* 体动最大值 */
+    uint8_t samples;               /* 参与聚合的采样数 */
+} sleep_epoch_fixed_t;
+
+/* 整数平方根（四舍五入到最近整数） */
+uint32_t sleep_fixed_isqrt(uint32_t x);
+
+void sleep_epoch_acc_reset(sleep_epoch_acc_t *acc);
+
+/* 累加一个采样；超过 SLEEP_FIXED_MAX_SAMPLES 的采样被忽略并返回 0 */
+int sleep_epoch_acc_add(sleep_epoch_acc_t *acc, uint8_t heart_rate_bpm,
+                        uint8_t respiratory_rate_bpm, uint8_t motion_level);
+
+/* 输出当前 epoch；无采样时返回 0 */
+int sleep_epoch_acc_finish(const sleep_epoch_acc_t *acc, sleep_epoch_fixed_t *out);
+
+/**
+ * @brief 将 count 个采样聚合为一个定点 epoch（count 超过上限时只取前 SLEEP_FIXED_MAX_SAMPLES 个）
+ * @return 1 成功, 0 无采样
+ */
+int sleep_epoch_fixed_aggregate(const radar_sample_t *samples, uint32_t count, sleep_epoch_fixed_t *out);
+
+/* 主核侧：定点 epoch 转为浮点 sleep_epoch_t，供分期流水线使用 */
+void sleep_epoch_fixed_to_float(const sleep_epoch_fixed_t *in, sleep_epoch_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,305 @@
+#include "sleep_features.h"
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#if defined(ESP_PLATFORM)
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#else
+#include <chrono>
+#endif
+
+#if defined(ESP_PLATFORM) && CONFIG_IDF_TARGET_ESP32S3
+#define SLEEP_FEATURES_USE_DSP 1
+#include "dsps_fft2r.h"
+#include "dsps_dotprod.h"
+#include "dsps_mul.h"
+#else
+#define SLEEP_FEATURES_USE_DSP 0
+#endif
+
+/**
+ * 扩展特征提取
+ * 
+ * - 呼吸变异：epoch 内有效呼吸率的标准差与相邻差平均绝对值
+ * - 频段功率：HR/RR 的 3s 采样序列在 64 点滑窗上去均值、加 Hann 窗后做 FFT，
+ *   单边功率谱按 Parseval 归一化（单位 bpm²），累加两个频段：
+ *     low  0.005-0.04 Hz（k = 1..7）
+ *     mid  0.04-0.15 Hz （k = 8..28）
+ * - 体动：均方能量与越过阈值的上升沿次数
+ * 
+ * ESP32-S3 上 FFT、点积、逐元素乘法走 esp-dsp 的 aes3 优化内核；
+ * 主机端使用等价的标量实现作为参考。
+ */
+
+#define FEATURE_N            SLEEP_FEATURE_WINDOW
+#define FEATURE_SAMPLE_HZ    (1.0f / static_cast<float>(SLEEP_FEATURE_PERIOD_S))
+#define FEATURE_MAX_SAMPLES  64U   /* 单个 epoch 最多处理的采样数 */
+
+namespace {
+constexpr size_t band_bin(float hz) {
+    return static_cast<size_t>(hz * static_cast<float>(FEATURE_N) / FEATURE_SAMPLE_HZ);
+}
+constexpr size_t kLowBegin = 1;
+constexpr size_t kLowEnd = band_bin(0.04f);     /* 含 */
+constexpr size_t kMidBegin = kLowEnd + 1;
+constexpr size_t kMidEnd = band_bin(0.15f);     /* 含 */
+
+alignas(16) float s_window[FEATURE_N];
+alignas(16) float s_ones[FEATURE_MAX_SAMPLES];
+alignas(16) float s_series[FEATURE_N];
+alignas(16) float s_fft[FEATURE_N * 2];
+float s_window_energy = 0.0f;
+bool s_tables_ready = false;
+
+uint32_t now_us() {
+#if defined(ESP_PLATFORM)
+    return static_cast<uint32_t>(esp_timer_get_time());
+#else
+    using namespace std::chrono;
+    return static_cast<uint32_t>(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+void init_tables() {
+    if (s_tables_ready) {
+        return;
+    }
+    const float pi = 3.14159265358979f;
+    s_window_energy = 0.0f;
+    for (size_t i = 0; i < FEATURE_N; ++i) {
+        s_window[i] = 0.5f - 0.5f * std::cos(2.0f * pi * static_cast<float>(i) / static_cast<float>(FEATURE_N - 1));
+        s_window_energy += s_window[i] * s_window[i];
+    }
+    for (size_t i = 0; i < FEATURE_MAX_SAMPLES; ++i) {
+        s_ones[i] = 1.0f;
+    }
+#if SLEEP_FEATURES_USE_DSP
+    dsps_fft2r_init_fc32(nullptr, FEATURE_N);
+#endif
+    s_tables_ready = true;
+}
+
+float dot(const float *a, const float *b, size_t n) {
+#if SLEEP_FEATURES_USE_DSP
+    float r = 0.0f;
+    dsps_dotprod_f32(a, b, &r, static_cast<int>(n));
+    return r;
+#else
+    float r = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        r += a[i] * b[i];
+    }
+    return r;
+#endif
+}
+
+void multiply(const float *a, const float *b, float *out, size_t n) {
+#if SLEEP_FEATURES_USE_DSP
+    dsps_mul_f32(a, b, out, static_cast<int>(n), 1, 1, 1);
+#else
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = a[i] * b[i];
+    }
+#endif
+}
+
+#if !SLEEP_FEATURES_USE_DSP
+/* 标量参考：原位基2 FFT，交错复数布局与 esp-dsp 一致 */
+void fft_scalar(float *data, size_t n) {
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(data[2 * i], data[2 * j]);
+            std::swap(data[2 * i + 1], data[2 * j + 1]);
+        }
+    }
+    const float pi = 3.14159265358979f;
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const float ang = -2.0f * pi / static_cast<float>(len);
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; ++k) {
+                const float wr = std::cos(ang * static_cast<float>(k));
+                const float wi = std::sin(ang * static_cast<float>(k));
+                float *u = &data[2 * (i + k)];
+                float *v = &data[2 * (i + k + len / 2)];
+                const float tr = v[0] * wr - v[1] * wi;
+                const float ti = v[0] * wi + v[1] * wr;
+                v[0] = u[0] - tr;
+                v[1] = u[1] - ti;
+                u[0] += tr;
+                u[1] += ti;
+            }
+        }
+    }
+}
+#endif
+
+/**
+ * @brief 对环形缓冲中的序列计算两个频段功率
+ */
+void band_powers(const float *ring, size_t head, float *out_low, float *out_mid) {
+    for (size_t i = 0; i < FEATURE_N; ++i) {
+        s_series[i] = ring[(head + i) % FEATURE_N];
+    }
+    const float mean = dot(s_series, s_ones, FEATURE_N) / static_cast<float>(FEATURE_N);
+    for (size_t i = 0; i < FEATURE_N; ++i) {
+        s_series[i] -= mean;
+    }
+    multiply(s_series, s_window, s_series, FEATURE_N);
+
+    for (size_t i = 0; i < FEATURE_N; ++i) {
+        s_fft[2 * i] = s_series[i];
+        s_fft[2 * i + 1] = 0.0f;
+    }
+#if SLEEP_FEATURES_USE_DSP
+    dsps_fft2r_fc32(s_fft, FEATURE_N);
+    dsps_bit_rev_fc32(s_fft, FEATURE_N);
+#else
+    fft_scalar(s_fft, FEATURE_N);
+#endif
+
+    const float norm = 2.0f / (static_cast<float>(FEATURE_N) * s_window_energy);
+    float low = 0.0f;
+    float mid = 0.0f;
+    for (size_t k = kLowBegin; k <= kMidEnd; ++k) {
+        const float re = s_fft[2 * k];
+        const float im = s_fft[2 * k + 1];
+        const float p = (re * re + im * im) * norm;
+        if (k <= kLowEnd) {
+            low += p;
+        } else {
+            mid += p;
+        }
+    }
+    *out_low = low;
+    *out_mid = mid;
+}
+}
+
+extern "C" void sleep_features_init(sleep_feature_state_t *state) {
+    if (state == nullptr) {
+        return;
+    }
+    std::memset(state, 0, sizeof(*state));
+    init_tables();
+}
+
+extern "C" void sleep_features_extract(sleep_feature_state_t *state,
+                                       const radar_sample_t *samples,
+                                       size_t count,
+                                       sleep_epoch_features_t *out) {
+    if (state == nullptr || out == nullptr) {
+        return;
+    }
+    *out = {};
+    if (samples == nullptr || count == 0) {
+        return;
+    }
+    init_tables();
+    const uint32_t t0 = now_us();
+
+    if (count > FEATURE_MAX_SAMPLES) {
+        samples += count - FEATURE_MAX_SAMPLES;
+        count = FEATURE_MAX_SAMPLES;
+    }
+
+    /* 呼吸变异与体动（epoch 内） */
+    alignas(16) float motion[FEATURE_MAX_SAMPLES];
+    float rr_sum = 0.0f;
+    float rr_sq = 0.0f;
+    float rr_diff_sum = 0.0f;
+    size_t rr_n = 0;
+    size_t rr_diff_n = 0;
+    float prev_rr = 0.0f;
+    uint8_t prev_motion = state->last_motion;
+    uint16_t bursts = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        const radar_sample_t &s = samples[i];
+        motion[i] = static_cast<float>(s.motion_level);
+        if (prev_motion < SLEEP_FEATURE_BURST_LEVEL && s.motion_level >= SLEEP_FEATURE_BURST_LEVEL) {
+            bursts++;
+        }
+        prev_motion = s.motion_level;
+
+        const bool rr_valid = s.respiratory_rate_bpm > 0 && s.respiratory_rate_bpm <= 35;
+        const bool hr_valid = s.heart_rate_bpm >= 60 && s.heart_rate_bpm <= 120;
+        if (rr_valid) {
+            const float rr = static_cast<float>(s.respiratory_rate_bpm);
+            rr_sum += rr;
+            rr_sq += rr * rr;
+            if (rr_n > 0) {
+                rr_diff_sum += std::fabs(rr - prev_rr);
+                rr_diff_n++;
+            }
+            prev_rr = rr;
+            rr_n++;
+            state->last_rr = rr;
+        }
+        if (hr_valid) {
+            state->last_hr = static_cast<float>(s.heart_rate_bpm);
+        }
+
+        /* 频谱滑窗：无效采样保持上一个有效值，避免 0 值注入伪低频能量 */
+        state->hr[state->head] = state->last_hr;
+        state->rr[state->head] = state->last_rr;
+        state->head = (state->head + 1) % FEATURE_N;
+        if (state->fill < FEATURE_N) {
+            state->fill++;
+        }
+    }
+    state->last_motion = prev_motion;
+
+    if (rr_n > 1) {
+        const float mean = rr_sum / static_cast<float>(rr_n);
+        const float var = (rr_sq - static_cast<float>(rr_n) * mean * mean) / static_cast<float>(rr_n - 1);
+        out->rr_std = var > 0.0f ? std::sqrt(var) : 0.0f;
+    }
+    out->rr_mean_abs_diff = rr_diff_n > 0 ? rr_diff_sum / static_cast<float>(rr_diff_n) : 0.0f;
+    out->motion_energy = dot(motion, motion, count) / static_cast<float>(count);
+    out->motion_bursts = bursts;
+    out->window_fill = static_cast<uint16_t>(state->fill);
+
+    /* 频段功率（滑窗填满后） */
+    if (state->fill == FEATURE_N) {
+        band_powers(state->hr, state->head, &out->hr_power_low, &out->hr_power_mid);
+        band_powers(state->rr, state->head, &out->rr_power_low, &out->rr_power_mid);
+    }
+
+    const uint32_t cost = now_us() - t0;
+    state->last_cost_us = cost;
+    if (cost > state->max_cost_us) {
+        state->max_cost_us = cost;
+    }
+}
+
+extern "C" size_t sleep_features_resample(const radar_sample_t *samples,
+                                          size_t count,
+                                          uint32_t period_s,
+                                          radar_sample_t *out,
+                                          size_t out_count) {
+    if (samples == nullptr || out == nullptr || count == 0 || out_count == 0) {
+        return 0;
+    }
+
+    const uint32_t t_end = samples[count - 1].timestamp;
+    size_t src = 0;
+    for (size_t k = 0; k < out_count; ++k) {
+        const uint32_t back = static_cast<uint32_t>(out_count - 1 - k) * period_s;
+        const uint32_t t = (t_end > back) ? t_end - back : 0U;
+        /* 采样按时间递增，游标只前移 */
+        while (src + 1 < count && samples[src + 1].timestamp <= t) {
+            src++;
+        }
+        out[k] = samples[src];
+        out[k].timestamp = t;
+    }
+    return out_count;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sleep_analysis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 频谱滑窗：64 个 3s 采样（约 3.2 分钟），频率分辨率 fs/64 ≈ 0.0052 Hz */
+#define SLEEP_FEATURE_WINDOW      64U
+#define SLEEP_FEATURE_BURST_LEVEL 20U   /* 体动突发判定阈值 (0-100) */
+#define SLEEP_FEATURE_PERIOD_S    3U    /* 滑窗采样周期；变速率采样先经 sleep_features_resample 对齐 */
+
+/**
+ * @brief 每个 epoch 的扩展特征，与 sleep_epoch_t 一一对应
+ */
+typedef struct {
+    float rr_std;                /* epoch 内呼吸率标准差 */
+    float rr_mean_abs_diff;      /* 相邻采样呼吸率差的平均绝对值 */
+    float hr_power_low;          /* HR 序列 0.005-0.04 Hz 频段功率 */
+    float hr_power_mid;          /* HR 序列 0.04-0.15 Hz 频段功率 */
+    float rr_power_low;          /* RR 序列 0.005-0.04 Hz 频段功率 */
+    float rr_power_mid;          /* RR 序列 0.04-0.15 Hz 频段功率 */
+    float motion_energy;         /* 体动均方值 */
+    uint16_t motion_bursts;      /* 体动越过 SLEEP_FEATURE_BURST_LEVEL 的上升沿次数 */
+    uint16_t window_fill;        /* 滑窗已填充的采样数，未满时频段功率为 0 */
+} sleep_epoch_features_t;
+
+/**
+ * @brief 特征提取状态（跨 epoch 的 HR/RR 采样滑窗）
+ */
+typedef struct {
+    float hr[SLEEP_FEATURE_WINDOW];
+    float rr[SLEEP_FEATURE_WINDOW];
+    size_t head;
+    size_t fill;
+    float last_hr;               /* 无效采样用上一个有效值保持 */
+    float last_rr;
+    uint8_t last_motion;         /* 上个 epoch 最后一个体动值，用于跨 epoch 的突发沿判定 */
+    uint32_t last_cost_us;       /* 最近一次提取耗时 */
+    uint32_t max_cost_us;        /* 历史最大耗时 */
+} sleep_feature_state_t;
+
+void sleep_features_init(sleep_feature_state_t *state);
+
+/**
+ * @brief 推入一个 epoch 的原始采样并计算扩展特征
+ *
+ * ESP32-S3 上使用 esp-dsp 的 FFT/点积/乘法内核，其余平台使用标量参考实现。
+ * 内部使用静态 FFT 工作区，仅供单一任务调用。
+ */
+void sleep_features_extract(sleep_feature_state_t *state,
+                            const radar_sample_t *samples,
+                            size_t count,
+                            sleep_epoch_features_t *out);
+
+/**
+ * @brief 将变速率采样按时间戳零阶保持重采样为等间隔序列
+ *
+ * 网格以最后一个采样时刻为终点、间隔 period_s 向前排 out_count 个点，
+ * 每点取不晚于该时刻的最近采样（早于首个采样的网格点取首个采样）。
+ * 输出采样的 timestamp 为网格时刻。
+ *
+ * @return 输出点数；count 为 0 时返回 0
+ */
+size_t sleep_features_resample(const radar_sample_t *samples,
+                               size_t count,
+                               uint32_t period_s,
+                               radar_sample_t *out,
+                               size_t out_count);
+
+#ifdef __cplusplus
+}
+#endif
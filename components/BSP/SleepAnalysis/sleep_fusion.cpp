@@ -0,0 +1,143 @@
+#include "sleep_fusion.h"
+
+#include <cstring>
+
+namespace {
+constexpr uint32_t kWindowMask = (1U << SLEEP_FUSION_WINDOW) - 1U;
+constexpr float kCostAlpha = 0.2f;
+
+bool radar_fresh(const sleep_fusion_t &f, uint32_t now) {
+    if (f.radar_state > SLEEP_FUSION_RADAR_AWAKE) {
+        return false;
+    }
+    return now >= f.radar_ts && (now - f.radar_ts) <= SLEEP_FUSION_MAX_AGE_S;
+}
+
+/* 雷达状态能否唯一映射到本地阶段：浅睡可能是 REM 或 NREM，不参与比较与卸载 */
+bool radar_mappable(uint8_t radar) {
+    return radar == SLEEP_FUSION_RADAR_AWAKE || radar == SLEEP_FUSION_RADAR_DEEP;
+}
+
+/* 上报足够新，可与本 epoch 的本地结果比较 */
+bool radar_comparable(const sleep_fusion_t &f, uint32_t now) {
+    return radar_mappable(f.radar_state) && now >= f.radar_ts &&
+           (now - f.radar_ts) <= SLEEP_FUSION_AGREE_AGE_S;
+}
+
+bool stages_agree(sleep_stage_t local, uint8_t radar) {
+    switch (radar) {
+    case SLEEP_FUSION_RADAR_AWAKE:
+        return local == SLEEP_STAGE_WAKE;
+    case SLEEP_FUSION_RADAR_DEEP:
+        return local == SLEEP_STAGE_NREM;
+    default:
+        return false;
+    }
+}
+
+void clear_window(sleep_fusion_t &f) {
+    f.agree_bits = 0;
+    f.compared = 0;
+    f.offloaded = false;
+    f.since_check = 0;
+}
+}
+
+extern "C" void sleep_fusion_reset(sleep_fusion_t *fusion) {
+    if (fusion == nullptr) {
+        return;
+    }
+    std::memset(fusion, 0, sizeof(*fusion));
+    fusion->radar_state = SLEEP_FUSION_RADAR_UNKNOWN;
+    fusion->last_sleep_stage = SLEEP_STAGE_NREM;
+}
+
+extern "C" void sleep_fusion_update_radar(sleep_fusion_t *fusion, uint8_t radar_state, uint32_t timestamp) {
+    if (fusion == nullptr) {
+        return;
+    }
+    fusion->radar_state = radar_state;
+    fusion->radar_ts = timestamp;
+}
+
+extern "C" bool sleep_fusion_need_local(sleep_fusion_t *fusion, uint32_t now) {
+    if (fusion == nullptr) {
+        return true;
+    }
+    if (!radar_fresh(*fusion, now)) {
+        if (fusion->offloaded) {
+            clear_window(*fusion);
+        }
+        return true;
+    }
+    if (!fusion->offloaded || !radar_mappable(fusion->radar_state)) {
+        return true;
+    }
+    return fusion->since_check >= SLEEP_FUSION_RECHECK;
+}
+
+extern "C" void sleep_fusion_record_local(sleep_fusion_t *fusion, sleep_stage_t local_stage,
+                                          uint32_t cost_us, uint32_t now) {
+    if (fusion == nullptr) {
+        return;
+    }
+
+    fusion->local_epochs++;
+    fusion->local_cost_us = (fusion->local_epochs == 1U)
+        ? static_cast<float>(cost_us)
+        : fusion->local_cost_us + kCostAlpha * (static_cast<float>(cost_us) - fusion->local_cost_us);
+    if (local_stage == SLEEP_STAGE_REM || local_stage == SLEEP_STAGE_NREM) {
+        fusion->last_sleep_stage = local_stage;
+    }
+
+    if (!radar_comparable(*fusion, now)) {
+        return;
+    }
+
+    const bool agree = stages_agree(local_stage, fusion->radar_state);
+    if (fusion->offloaded) {
+        /* 复核：一次不一致即退出卸载，重新积累窗口 */
+        if (!agree) {
+            clear_window(*fusion);
+        } else {
+            fusion->since_check = 0;
+        }
+        return;
+    }
+
+    fusion->agree_bits = ((fusion->agree_bits << 1) | (agree ? 1U : 0U)) & kWindowMask;
+    if (fusion->compared < SLEEP_FUSION_WINDOW) {
+        fusion->compared++;
+    }
+    if (fusion->compared >= SLEEP_FUSION_WINDOW && sleep_fusion_agree_count(fusion) >= SLEEP_FUSION_MIN_AGREE) {
+        fusion->offloaded = true;
+        fusion->since_check = 0;
+    }
+}
+
+extern "C" sleep_stage_t sleep_fusion_take_radar_stage(sleep_fusion_t *fusion) {
+    if (fusion == nullptr) {
+        return SLEEP_STAGE_UNKNOWN;
+    }
+
+    fusion->offloaded_epochs++;
+    fusion->since_check++;
+    fusion->saved_us += static_cast<uint64_t>(fusion->local_cost_us);
+
+    switch (fusion->radar_state) {
+    case SLEEP_FUSION_RADAR_AWAKE:
+        return SLEEP_STAGE_WAKE;
+    case SLEEP_FUSION_RADAR_DEEP:
+        return SLEEP_STAGE_NREM;
+    default:
+        /* need_local 对浅睡返回 true，不会走到这里；保守沿用最近一次本地判定 */
+        return fusion->last_sleep_stage;
+    }
+}
+
+extern "C" uint32_t sleep_fusion_agree_count(const sleep_fusion_t *fusion) {
+    if (fusion == nullptr) {
+        return 0;
+    }
+    return static_cast<uint32_t>(__builtin_popcount(fusion->agree_bits & kWindowMask));
+}
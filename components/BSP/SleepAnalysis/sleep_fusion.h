@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sleep_analysis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 雷达片上睡眠状态（与 R60ABD1 协议一致） */
+#define SLEEP_FUSION_RADAR_DEEP    0U
+#define SLEEP_FUSION_RADAR_LIGHT   1U
+#define SLEEP_FUSION_RADAR_AWAKE   2U
+#define SLEEP_FUSION_RADAR_NONE    3U    /* 离床/无人 */
+#define SLEEP_FUSION_RADAR_UNKNOWN 0xFFU
+
+#define SLEEP_FUSION_WINDOW        20U   /* 一致性窗口：20 个 epoch（10 分钟） */
+#define SLEEP_FUSION_MIN_AGREE     18U   /* 窗口内至少 18 次一致才卸载 */
+#define SLEEP_FUSION_RECHECK       10U   /* 卸载后每 10 个 epoch 本地复核一次 */
+#define SLEEP_FUSION_MAX_AGE_S     720U  /* 雷达每 10 分钟上报，超过 12 分钟视为过期 */
+#define SLEEP_FUSION_AGREE_AGE_S   60U   /* 一致性比较只用 2 个 epoch 内的雷达上报 */
+
+/**
+ * @brief 雷达/本地分期融合状态
+ *
+ * 本地分期与雷达上报的状态比较（深睡对应 NREM，清醒对应 WAKE），只在雷达上报不超过
+ * SLEEP_FUSION_AGREE_AGE_S 时计入；浅睡无法区分 REM/NREM，既不计入也不卸载。
+ * 最近 SLEEP_FUSION_WINDOW 次比较中一致次数达标后进入卸载：雷达为深睡/清醒时
+ * 跳过本地阈值计算与分期，直接采用雷达状态。卸载期间每 SLEEP_FUSION_RECHECK 个 epoch
+ * 起本地分期，直到有新鲜的上报完成复核；任一次不一致、雷达过期或离床即退出并清空窗口。
+ * 仅供分期任务单线程使用。
+ */
+typedef struct {
+    uint8_t radar_state;             /* SLEEP_FUSION_RADAR_* */
+    uint32_t radar_ts;               /* 雷达状态更新时刻 (s) */
+    uint32_t agree_bits;             /* 最近比较结果位图，bit0 为最新 */
+    uint8_t compared;                /* 窗口内已比较次数 */
+    bool offloaded;
+    uint16_t since_check;            /* 卸载后距上次复核的 epoch 数 */
+    sleep_stage_t last_sleep_stage;  /* 最近一次本地判定的睡眠阶段（REM/NREM），雷达状态无法映射时沿用 */
+    float local_cost_us;             /* 本地分期耗时（指数平均） */
+    uint32_t local_epochs;           /* 本地计算次数 */
+    uint32_t offloaded_epochs;       /* 卸载次数 */
+    uint64_t saved_us;               /* 累计节省的 CPU 时间估计 */
+} sleep_fusion_t;
+
+void sleep_fusion_reset(sleep_fusion_t *fusion);
+
+/* 更新雷达最新睡眠状态及其上报时刻 */
+void sleep_fusion_update_radar(sleep_fusion_t *fusion, uint8_t radar_state, uint32_t timestamp);
+
+/* 本 epoch 是否需要本地分期（未卸载、雷达不可用或为浅睡、到达复核周期） */
+bool sleep_fusion_need_local(sleep_fusion_t *fusion, uint32_t now);
+
+/* 本地分期完成后记录结果与耗时，更新一致性窗口 */
+void sleep_fusion_record_local(sleep_fusion_t *fusion, sleep_stage_t local_stage, uint32_t cost_us, uint32_t now);
+
+/* 卸载时取雷达映射的阶段，并累计节省的 CPU 时间 */
+sleep_stage_t sleep_fusion_take_radar_stage(sleep_fusion_t *fusion);
+
+/* 窗口内一致次数 */
+uint32_t sleep_fusion_agree_count(const sleep_fusion_t *fusion);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,262 @@
+#include "sleep_night_summary.h"
+
+#include <cmath>
+#include <cstring>
+
+/**
+ * 整晚摘要：入睡后逐 epoch 累加，醒来时编码为一个紧凑二进制包一次上传。
+ * 10 小时（1200 epoch）打包催眠图 300 字节，游程编码通常 < 150 字节，
+ * 加上报告与小时聚合，总计 < 500 字节。
+ */
+
+#define NIGHT_MAGIC        0x544E4C53U  /* "SLNT" */
+#define NIGHT_VERSION      1U
+#define NIGHT_ENC_PACKED   0U
+#define NIGHT_ENC_RLE      1U
+#define NIGHT_RLE_MAX_RUN  64U
+
+namespace {
+class Writer {
+public:
+    Writer(uint8_t *buf, size_t cap) : buf_(buf), cap_(cap) {}
+
+    void u8(uint32_t v) {
+        if (pos_ < cap_) {
+            buf_[pos_] = static_cast<uint8_t>(v);
+        } else {
+            overflow_ = true;
+        }
+        pos_++;
+    }
+    void u16(uint32_t v) { u8(v); u8(v >> 8); }
+    void u32(uint32_t v) { u16(v); u16(v >> 16); }
+    void bytes(const uint8_t *p, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            u8(p[i]);
+        }
+    }
+
+    size_t pos() const { return pos_; }
+    bool ok() const { return !overflow_; }
+
+private:
+    uint8_t *buf_;
+    size_t cap_;
+    size_t pos_ = 0;
+    bool overflow_ = false;
+};
+
+uint32_t crc32_ieee(const uint8_t *p, size_t n) {
+    uint32_t crc = 0xFFFFFFFFU;
+    for (size_t i = 0; i < n; ++i) {
+        crc ^= p[i];
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+uint32_t quantize(float v, float scale, uint32_t max) {
+    if (!(v > 0.0f)) {
+        return 0;
+    }
+    const float q = std::round(v * scale);
+    return q >= static_cast<float>(max) ? max : static_cast<uint32_t>(q);
+}
+
+/* 游程编码长度（字节），用于决定是否比 2bit 打包更省 */
+size_t rle_length(const sleep_night_t &night) {
+    size_t bytes = 0;
+    size_t i = 0;
+    while (i < night.epoch_count) {
+        const sleep_stage_t s = sleep_night_stage_at(&night, i);
+        size_t run = 1;
+        while (i + run < night.epoch_count && run < NIGHT_RLE_MAX_RUN &&
+               sleep_night_stage_at(&night, i + run) == s) {
+            run++;
+        }
+        bytes++;
+        i += run;
+    }
+    return bytes;
+}
+
+void write_rle(const sleep_night_t &night, Writer &w) {
+    size_t i = 0;
+    while (i < night.epoch_count) {
+        const sleep_stage_t s = sleep_night_stage_at(&night, i);
+        size_t run = 1;
+        while (i + run < night.epoch_count && run < NIGHT_RLE_MAX_RUN &&
+               sleep_night_stage_at(&night, i + run) == s) {
+            run++;
+        }
+        w.u8((static_cast<uint32_t>(s) << 6) | static_cast<uint32_t>(run - 1));
+        i += run;
+    }
+}
+}
+
+extern "C" void sleep_night_begin(sleep_night_t *night, uint32_t start_time) {
+    if (night == nullptr) {
+        return;
+    }
+    std::memset(night, 0, sizeof(*night));
+    night->start_time = start_time;
+}
+
+extern "C" int sleep_night_add_epoch(sleep_night_t *night, const sleep_epoch_t *epoch, sleep_stage_t stage) {
+    if (night == nullptr || epoch == nullptr || night->epoch_count >= SLEEP_NIGHT_MAX_EPOCHS) {
+        return 0;
+    }
+
+    const size_t idx = night->epoch_count;
+    const uint32_t code = static_cast<uint32_t>(stage) & 0x3U;
+    night->hypnogram[idx / 4] |= static_cast<uint8_t>(code << ((idx % 4) * 2));
+
+    sleep_night_hour_t &h = night->hours[idx / SLEEP_NIGHT_EPOCHS_PER_HOUR];
+    h.epochs++;
+    h.stage_epochs[code]++;
+    h.motion_sum += epoch->motion_index;
+    if (epoch->heart_rate_mean > 0.0f) {
+        h.hr_sum += epoch->heart_rate_mean;
+        h.hrv_sum += epoch->heart_rate_std;
+        h.hr_count++;
+    }
+    if (epoch->respiratory_rate_bpm > 0.0f) {
+        h.rr_sum += epoch->respiratory_rate_bpm;
+        h.rr_count++;
+    }
+
+    night->epoch_count++;
+    return 1;
+}
+
+extern "C" sleep_stage_t sleep_night_stage_at(const sleep_night_t *night, size_t idx) {
+    if (night == nullptr || idx >= night->epoch_count) {
+        return SLEEP_STAGE_UNKNOWN;
+    }
+    return static_cast<sleep_stage_t>((night->hypnogram[idx / 4] >> ((idx % 4) * 2)) & 0x3U);
+}
+
+extern "C" void sleep_night_build_report(const sleep_night_t *night, sleep_quality_report_t *out_report) {
+    if (out_report == nullptr) {
+        return;
+    }
+    *out_report = {};
+    if (night == nullptr || night->epoch_count == 0) {
+        return;
+    }
+
+    uint32_t stage_epochs[4] = {0, 0, 0, 0};
+    float hr_sum = 0.0f;
+    float hrv_sum = 0.0f;
+    float rr_sum = 0.0f;
+    float motion_sum = 0.0f;
+    uint32_t hr_count = 0;
+    uint32_t rr_count = 0;
+    const size_t hours = (night->epoch_count + SLEEP_NIGHT_EPOCHS_PER_HOUR - 1U) / SLEEP_NIGHT_EPOCHS_PER_HOUR;
+    for (size_t i = 0; i < hours; ++i) {
+        const sleep_night_hour_t &h = night->hours[i];
+        for (size_t k = 0; k < 4; ++k) {
+            stage_epochs[k] += h.stage_epochs[k];
+        }
+        hr_sum += h.hr_sum;
+        hrv_sum += h.hrv_sum;
+        rr_sum += h.rr_sum;
+        motion_sum += h.motion_sum;
+        hr_count += h.hr_count;
+        rr_count += h.rr_count;
+    }
+
+    /* 转换次数与 build_quality 相同：UNKNOWN 之后的第一个阶段不计 */
+    size_t transitions = 0;
+    sleep_stage_t prev = SLEEP_STAGE_UNKNOWN;
+    for (size_t i = 0; i < night->epoch_count; ++i) {
+        const sleep_stage_t s = sleep_night_stage_at(night, i);
+        if (prev != SLEEP_STAGE_UNKNOWN && s != prev) {
+            transitions++;
+        }
+        prev = s;
+    }
+
+    const uint32_t epoch_s = 30U;
+    const float total_seconds = static_cast<float>(night->epoch_count * epoch_s);
+    const uint32_t sleep_epochs = stage_epochs[SLEEP_STAGE_REM] + stage_epochs[SLEEP_STAGE_NREM];
+    out_report->wake_seconds = stage_epochs[SLEEP_STAGE_WAKE] * epoch_s;
+    out_report->rem_seconds = stage_epochs[SLEEP_STAGE_REM] * epoch_s;
+    out_report->nrem_seconds = stage_epochs[SLEEP_STAGE_NREM] * epoch_s;
+    out_report->sleep_efficiency = static_cast<float>(sleep_epochs * epoch_s) / total_seconds;
+    out_report->rem_ratio = (sleep_epochs > 0)
+        ? static_cast<float>(stage_epochs[SLEEP_STAGE_REM]) / static_cast<float>(sleep_epochs) : 0.0f;
+    out_report->average_resp_rate = (rr_count > 0) ? rr_sum / static_cast<float>(rr_count) : 0.0f;
+    out_report->average_motion = motion_sum / static_cast<float>(night->epoch_count);
+    out_report->average_heart_rate = (hr_count > 0) ? hr_sum / static_cast<float>(hr_count) : 0.0f;
+    out_report->average_hrv = (hr_count > 0) ? hrv_sum / static_cast<float>(hr_count) : 0.0f;
+    out_report->sleep_score = sleep_analysis_quality_score(out_report, transitions, total_seconds);
+}
+
+extern "C" size_t sleep_night_encode(const sleep_night_t *night,
+                                     const sleep_quality_report_t *report,
+                                     uint8_t *out, size_t cap) {
+    if (night == nullptr || report == nullptr || out == nullptr) {
+        return 0;
+    }
+
+    const size_t packed_len = (night->epoch_count + 3U) / 4U;
+    const size_t rle_len = rle_length(*night);
+    const bool use_rle = rle_len < packed_len;
+    const size_t hours = (night->epoch_count + SLEEP_NIGHT_EPOCHS_PER_HOUR - 1U) / SLEEP_NIGHT_EPOCHS_PER_HOUR;
+
+    Writer w(out, cap);
+
+    /* 头部 */
+    w.u32(NIGHT_MAGIC);
+    w.u8(NIGHT_VERSION);
+    w.u8(use_rle ? NIGHT_ENC_RLE : NIGHT_ENC_PACKED);
+    w.u16(night->epoch_count);
+    w.u32(night->start_time);
+    w.u16(30);
+    w.u8(static_cast<uint32_t>(hours));
+    w.u8(0);
+
+    /* 质量报告 */
+    w.u32(report->wake_seconds);
+    w.u32(report->rem_seconds);
+    w.u32(report->nrem_seconds);
+    w.u16(quantize(report->rem_ratio, 10000.0f, 0xFFFF));
+    w.u16(quantize(report->sleep_efficiency, 10000.0f, 0xFFFF));
+    w.u16(quantize(report->average_resp_rate, 100.0f, 0xFFFF));
+    w.u16(quantize(report->average_motion, 100.0f, 0xFFFF));
+    w.u16(quantize(report->average_heart_rate, 100.0f, 0xFFFF));
+    w.u16(quantize(report->average_hrv, 100.0f, 0xFFFF));
+    w.u16(quantize(report->sleep_score, 100.0f, 0xFFFF));
+
+    /* 小时聚合 */
+    for (size_t i = 0; i < hours; ++i) {
+        const sleep_night_hour_t &h = night->hours[i];
+        w.u8(h.hr_count ? quantize(h.hr_sum / h.hr_count, 1.0f, 255) : 0);
+        w.u8(h.rr_count ? quantize(h.rr_sum / h.rr_count, 1.0f, 255) : 0);
+        w.u8(h.epochs ? quantize(h.motion_sum / h.epochs, 1.0f, 255) : 0);
+        w.u8(h.hr_count ? quantize(h.hrv_sum / h.hr_count, 10.0f, 255) : 0);
+        w.u8((h.stage_epochs[SLEEP_STAGE_WAKE] + 1U) / 2U);
+        w.u8((h.stage_epochs[SLEEP_STAGE_REM] + 1U) / 2U);
+        w.u8((h.stage_epochs[SLEEP_STAGE_NREM] + 1U) / 2U);
+        w.u8(h.epochs);
+    }
+
+    /* 催眠图 */
+    if (use_rle) {
+        w.u16(static_cast<uint32_t>(rle_len));
+        write_rle(*night, w);
+    } else {
+        w.u16(static_cast<uint32_t>(packed_len));
+        w.bytes(night->hypnogram, packed_len);
+    }
+
+    if (!w.ok()) {
+        return 0;
+    }
+    w.u32(crc32_ieee(out, w.pos()));
+    return w.ok() ? w.pos() : 0;
+}
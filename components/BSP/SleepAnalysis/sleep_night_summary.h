@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sleep_analysis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SLEEP_NIGHT_MAX_EPOCHS  1440U   /* 12 小时 */
+#define SLEEP_NIGHT_MAX_HOURS   12U
+#define SLEEP_NIGHT_EPOCHS_PER_HOUR 120U
+
+/* 整晚摘要编码后的最大字节数（头 + 报告 + 12小时 + 打包催眠图 + CRC） */
+#define SLEEP_NIGHT_BLOB_MAX    (16U + 26U + SLEEP_NIGHT_MAX_HOURS * 8U + 2U + SLEEP_NIGHT_MAX_EPOCHS / 4U + 4U)
+
+typedef struct {
+    float hr_sum;
+    float rr_sum;
+    float motion_sum;
+    float hrv_sum;
+    uint16_t hr_count;
+    uint16_t rr_count;
+    uint16_t epochs;
+    uint16_t stage_epochs[4];        /* 按 sleep_stage_t 索引 */
+} sleep_night_hour_t;
+
+/**
+ * @brief 整晚累加器：2bit/epoch 催眠图 + 按小时聚合
+ */
+typedef struct {
+    uint32_t start_time;             /* 入睡时刻 (unix s) */
+    uint16_t epoch_count;
+    uint8_t hypnogram[SLEEP_NIGHT_MAX_EPOCHS / 4U];
+    sleep_night_hour_t hours[SLEEP_NIGHT_MAX_HOURS];
+} sleep_night_t;
+
+void sleep_night_begin(sleep_night_t *night, uint32_t start_time);
+
+/* 追加一个 epoch；超过 12 小时后返回 0 并忽略 */
+int sleep_night_add_epoch(sleep_night_t *night, const sleep_epoch_t *epoch, sleep_stage_t stage);
+
+/* 读取第 idx 个 epoch 的阶段 */
+sleep_stage_t sleep_night_stage_at(const sleep_night_t *night, size_t idx);
+
+/**
+ * @brief 由整晚累加器生成质量报告（覆盖入睡以来的全部 epoch，最多 12 小时）
+ *        阶段时长与转换次数取自催眠图，平均体征取自小时聚合（心率/呼吸只计有效 epoch），
+ *        评分与 sleep_analysis_build_quality 相同。
+ */
+void sleep_night_build_report(const sleep_night_t *night, sleep_quality_report_t *out_report);
+
+/**
+ * @brief 编码整晚摘要（小端序）
+ *
+ * 布局：
+ *   0  u32  magic 'SLNT'          4  u8  版本(1)     5  u8  催眠图编码(0=2bit打包,1=游程)
+ *   6  u16  epoch 数              8  u32 入睡时刻    12 u16 epoch 秒数   14 u8 小时数 H  15 u8 保留
+ *   16 质量报告 26B：u32 wake_s, u32 rem_s, u32 nrem_s, u16 rem_ratio*1e4, u16 efficiency*1e4,
+ *      u16 avg_rr*100, u16 avg_motion*100, u16 avg_hr*100, u16 avg_hrv*100, u16 score*100
+ *   42 H 个小时记录 8B：u8 hr, u8 rr, u8 motion, u8 hrv*10, u8 wake_min, u8 rem_min, u8 nrem_min, u8 epochs
+ *   .. u16 催眠图字节数 + 数据
+ *        打包：每字节4个epoch，低位在前，2bit = sleep_stage_t
+ *        游程：每字节 (stage << 6) | (run_len - 1)，run_len 1..64
+ *   .. u32 CRC-32 (IEEE，覆盖之前所有字节)
+ *
+ * @return 写入字节数；cap 不足返回 0
+ */
+size_t sleep_night_encode(const sleep_night_t *night,
+                          const sleep_quality_report_t *report,
+                          uint8_t *out, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
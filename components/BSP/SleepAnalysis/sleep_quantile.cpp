@@ -0,0 +1,152 @@
+#include "sleep_quantile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+/* 抛物线（P²）插值 */
+float parabolic(const sleep_p2_t &e, int i, int d) {
+    const float n_prev = static_cast<float>(e.n[i - 1]);
+    const float n_cur = static_cast<float>(e.n[i]);
+    const float n_next = static_cast<float>(e.n[i + 1]);
+    const float fd = static_cast<float>(d);
+    return e.q[i] + fd / (n_next - n_prev) *
+           ((n_cur - n_prev + fd) * (e.q[i + 1] - e.q[i]) / (n_next - n_cur) +
+            (n_next - n_cur - fd) * (e.q[i] - e.q[i - 1]) / (n_cur - n_prev));
+}
+
+float linear(const sleep_p2_t &e, int i, int d) {
+    return e.q[i] + static_cast<float>(d) * (e.q[i + d] - e.q[i]) /
+           static_cast<float>(e.n[i + d] - e.n[i]);
+}
+}
+
+extern "C" void sleep_p2_init(sleep_p2_t *est, float p) {
+    if (est == nullptr) {
+        return;
+    }
+    std::memset(est, 0, sizeof(*est));
+    est->p = std::min(std::max(p, 0.01f), 0.99f);
+}
+
+extern "C" void sleep_p2_add(sleep_p2_t *est, float x) {
+    if (est == nullptr || !std::isfinite(x)) {
+        return;
+    }
+
+    /* 前 5 个样本：直接收集，满 5 个后排序并初始化标记 */
+    if (est->count < 5U) {
+        est->q[est->count++] = x;
+        if (est->count == 5U) {
+            std::sort(est->q, est->q + 5);
+            const float p = est->p;
+            for (int i = 0; i < 5; ++i) {
+                est->n[i] = i;
+            }
+            est->np[0] = 0.0f;
+            est->np[1] = 2.0f * p;
+            est->np[2] = 4.0f * p;
+            est->np[3] = 2.0f + 2.0f * p;
+            est->np[4] = 4.0f;
+        }
+        return;
+    }
+
+    int k;
+    if (x < est->q[0]) {
+        est->q[0] = x;
+        k = 0;
+    } else if (x >= est->q[4]) {
+        est->q[4] = x;
+        k = 3;
+    } else {
+        k = 0;
+        while (k < 3 && x >= est->q[k + 1]) {
+            k++;
+        }
+    }
+
+    for (int i = k + 1; i < 5; ++i) {
+        est->n[i]++;
+    }
+    const float p = est->p;
+    const float dn[5] = {0.0f, p / 2.0f, p, (1.0f + p) / 2.0f, 1.0f};
+    for (int i = 0; i < 5; ++i) {
+        est->np[i] += dn[i];
+    }
+
+    /* 调整中间三个标记 */
+    for (int i = 1; i <= 3; ++i) {
+        const float d = est->np[i] - static_cast<float>(est->n[i]);
+        if ((d >= 1.0f && est->n[i + 1] - est->n[i] > 1) ||
+            (d <= -1.0f && est->n[i - 1] - est->n[i] < -1)) {
+            const int s = (d > 0.0f) ? 1 : -1;
+            const float qp = parabolic(*est, i, s);
+            est->q[i] = (est->q[i - 1] < qp && qp < est->q[i + 1]) ? qp : linear(*est, i, s);
+            est->n[i] += s;
+        }
+    }
+    est->count++;
+}
+
+extern "C" float sleep_p2_value(const sleep_p2_t *est) {
+    if (est == nullptr || est->count == 0) {
+        return 0.0f;
+    }
+    if (est->count >= 5U) {
+        return est->q[2];
+    }
+
+    /* 样本不足 5 个：对已收集样本取最近秩 */
+    float tmp[5];
+    std::copy(est->q, est->q + est->count, tmp);
+    std::sort(tmp, tmp + est->count);
+    const size_t idx = static_cast<size_t>(std::lround(est->p * static_cast<float>(est->count - 1U)));
+    return tmp[idx];
+}
+
+extern "C" void sleep_quantile_thresholds_init(sleep_quantile_thresholds_t *qt) {
+    if (qt == nullptr) {
+        return;
+    }
+    sleep_p2_init(&qt->rr_rem, SLEEP_QUANTILE_RR_REM);
+    sleep_p2_init(&qt->motion, SLEEP_QUANTILE_MOTION);
+    sleep_p2_init(&qt->motion_wake, SLEEP_QUANTILE_MOTION_WAKE);
+    sleep_p2_init(&qt->hr_mean, SLEEP_QUANTILE_HR_MEAN);
+    sleep_p2_init(&qt->hr_wake, SLEEP_QUANTILE_HR_WAKE);
+    sleep_p2_init(&qt->hrv_rem, SLEEP_QUANTILE_HRV_REM);
+    qt->epochs = 0;
+}
+
+extern "C" void sleep_quantile_thresholds_add_epoch(sleep_quantile_thresholds_t *qt, const sleep_epoch_t *epoch) {
+    if (qt == nullptr || epoch == nullptr) {
+        return;
+    }
+    /* 无有效采样的通道在 epoch 中记为 0，不能当作观测值，否则把分位数拉向 0 */
+    if (epoch->respiratory_rate_bpm > 0.0f) {
+        sleep_p2_add(&qt->rr_rem, epoch->respiratory_rate_bpm);
+    }
+    sleep_p2_add(&qt->motion, epoch->motion_index);
+    sleep_p2_add(&qt->motion_wake, epoch->motion_index);
+    if (epoch->heart_rate_mean > 0.0f) {
+        sleep_p2_add(&qt->hr_mean, epoch->heart_rate_mean);
+        sleep_p2_add(&qt->hr_wake, epoch->heart_rate_mean);
+        sleep_p2_add(&qt->hrv_rem, epoch->heart_rate_std);
+    }
+    qt->epochs++;
+}
+
+extern "C" int sleep_quantile_thresholds_get(const sleep_quantile_thresholds_t *qt, sleep_thresholds_t *out) {
+    if (qt == nullptr || out == nullptr || qt->epochs < SLEEP_QUANTILE_MIN_EPOCHS ||
+        qt->rr_rem.count < SLEEP_QUANTILE_MIN_EPOCHS || qt->hr_mean.count < SLEEP_QUANTILE_MIN_EPOCHS) {
+        return 0;
+    }
+    out->resp_rate_threshold = sleep_p2_value(&qt->rr_rem);
+    out->motion_threshold = sleep_p2_value(&qt->motion);
+    out->wake_motion_threshold = sleep_p2_value(&qt->motion_wake);
+    out->heart_rate_mean = sleep_p2_value(&qt->hr_mean);
+    out->heart_rate_wake_threshold = sleep_p2_value(&qt->hr_wake);
+    out->hrv_rem_threshold = sleep_p2_value(&qt->hrv_rem);
+    return 1;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sleep_analysis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * P² 流式分位数估计（Jain & Chlamtac 1985）
+ *
+ * 每个分位数只保留 5 个标记点，O(1) 内存、O(1) 更新，无需保存历史样本。
+ * 前 5 个样本精确排序，之后按抛物线插值调整标记高度。
+ */
+typedef struct {
+    float p;                     /* 目标分位 (0,1) */
+    float q[5];                  /* 标记高度，q[2] 为估计值 */
+    float np[5];                 /* 期望标记位置 */
+    int32_t n[5];                /* 实际标记位置 */
+    uint32_t count;              /* 已观测样本数 */
+} sleep_p2_t;
+
+void sleep_p2_init(sleep_p2_t *est, float p);
+void sleep_p2_add(sleep_p2_t *est, float x);
+/* 当前估计值；无样本返回 0 */
+float sleep_p2_value(const sleep_p2_t *est);
+
+/* 分位数阈值定义（对应 mean/std 公式的稳健替代） */
+#define SLEEP_QUANTILE_RR_REM       0.80f   /* 呼吸率阈值，约 mean+std */
+#define SLEEP_QUANTILE_MOTION       0.75f   /* 体动阈值 */
+#define SLEEP_QUANTILE_MOTION_WAKE  0.50f   /* 清醒体动阈值，约 mean */
+#define SLEEP_QUANTILE_HR_MEAN      0.50f   /* 心率中位数 */
+#define SLEEP_QUANTILE_HR_WAKE      0.70f   /* 清醒心率阈值，约 mean+0.5std */
+#define SLEEP_QUANTILE_HRV_REM      0.80f   /* REM 心率变异阈值 */
+#define SLEEP_QUANTILE_MIN_EPOCHS   10U     /* 任一通道有效 epoch 少于该数时不输出 */
+
+/**
+ * @brief 整晚分位数阈值：每通道若干 P² 估计器，逐 epoch O(1) 更新
+ */
+typedef struct {
+    sleep_p2_t rr_rem;
+    sleep_p2_t motion;
+    sleep_p2_t motion_wake;
+    sleep_p2_t hr_mean;
+    sleep_p2_t hr_wake;
+    sleep_p2_t hrv_rem;
+    uint32_t epochs;
+} sleep_quantile_thresholds_t;
+
+void sleep_quantile_thresholds_init(sleep_quantile_thresholds_t *qt);
+
+/**
+ * @brief 喂入一个 epoch。呼吸率为 0（本 epoch 无有效呼吸采样）时跳过呼吸通道，
+ *        心率均值为 0（无有效心率采样）时跳过心率与心率变异通道，体动总是计入。
+ */
+void sleep_quantile_thresholds_add_epoch(sleep_quantile_thresholds_t *qt, const sleep_epoch_t *epoch);
+
+/**
+ * @brief 输出分位数阈值
+ * @return 1 成功；体动、呼吸或心率通道的有效 epoch 数不足 SLEEP_QUANTILE_MIN_EPOCHS 时
+ *         返回 0 且不修改 out
+ */
+int sleep_quantile_thresholds_get(const sleep_quantile_thresholds_t *qt, sleep_thresholds_t *out);
+
+#ifdef __cplusplus
+}
+#endif
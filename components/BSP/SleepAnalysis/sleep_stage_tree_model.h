@@ -0,0 +1,92 @@
+#pragma once
+
+/*
+ * 由 tools/stage_tree_trainer.py 生成，请勿手工修改。
+ * 训练数据: synthetic (40 nights, seed 1)
+ * 训练样本: 24851 epoch，训练集准确率 95.5%，节点 41，深度 5
+ */
+
+#include "sleep_analysis.h"
+
+namespace sleep_stage_tree {
+
+constexpr int kFeatureCount = 9;
+constexpr int kNodeCount = 41;
+constexpr int kDepth = 5;
+
+/* 特征顺序：
+ *   x[0] motion_smoothed
+ *   x[1] respiratory_rate
+ *   x[2] heart_rate_mean
+ *   x[3] heart_rate_std
+ *   x[4] rr_minus_rr_threshold
+ *   x[5] motion_minus_motion_threshold
+ *   x[6] motion_minus_wake_motion_threshold
+ *   x[7] hr_minus_hr_wake_threshold
+ *   x[8] hrv_minus_hrv_rem_threshold
+ */
+constexpr sleep_stage_t predict(const float *x) {
+    if (x[3] <= 3.25739f) {  /* heart_rate_std */
+        if (x[1] <= 16.7801f) {  /* respiratory_rate */
+            if (x[2] <= 70.0738f) {  /* heart_rate_mean */
+                if (x[0] <= 8.39222f) {  /* motion_smoothed */
+                    return SLEEP_STAGE_NREM;
+                }
+                if (x[0] <= 14.684f) {  /* motion_smoothed */
+                    return SLEEP_STAGE_REM;
+                }
+                return SLEEP_STAGE_WAKE;
+            }
+            if (x[0] <= 11.0405f) {  /* motion_smoothed */
+                if (x[1] <= 12.0064f) {  /* respiratory_rate */
+                    return SLEEP_STAGE_NREM;
+                }
+                return SLEEP_STAGE_REM;
+            }
+            return SLEEP_STAGE_WAKE;
+        }
+        if (x[0] <= 13.5353f) {  /* motion_smoothed */
+            if (x[2] <= 58.6887f) {  /* heart_rate_mean */
+                return SLEEP_STAGE_NREM;
+            }
+            if (x[2] <= 73.8442f) {  /* heart_rate_mean */
+                return SLEEP_STAGE_REM;
+            }
+            return SLEEP_STAGE_WAKE;
+        }
+        return SLEEP_STAGE_WAKE;
+    }
+    if (x[0] <= 10.9473f) {  /* motion_smoothed */
+        if (x[4] <= -2.06379f) {  /* rr_minus_rr_threshold */
+            if (x[7] <= -3.54446f) {  /* hr_minus_hr_wake_threshold */
+                if (x[3] <= 4.39278f) {  /* heart_rate_std */
+                    return SLEEP_STAGE_NREM;
+                }
+                return SLEEP_STAGE_REM;
+            }
+            if (x[2] <= 61.9447f) {  /* heart_rate_mean */
+                return SLEEP_STAGE_NREM;
+            }
+            return SLEEP_STAGE_REM;
+        }
+        if (x[2] <= 59.512f) {  /* heart_rate_mean */
+            if (x[1] <= 16.4866f) {  /* respiratory_rate */
+                return SLEEP_STAGE_NREM;
+            }
+            return SLEEP_STAGE_REM;
+        }
+        if (x[7] <= 8.28077f) {  /* hr_minus_hr_wake_threshold */
+            return SLEEP_STAGE_REM;
+        }
+        return SLEEP_STAGE_WAKE;
+    }
+    if (x[0] <= 13.134f) {  /* motion_smoothed */
+        if (x[2] <= 68.3738f) {  /* heart_rate_mean */
+            return SLEEP_STAGE_REM;
+        }
+        return SLEEP_STAGE_WAKE;
+    }
+    return SLEEP_STAGE_WAKE;
+}
+
+}  // namespace sleep_stage_tree
@@ -9,6 +9,7 @@
 
 #include "uart.h"
 
+static QueueHandle_t s_uart_event_queue = NULL;
 
 /**
  * @brief       初始化UART
@@ -30,5 +31,15 @@ void uart0_init(uint32_t baudrate)
     ESP_ERROR_CHECK(uart_set_pin(USART_UX, USART_TX_GPIO_PIN, USART_RX_GPIO_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
     
     /* 安装串口驱动 */
-    ESP_ERROR_CHECK(uart_driver_install(USART_UX, RX_BUF_SIZE, RX_BUF_SIZE, 0, NULL, 0));
+    ESP_ERROR_CHECK(uart_driver_install(USART_UX, RX_BUF_SIZE, RX_BUF_SIZE, RX_EVENT_QUEUE_LEN, &s_uart_event_queue, 0));
+}
+
+/**
+ * @brief       获取串口事件队列（UART_DATA/溢出等），供事件驱动的接收使用
+ * @param       无
+ * @retval      队列句柄，未初始化时为NULL
+ */
+QueueHandle_t uart0_event_queue(void)
+{
+    return s_uart_event_queue;
 }
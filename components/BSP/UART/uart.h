@@ -21,8 +21,10 @@
 
 /* 串口接收相关定义 */
 #define RX_BUF_SIZE         1024        /* 环形缓冲区大小(单位字节) */
+#define RX_EVENT_QUEUE_LEN  20          /* 串口事件队列深度 */
 
 /* 函数声明 */
 void uart0_init(uint32_t baudrate);
+QueueHandle_t uart0_event_queue(void);
 
 #endif
\ No newline at end of file
@@ -9,6 +9,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -56,6 +57,20 @@ static void beep_task(void *arg)
     }
 }
 
+/* 推送通道下发的设备命令：beep 鸣响一次，便于在 App 中确认设备在线 */
+static void device_command_handler(const char *command, void *ctx)
+{
+    if (strcmp(command, "beep") == 0 && s_beep_queue)
+    {
+        int duration_ms = 300;
+        (void)xQueueSend(s_beep_queue, &duration_ms, 0);
+    }
+    else
+    {
+        printf("未知设备命令: %s\n", command);
+    }
+}
+
 void app_main(void)
 {
     esp_err_t ret = nvs_flash_init();
@@ -106,6 +121,7 @@ void app_main(void)
         printf("闹钟音乐任务启动失败\n");
     }
 
+    alarm_service_set_command_cb(device_command_handler, NULL);
     if (alarm_service_start(10000, alarm_music_ring_callback, NULL) != ESP_OK)
     {
         printf("闹钟服务启动失败\n");
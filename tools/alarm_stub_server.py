@@ -0,0 +1,340 @@
+#!/usr/bin/env python3
+"""
+闹钟接口的本地替身服务器（主机端，纯 Python，无第三方依赖）
+
+模拟固件 http_request.c 使用的闹钟接口：
+    GET /api/alarms/list/<userId>[?wait=S]        {"code":0,"data":{"alarms":[...]}}，带 ETag
+    PUT /api/alarms/<id>/status?userId=..&status=N 修改状态，列表版本随之变化
+    POST /api/devices/<userId>/command?name=beep  向设备下发命令（放在下一次列表响应的 data.command）
+列表响应带强 ETag（正文 SHA-1 前16位），请求带匹配的 If-None-Match 时回 304 且无正文。
+带 wait 时为长轮询：列表未变且无命令则挂起最多 S 秒（上限60），期间变化立即回 200，到期回 304。
+逐请求打印状态码、正文字节、挂起时长与 If-None-Match 命中情况，用于验证 304 短路、正文哈希回退
+与推送通道的重连、退回轮询。
+
+用法：
+    python tools/alarm_stub_server.py --port 6060
+    python tools/alarm_stub_server.py --alarms alarms.json    # 从文件加载闹钟数组
+    python tools/alarm_stub_server.py --no-etag               # 不发 ETag，验证固件按正文哈希判断
+    python tools/alarm_stub_server.py --change-every 300      # 每300秒改动一个闹钟的时间
+    python tools/alarm_stub_server.py --no-hold               # 忽略 wait 立即返回，验证固件退回周期轮询
+    python tools/alarm_stub_server.py --bench 8640            # 主机自测：模拟一天的10秒轮询，对比三种方式的流量与耗时
+    python tools/alarm_stub_server.py --bench-push 20         # 主机自测：20 次改动下轮询与长轮询的到达延迟与空闲流量
+    curl -X POST 'http://127.0.0.1:6060/api/devices/user123/command?name=beep'
+
+固件侧：http_set_alarm_server() 指向本机，报告中的“闹钟拉取”行给出拉取次数、304 次数与累计流量，
+http_alarm_get_fetch_stats() 另有单次延迟与解析耗时。
+"""
+
+import argparse
+import hashlib
+import http.client
+import json
+import random
+import re
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+LIST_RE = re.compile(r"^/api/alarms/list/([^/]+)$")
+STATUS_RE = re.compile(r"^/api/alarms/(\d+)/status$")
+COMMAND_RE = re.compile(r"^/api/devices/([^/]+)/command$")
+MAX_WAIT_S = 60
+
+
+def default_alarms():
+    return [
+        {"id": 101, "userId": "user123", "type": 2, "alarmTime": "07:00:00", "repeatDays": "1,2,3,4,5",
+         "status": 1, "smartWindow": 30, "label": "工作日"},
+        {"id": 102, "userId": "user123", "type": 2, "alarmTime": "09:30:00", "repeatDays": [6, 7],
+         "status": 1, "smartWindow": 0, "label": "周末"},
+        {"id": 103, "userId": "user123", "type": 1, "alarmTime": "06:15:00", "targetDate": "2026-10-20",
+         "status": 1, "smartWindow": 20, "label": "早班"},
+    ]
+
+
+def encode_doc(doc):
+    return json.dumps(doc, ensure_ascii=False, separators=(",", ":")).encode("utf-8")
+
+
+class AlarmStore:
+    def __init__(self, alarms):
+        self.lock = threading.Condition()
+        self.alarms = alarms
+        self.version = 0
+        self.commands = []
+        with self.lock:
+            self._render()
+
+    def _render(self):
+        self.doc = {"code": 0, "msg": "ok", "data": {"version": self.version, "alarms": self.alarms}}
+        self.body = encode_doc(self.doc)
+        self.etag = '"%s"' % hashlib.sha1(self.body).hexdigest()[:16]
+        self.changed_at = time.monotonic()
+        self.lock.notify_all()
+
+    def snapshot(self):
+        with self.lock:
+            return self.body, self.etag
+
+    def wait(self, inm, timeout):
+        """长轮询：列表仍是 inm 且无命令时挂起，返回 (body, etag, 是否304)；命令只随 ETag 不变的 200 正文下发一次"""
+        deadline = time.monotonic() + timeout
+        with self.lock:
+            while self.etag in inm and not self.commands:
+                left = deadline - time.monotonic()
+                if left <= 0:
+                    return b"", self.etag, True
+                self.lock.wait(left)
+            if not self.commands:
+                return self.body, self.etag, False
+            doc = json.loads(self.body)
+            doc["data"]["command"] = self.commands.pop(0)
+            return encode_doc(doc), self.etag, False
+
+    def push_command(self, name):
+        with self.lock:
+            self.commands.append(name)
+            self.lock.notify_all()
+
+    def set_status(self, alarm_id, status):
+        with self.lock:
+            for a in self.alarms:
+                if a["id"] == alarm_id:
+                    a["status"] = status
+                    self.version += 1
+                    self._render()
+                    return True
+            return False
+
+    def bump(self):
+        """改动第一个闹钟的分钟数，模拟用户在 App 中修改"""
+        with self.lock:
+            if not self.alarms:
+                return
+            h, m, s = (int(x) for x in self.alarms[0]["alarmTime"].split(":"))
+            self.alarms[0]["alarmTime"] = "%02d:%02d:%02d" % (h, (m + 1) % 60, s)
+            self.version += 1
+            self._render()
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.requests = 0
+        self.not_modified = 0
+        self.body_bytes = 0
+
+    def add(self, status, nbytes):
+        with self.lock:
+            self.requests += 1
+            self.not_modified += 1 if status == 304 else 0
+            self.body_bytes += nbytes
+
+
+class AlarmHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "AlarmStub/1.0"
+    disable_nagle_algorithm = True
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def do_GET(self):
+        url = urlparse(self.path)
+        if not LIST_RE.match(url.path):
+            self._send(404, b'{"code":404}')
+            return
+        inm = self.headers.get("If-None-Match")
+        inm = [t.strip() for t in inm.split(",")] if (inm and not self.server.no_etag) else []
+        wait = parse_qs(url.query).get("wait")
+        wait = 0 if (self.server.no_hold or not wait) else min(max(int(wait[0]), 0), MAX_WAIT_S)
+        t0 = time.monotonic()
+        body, etag, not_modified = self.server.store.wait(inm, wait)
+        self.held_ms = (time.monotonic() - t0) * 1000.0
+        if not_modified:
+            self._send(304, b"", etag)
+        else:
+            self._send(200, body, None if self.server.no_etag else etag)
+
+    def do_POST(self):
+        url = urlparse(self.path)
+        name = parse_qs(url.query).get("name")
+        if not COMMAND_RE.match(url.path) or not name:
+            self._send(400, b'{"code":400}')
+            return
+        self.server.store.push_command(name[0])
+        self._send(200, b'{"code":0}')
+
+    def do_PUT(self):
+        m = STATUS_RE.match(urlparse(self.path).path)
+        qs = parse_qs(urlparse(self.path).query)
+        if not m or "status" not in qs:
+            self._send(400, b'{"code":400}')
+            return
+        ok = self.server.store.set_status(int(m.group(1)), int(qs["status"][0]))
+        self._send(200 if ok else 404, b'{"code":0}' if ok else b'{"code":404}')
+
+    def _send(self, code, body, etag=None):
+        self.send_response(code)
+        if etag:
+            self.send_header("ETag", etag)
+        if code != 304:
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if body:
+            self.wfile.write(body)
+        self.server.stats.add(code, len(body))
+        if not self.server.quiet:
+            held = getattr(self, "held_ms", 0.0)
+            print("%-4s %-40s %d %5d B%s%s" % (self.command, self.path[:40], code, len(body),
+                                              "  held %.1f s" % (held / 1000.0) if held >= 100 else "",
+                                              "  (If-None-Match hit)" if code == 304 else ""))
+            sys.stdout.flush()
+        self.held_ms = 0.0
+
+
+def make_server(host, port, alarms, no_etag=False, no_hold=False):
+    srv = ThreadingHTTPServer((host, port), AlarmHandler)
+    srv.daemon_threads = True
+    srv.store = AlarmStore(alarms)
+    srv.stats = Stats()
+    srv.no_etag = no_etag
+    srv.no_hold = no_hold
+    srv.quiet = False
+    return srv
+
+
+def bench(n, alarms, change_every):
+    """模拟 n 次轮询（每 change_every 次列表改动一次），比较无条件、ETag、正文哈希三种方式"""
+    print("%-14s %8s %8s %12s %10s %10s" % ("mode", "fetches", "304", "rx bytes", "B/fetch", "ms/fetch"))
+    for mode in ("unconditional", "etag", "hash"):
+        srv = make_server("127.0.0.1", 0, [dict(a) for a in alarms], no_etag=(mode == "hash"))
+        srv.quiet = True
+        threading.Thread(target=srv.serve_forever, daemon=True).start()
+        conn = http.client.HTTPConnection("127.0.0.1", srv.server_address[1], timeout=5)
+        etag = None
+        rx = 0
+        changed = 0
+        last_hash = None
+        t0 = time.perf_counter()
+        for i in range(n):
+            if change_every and i and i % change_every == 0:
+                srv.store.bump()
+            headers = {"If-None-Match": etag} if (mode == "etag" and etag) else {}
+            conn.request("GET", "/api/alarms/list/user123", headers=headers)
+            r = conn.getresponse()
+            body = r.read()
+            # 响应头按 "key: value\r\n" 计，与固件统计口径一致
+            rx += len(body) + sum(len(k) + len(v) + 4 for k, v in r.getheaders())
+            if r.status == 200:
+                etag = r.getheader("ETag")
+                h = hashlib.sha1(body).digest()
+                if mode != "hash" or h != last_hash:
+                    changed += 1
+                last_hash = h
+        dt = (time.perf_counter() - t0) * 1000.0
+        conn.close()
+        print("%-14s %8d %8d %12d %10.1f %10.3f   list changes seen %d" % (
+            mode, n, srv.stats.not_modified, rx, rx / n, dt / n, changed))
+        srv.shutdown()
+    return 0
+
+
+def bench_push(n, alarms, period_s=1.0, wait_s=3):
+    """n 次随机时刻的改动，测量改动到设备收到新列表的延迟；轮询周期缩为 1 s（固件为 10 s，延迟约为其 1/10）"""
+    print("%-10s %8s %10s %10s %12s %14s" % ("mode", "changes", "mean ms", "max ms", "requests", "idle B/hour*"))
+    for mode in ("poll", "push"):
+        srv = make_server("127.0.0.1", 0, [dict(a) for a in alarms])
+        srv.quiet = True
+        threading.Thread(target=srv.serve_forever, daemon=True).start()
+        port = srv.server_address[1]
+        latencies = []
+        seen = {"etag": srv.store.snapshot()[1], "n": 0, "stop": False, "idle_bytes": 0, "idle_req": 0}
+
+        def device():
+            conn = http.client.HTTPConnection("127.0.0.1", port, timeout=wait_s + 5)
+            while not seen["stop"]:
+                path = "/api/alarms/list/user123" + ("?wait=%d" % wait_s if mode == "push" else "")
+                conn.request("GET", path, headers={"If-None-Match": seen["etag"]})
+                r = conn.getresponse()
+                body = r.read()
+                size = len(body) + sum(len(k) + len(v) + 4 for k, v in r.getheaders())
+                if r.status == 200:
+                    if r.getheader("ETag") != seen["etag"]:
+                        latencies.append((time.monotonic() - srv.store.changed_at) * 1000.0)
+                    seen["etag"] = r.getheader("ETag")
+                else:
+                    seen["idle_bytes"] += size
+                    seen["idle_req"] += 1
+                if mode == "poll":
+                    time.sleep(period_s)
+            conn.close()
+
+        t = threading.Thread(target=device, daemon=True)
+        t.start()
+        rnd = random.Random(1)
+        t0 = time.monotonic()
+        for _ in range(n):
+            time.sleep(rnd.uniform(0.3, 1.5))
+            srv.store.bump()
+        time.sleep(2 * wait_s + 0.5)     # 空闲阶段，统计 304 的大小
+        elapsed = time.monotonic() - t0
+        seen["stop"] = True
+        srv.store.push_command("stop")      # 唤醒挂起的长轮询
+        t.join(wait_s + 5)
+        srv.shutdown()
+        req_per_s = seen["idle_req"] / elapsed
+        avg_idle = seen["idle_bytes"] / max(seen["idle_req"], 1)
+        # 固件实际周期：轮询 10 s，长轮询挂起 25 s
+        fw_rate = 3600.0 / (10.0 if mode == "poll" else 25.0)
+        print("%-10s %8d %10.1f %10.1f %12d %14.0f   (measured %.2f req/s idle)" % (
+            mode, len(latencies), sum(latencies) / max(len(latencies), 1), max(latencies or [0]),
+            seen["idle_req"] + len(latencies), avg_idle * fw_rate, req_per_s))
+    print("* 空闲流量按固件实际周期换算：轮询每 10 s 一次 304，长轮询每 25 s 一次 304；轮询延迟需乘 10 对应固件")
+    return 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default="0.0.0.0")
+    ap.add_argument("--port", type=int, default=6060)
+    ap.add_argument("--alarms", help="JSON file with the alarm array")
+    ap.add_argument("--no-etag", action="store_true", help="never send ETag / answer 304")
+    ap.add_argument("--no-hold", action="store_true", help="ignore ?wait= (server without long-poll)")
+    ap.add_argument("--change-every", type=float, default=0, help="modify an alarm every N seconds (bench: every N fetches)")
+    ap.add_argument("--bench", type=int, metavar="N", help="host self-test: N polls per mode")
+    ap.add_argument("--bench-push", type=int, metavar="N", help="host self-test: propagation latency for N changes")
+    args = ap.parse_args()
+
+    alarms = default_alarms()
+    if args.alarms:
+        with open(args.alarms, encoding="utf-8") as f:
+            alarms = json.load(f)
+
+    if args.bench:
+        return bench(args.bench, alarms, int(args.change_every) or 2880)
+    if args.bench_push:
+        return bench_push(args.bench_push, alarms)
+
+    srv = make_server(args.host, args.port, alarms, args.no_etag, args.no_hold)
+    if args.change_every:
+        def changer():
+            while True:
+                time.sleep(args.change_every)
+                srv.store.bump()
+                print("[alarm list changed, etag %s]" % srv.store.snapshot()[1])
+        threading.Thread(target=changer, daemon=True).start()
+    print("alarm stub listening on %s:%d (%s%s)" % (args.host, args.port, "no etag" if args.no_etag else "etag",
+                                                    ", no long-poll" if args.no_hold else ""))
+    try:
+        srv.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
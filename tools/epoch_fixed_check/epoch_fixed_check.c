@@ -0,0 +1,214 @@
+/*
+ * 定点 epoch 聚合（sleep_epoch_fixed.c）与浮点的一致性检查
+ *
+ * 合成若干整晚数据：每个 epoch 的采样数在 4..64 间随机（对应 App 中随轮询周期变化的采样数），
+ * 心率缓慢漂移并叠加不同幅度的抖动（含零抖动与越界无效值），呼吸率含 0 与越界无效值。
+ * 每个 epoch 比较定点结果与：
+ *   - 双精度参考（有效值均值、样本标准差 n-1，与浮点路径定义相同），全部采样数；
+ *   - sleep_analysis_aggregate_samples 浮点路径，采样数不超过其每 epoch 上限 10 时。
+ * 误差超过 TOL_* 时打印该 epoch 并返回非 0。
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sleep_analysis.h"
+#include "sleep_epoch_fixed.h"
+
+#define NIGHTS            8
+#define EPOCHS_PER_NIGHT  960       /* 8 小时 */
+#define MIN_SAMPLES       4
+#define FLOAT_PATH_MAX    10        /* sleep_analysis_aggregate_samples 每 epoch 的采样数 */
+
+#define TOL_RR            0.0025    /* Q8.8 四舍五入误差 1/512 */
+#define TOL_HR_MEAN       0.0025
+#define TOL_HR_STD        0.01
+
+static uint32_t s_rng = 12345U;
+
+static uint32_t rnd(uint32_t n)
+{
+    s_rng = s_rng * 1664525U + 1013904223U;
+    return (s_rng >> 8) % n;
+}
+
+typedef struct {
+    double rr;
+    double hr_mean;
+    double hr_std;
+    uint8_t motion;
+} reference_t;
+
+static void reference(const radar_sample_t *s, uint32_t n, reference_t *out)
+{
+    double rr_sum = 0.0, hr_sum = 0.0;
+    uint32_t rr_n = 0, hr_n = 0;
+    out->motion = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (s[i].respiratory_rate_bpm > 0 && s[i].respiratory_rate_bpm <= 35) {
+            rr_sum += s[i].respiratory_rate_bpm;
+            rr_n++;
+        }
+        if (s[i].heart_rate_bpm >= 60 && s[i].heart_rate_bpm <= 120) {
+            hr_sum += s[i].heart_rate_bpm;
+            hr_n++;
+        }
+        if (s[i].motion_level > out->motion) {
+            out->motion = s[i].motion_level;
+        }
+    }
+    out->rr = (rr_n > 0) ? rr_sum / rr_n : 15.0;
+    if (hr_n == 0) {
+        out->hr_mean = 70.0;
+        out->hr_std = 2.0;
+        return;
+    }
+    out->hr_mean = hr_sum / hr_n;
+    double var = 0.0;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (s[i].heart_rate_bpm >= 60 && s[i].heart_rate_bpm <= 120) {
+            const double d = s[i].heart_rate_bpm - out->hr_mean;
+            var += d * d;
+        }
+    }
+    out->hr_std = (hr_n > 1) ? sqrt(var / (hr_n - 1)) : 0.0;
+}
+
+/* 一个 epoch 的合成采样：base 为本 epoch 心率中心，jitter 为逐采样抖动幅度 */
+static void synth_epoch(radar_sample_t *s, uint32_t n, int base_hr, int jitter, int base_rr)
+{
+    for (uint32_t i = 0; i < n; ++i) {
+        int hr = base_hr + ((jitter > 0) ? (int)rnd(2U * jitter + 1U) - jitter : 0);
+        int rr = base_rr + (int)rnd(5) - 2;
+        if (rnd(20) == 0) {
+            hr = (rnd(2) == 0) ? 0 : 130;       /* 无效心率 */
+        }
+        if (rnd(15) == 0) {
+            rr = (rnd(2) == 0) ? 0 : 40;        /* 无效呼吸率 */
+        }
+        s[i].heart_rate_bpm = (uint8_t)((hr < 0) ? 0 : (hr > 255 ? 255 : hr));
+        s[i].respiratory_rate_bpm = (uint8_t)((rr < 0) ? 0 : rr);
+        s[i].motion_level = (uint8_t)((rnd(10) == 0) ? rnd(101) : rnd(8));
+    }
+}
+
+typedef struct {
+    double rr, hr_mean, hr_std;
+} max_err_t;
+
+static void track(max_err_t *m, double rr, double mean, double std)
+{
+    if (rr > m->rr) m->rr = rr;
+    if (mean > m->hr_mean) m->hr_mean = mean;
+    if (std > m->hr_std) m->hr_std = std;
+}
+
+static int out_of_tol(double rr, double mean, double std)
+{
+    return rr > TOL_RR || mean > TOL_HR_MEAN || std > TOL_HR_STD;
+}
+
+static max_err_t s_err_ref, s_err_float;
+static uint32_t s_epochs, s_float_epochs, s_failures;
+
+/* 聚合一个 epoch 并与参考比较，label 用于定位失败的 epoch */
+static void check_epoch(const radar_sample_t *samples, uint32_t n, const char *label, int index)
+{
+    sleep_epoch_fixed_t q;
+    sleep_epoch_t fx;
+    if (!sleep_epoch_fixed_aggregate(samples, n, &q)) {
+        printf("%s %d: fixed aggregate returned 0\n", label, index);
+        s_failures++;
+        return;
+    }
+    sleep_epoch_fixed_to_float(&q, &fx);
+    s_epochs++;
+
+    reference_t ref;
+    reference(samples, n, &ref);
+    const double d_rr = fabs(fx.respiratory_rate_bpm - ref.rr);
+    const double d_mean = fabs(fx.heart_rate_mean - ref.hr_mean);
+    const double d_std = fabs(fx.heart_rate_std - ref.hr_std);
+    track(&s_err_ref, d_rr, d_mean, d_std);
+    if (out_of_tol(d_rr, d_mean, d_std) || fx.motion_index != (float)ref.motion) {
+        printf("%s %d n=%u: fixed rr %.4f hr %.4f±%.4f, reference rr %.4f hr %.4f±%.4f\n",
+               label, index, (unsigned)n, fx.respiratory_rate_bpm, fx.heart_rate_mean, fx.heart_rate_std,
+               ref.rr, ref.hr_mean, ref.hr_std);
+        s_failures++;
+    }
+
+    if (n > FLOAT_PATH_MAX) {
+        return;
+    }
+    sleep_epoch_t fl;
+    if (sleep_analysis_aggregate_samples(samples, n, &fl, 1) != 1) {
+        printf("%s %d: float aggregate returned 0\n", label, index);
+        s_failures++;
+        return;
+    }
+    s_float_epochs++;
+    const double f_rr = fabs(fx.respiratory_rate_bpm - fl.respiratory_rate_bpm);
+    const double f_mean = fabs(fx.heart_rate_mean - fl.heart_rate_mean);
+    const double f_std = fabs(fx.heart_rate_std - fl.heart_rate_std);
+    track(&s_err_float, f_rr, f_mean, f_std);
+    if (out_of_tol(f_rr, f_mean, f_std)) {
+        printf("%s %d n=%u: fixed rr %.4f hr %.4f±%.4f, float rr %.4f hr %.4f±%.4f\n",
+               label, index, (unsigned)n, fx.respiratory_rate_bpm, fx.heart_rate_mean, fx.heart_rate_std,
+               fl.respiratory_rate_bpm, fl.heart_rate_mean, fl.heart_rate_std);
+        s_failures++;
+    }
+}
+
+/* 边界 epoch：全部无效（默认值）、仅一个有效心率（std 0）、满 64 个相同值、满 64 个极差 60/120 */
+static void check_edges(void)
+{
+    static radar_sample_t s[SLEEP_FIXED_MAX_SAMPLES];
+    for (uint32_t i = 0; i < MIN_SAMPLES; ++i) {
+        s[i] = (radar_sample_t){.heart_rate_bpm = 0, .respiratory_rate_bpm = 0, .motion_level = 3};
+    }
+    check_epoch(s, MIN_SAMPLES, "edge", 0);
+    s[2].heart_rate_bpm = 75;
+    s[1].respiratory_rate_bpm = 14;
+    check_epoch(s, MIN_SAMPLES, "edge", 1);
+    for (uint32_t i = 0; i < SLEEP_FIXED_MAX_SAMPLES; ++i) {
+        s[i] = (radar_sample_t){.heart_rate_bpm = 88, .respiratory_rate_bpm = 35, .motion_level = 100};
+    }
+    check_epoch(s, SLEEP_FIXED_MAX_SAMPLES, "edge", 2);
+    for (uint32_t i = 0; i < SLEEP_FIXED_MAX_SAMPLES; ++i) {
+        s[i].heart_rate_bpm = (i & 1U) ? 120 : 60;
+        s[i].respiratory_rate_bpm = (i & 1U) ? 35 : 1;
+    }
+    check_epoch(s, SLEEP_FIXED_MAX_SAMPLES, "edge", 3);
+}
+
+int main(void)
+{
+    static radar_sample_t samples[SLEEP_FIXED_MAX_SAMPLES];
+    static const int jitters[] = {0, 1, 2, 4, 8, 15};
+
+    check_edges();
+    for (int night = 0; night < NIGHTS; ++night) {
+        int base_hr = 58 + (int)rnd(20);
+        int base_rr = 12 + (int)rnd(6);
+        for (int e = 0; e < EPOCHS_PER_NIGHT; ++e) {
+            base_hr += (int)rnd(3) - 1;
+            base_hr = (base_hr < 50) ? 50 : (base_hr > 115 ? 115 : base_hr);
+            if (rnd(8) == 0) {
+                base_rr = 10 + (int)rnd(12);
+            }
+            const int jitter = jitters[rnd(sizeof(jitters) / sizeof(jitters[0]))];
+            const uint32_t n = MIN_SAMPLES + rnd(SLEEP_FIXED_MAX_SAMPLES - MIN_SAMPLES + 1U);
+            synth_epoch(samples, n, base_hr, jitter, base_rr);
+            check_epoch(samples, n, "night epoch", night * EPOCHS_PER_NIGHT + e);
+        }
+    }
+
+    printf("%u epochs (%d-%u samples): max |fixed - reference| rr %.5f hr mean %.5f hr std %.5f\n",
+           (unsigned)s_epochs, MIN_SAMPLES, (unsigned)SLEEP_FIXED_MAX_SAMPLES,
+           s_err_ref.rr, s_err_ref.hr_mean, s_err_ref.hr_std);
+    printf("%u epochs (<=%d samples): max |fixed - float path| rr %.5f hr mean %.5f hr std %.5f\n",
+           (unsigned)s_float_epochs, FLOAT_PATH_MAX, s_err_float.rr, s_err_float.hr_mean, s_err_float.hr_std);
+    printf("tolerance rr %.4f hr mean %.4f hr std %.4f: %s (%u failures)\n",
+           TOL_RR, TOL_HR_MEAN, TOL_HR_STD, s_failures ? "FAIL" : "PASS", (unsigned)s_failures);
+    return s_failures ? 1 : 0;
+}
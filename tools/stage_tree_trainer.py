@@ -0,0 +1,389 @@
+#!/usr/bin/env python3
+"""
+睡眠分期决策树训练工具（主机端，纯 Python，无第三方依赖）
+
+输入：带标注的 epoch CSV，每行一个 30s epoch，列：
+    night,motion,rr,hr,hrv,stage[,subject]
+    night   夜晚编号（按夜计算阈值与平滑，同一夜的行需连续，从入睡开始）
+    motion  体动指数 (0-100)，rr 呼吸率，hr 心率均值，hrv 心率标准差
+    stage   WAKE / REM / NREM（或 1 / 2 / 3，与 sleep_stage_t 一致）
+    subject 可选，受试者编号；同一受试者的夜晚按时间顺序排列
+
+特征按固件判定当前 epoch 时所见的数据计算（因果，不读后续 epoch）：
+    固件每个 epoch 对整段序列运行 sleep_analysis_detect_stages_tree()，采用最新一个 epoch 的结果。
+    最新 epoch 处于序列末端，运动为边界 3 点中值 median(前一个, 当前, 当前)，即当前值本身；
+    阈值为 App 默认均值模式下的 sleep_analysis_compute_thresholds_seeded()：最近 40 个 epoch 的
+    mean/std 与个人基线按 w = 1 - exp(-已入睡 epoch 数 / 20) 混合。基线按固件规则逐晚融合
+    （前 7 晚累积平均，之后 alpha = 1/7），同一受试者的第一晚无基线，不足 10 个 epoch 用默认值。
+    分位数阈值模式 (APP_THRESHOLD_QUANTILE) 不在训练中模拟。
+
+输出：C++ 头文件，模型为 constexpr 嵌套分支（无堆、无虚函数）。
+
+用法：
+    python tools/stage_tree_trainer.py --csv nights.csv \
+        --out components/BSP/SleepAnalysis/sleep_stage_tree_model.h
+    python tools/stage_tree_trainer.py --synthetic 40 --out ...   # 合成数据（占位模型）
+"""
+
+import argparse
+import csv
+import math
+import random
+import sys
+
+STAGES = {"WAKE": 1, "REM": 2, "NREM": 3, "1": 1, "2": 2, "3": 3}
+STAGE_NAMES = {1: "SLEEP_STAGE_WAKE", 2: "SLEEP_STAGE_REM", 3: "SLEEP_STAGE_NREM"}
+
+FEATURES = [
+    "motion_smoothed",
+    "respiratory_rate",
+    "heart_rate_mean",
+    "heart_rate_std",
+    "rr_minus_rr_threshold",
+    "motion_minus_motion_threshold",
+    "motion_minus_wake_motion_threshold",
+    "hr_minus_hr_wake_threshold",
+    "hrv_minus_hrv_rem_threshold",
+]
+
+THRESH_WINDOW = 40
+THRESH_MIN = 10
+DEFAULT_THRESHOLDS = (16.0, 30.0, 15.0, 70.0, 75.0, 4.0)
+BASELINE_MAX_NIGHTS = 7        # SLEEP_BASELINE_MAX_NIGHTS
+BASELINE_DECAY_EPOCHS = 20.0   # SLEEP_BASELINE_DECAY_EPOCHS
+
+
+# ---------------------------------------------------------------- 特征（与固件判定最新 epoch 时一致）
+
+def median(values):
+    s = sorted(values)
+    return s[len(s) // 2]
+
+
+def smoothed_motion_newest(motion, i):
+    """motion[i] 为序列中最新一个 epoch 时固件的平滑结果（smoothed_motion 的末端分支）"""
+    prev = motion[i - 1] if i > 0 else motion[i]
+    return median([prev, motion[i], motion[i]])
+
+
+def mean_std(values):
+    n = len(values)
+    m = sum(values) / n
+    if n < 2:
+        return m, 0.0
+    var = sum((v - m) ** 2 for v in values) / (n - 1)
+    return m, math.sqrt(var)
+
+
+def channel_stats(epochs):
+    """四个通道 (motion, rr, hr, hrv) 的 (mean, std)"""
+    return [mean_std([e[c] for e in epochs]) for c in range(4)]
+
+
+def threshold_formulas(stats):
+    """apply_threshold_formulas：返回 (resp_rate, motion, wake_motion, hr_mean, hr_wake, hrv_rem)"""
+    (mv_m, mv_s), (rr_m, rr_s), (hr_m, hr_s), (hv_m, hv_s) = stats
+    return (rr_m + rr_s, mv_m + mv_s, mv_m, hr_m, hr_m + 0.5 * hr_s, hv_m + hv_s)
+
+
+def thresholds(epochs):
+    """sleep_analysis_compute_thresholds"""
+    if len(epochs) < THRESH_MIN:
+        return DEFAULT_THRESHOLDS
+    return threshold_formulas(channel_stats(epochs))
+
+
+def thresholds_seeded(epochs, elapsed, baseline):
+    """sleep_analysis_compute_thresholds_seeded；baseline 为 None 或 (nights, [(mean, var)] * 4)"""
+    if baseline is None:
+        return thresholds(epochs)
+    w = 1.0 - math.exp(-elapsed / BASELINE_DECAY_EPOCHS)
+    blended = []
+    for (b_mean, b_var), (n_mean, n_std) in zip(baseline[1], channel_stats(epochs)):
+        d = n_mean - b_mean
+        var = (1.0 - w) * max(b_var, 0.0) + w * n_std * n_std + w * (1.0 - w) * d * d
+        blended.append(((1.0 - w) * b_mean + w * n_mean, math.sqrt(var)))
+    return threshold_formulas(blended)
+
+
+def baseline_merge_night(baseline, epochs):
+    """sleep_analysis_baseline_merge_night，返回新基线"""
+    if len(epochs) < 2:
+        return baseline
+    stats = channel_stats(epochs)
+    if baseline is None:
+        return (1, [(m, s * s) for m, s in stats])
+    nights, channels = baseline
+    n = min(nights, BASELINE_MAX_NIGHTS)
+    alpha = 1.0 / min(n + 1, BASELINE_MAX_NIGHTS)
+    merged = []
+    for (b_mean, b_var), (n_mean, n_std) in zip(channels, stats):
+        d = n_mean - b_mean
+        merged.append(((1.0 - alpha) * b_mean + alpha * n_mean,
+                       (1.0 - alpha) * b_var + alpha * n_std * n_std + alpha * (1.0 - alpha) * d * d))
+    return (min(nights + 1, BASELINE_MAX_NIGHTS), merged)
+
+
+def night_features(epochs, baseline):
+    """epochs: [(motion, rr, hr, hrv)]，返回逐 epoch 特征向量（每行只用到该 epoch 及之前的数据）"""
+    motion = [e[0] for e in epochs]
+    rows = []
+    for i, (_, rr, hr, hrv) in enumerate(epochs):
+        start = max(0, i + 1 - THRESH_WINDOW)
+        t_rr, t_mv, t_wake, _, t_hr_wake, t_hrv = thresholds_seeded(epochs[start:i + 1], i + 1, baseline)
+        ms = smoothed_motion_newest(motion, i)
+        rows.append([ms, rr, hr, hrv, rr - t_rr, ms - t_mv, ms - t_wake, hr - t_hr_wake, hrv - t_hrv])
+    return rows
+
+
+# ---------------------------------------------------------------- CART（Gini）
+
+def gini(counts, total):
+    if total == 0:
+        return 0.0
+    return 1.0 - sum((c / total) ** 2 for c in counts.values())
+
+
+def majority(labels):
+    counts = {}
+    for y in labels:
+        counts[y] = counts.get(y, 0) + 1
+    return max(sorted(counts), key=lambda k: counts[k])
+
+
+def best_split(X, y, idx, min_leaf):
+    n = len(idx)
+    parent = {}
+    for i in idx:
+        parent[y[i]] = parent.get(y[i], 0) + 1
+    best = (gini(parent, n), None, None)
+    for f in range(len(FEATURES)):
+        order = sorted(idx, key=lambda i: X[i][f])
+        left = {}
+        right = dict(parent)
+        for pos in range(n - 1):
+            lab = y[order[pos]]
+            left[lab] = left.get(lab, 0) + 1
+            right[lab] -= 1
+            nl = pos + 1
+            nr = n - nl
+            a = X[order[pos]][f]
+            b = X[order[pos + 1]][f]
+            if a == b or nl < min_leaf or nr < min_leaf:
+                continue
+            score = (nl * gini(left, nl) + nr * gini(right, nr)) / n
+            if score < best[0] - 1e-9:
+                best = (score, f, (a + b) / 2.0)
+    return best[1], best[2]
+
+
+def build(X, y, idx, depth, max_depth, min_leaf):
+    labels = [y[i] for i in idx]
+    if depth >= max_depth or len(set(labels)) == 1 or len(idx) < 2 * min_leaf:
+        return {"leaf": majority(labels), "n": len(idx)}
+    f, thr = best_split(X, y, idx, min_leaf)
+    if f is None:
+        return {"leaf": majority(labels), "n": len(idx)}
+    li = [i for i in idx if X[i][f] <= thr]
+    ri = [i for i in idx if X[i][f] > thr]
+    l = build(X, y, li, depth + 1, max_depth, min_leaf)
+    r = build(X, y, ri, depth + 1, max_depth, min_leaf)
+    # 左右同类时合并
+    if "leaf" in l and "leaf" in r and l["leaf"] == r["leaf"]:
+        return {"leaf": l["leaf"], "n": len(idx)}
+    return {"feature": f, "threshold": thr, "left": l, "right": r}
+
+
+def predict(node, x):
+    while "leaf" not in node:
+        node = node["left"] if x[node["feature"]] <= node["threshold"] else node["right"]
+    return node["leaf"]
+
+
+def tree_stats(node, depth=0):
+    if "leaf" in node:
+        return 1, depth
+    ln, ld = tree_stats(node["left"], depth + 1)
+    rn, rd = tree_stats(node["right"], depth + 1)
+    return ln + rn + 1, max(ld, rd)
+
+
+# ---------------------------------------------------------------- 数据
+
+def load_csv(path):
+    """返回 [(subject, night)]，night 为 [((motion, rr, hr, hrv), stage)]"""
+    nights = {}
+    order = []
+    with open(path, newline="") as fh:
+        for row in csv.DictReader(fh):
+            key = row["night"]
+            if key not in nights:
+                nights[key] = (row.get("subject") or "", [])
+                order.append(key)
+            stage = STAGES.get(row["stage"].strip().upper())
+            if stage is None:
+                raise ValueError("unknown stage label: %r" % row["stage"])
+            nights[key][1].append(((float(row["motion"]), float(row["rr"]),
+                                    float(row["hr"]), float(row["hrv"])), stage))
+    return [nights[k] for k in order]
+
+
+def synthetic_nights(count, seed, nights_per_subject=7):
+    """合成夜晚：马尔可夫阶段序列 + 按阶段条件分布的体征（仅用于占位模型），每个受试者连续若干晚"""
+    rng = random.Random(seed)
+    trans = {1: [(1, 0.85), (3, 0.15)], 3: [(3, 0.93), (2, 0.04), (1, 0.03)], 2: [(2, 0.90), (3, 0.07), (1, 0.03)]}
+    nights = []
+    for k in range(count):
+        if k % nights_per_subject == 0:
+            subject_hr = rng.uniform(58, 72)
+            subject_rr = rng.uniform(12, 16)
+        base_hr = subject_hr + rng.gauss(0, 1.5)
+        base_rr = subject_rr + rng.gauss(0, 0.5)
+        stage = 1
+        night = []
+        for _ in range(rng.randint(600, 960)):
+            if stage == 1:
+                mv = max(0.0, rng.gauss(30, 15))
+                hr = base_hr + rng.gauss(10, 3)
+                rr = base_rr + rng.gauss(2, 1.5)
+                hrv = abs(rng.gauss(4.5, 1.5))
+            elif stage == 2:
+                mv = max(0.0, rng.gauss(4, 3))
+                hr = base_hr + rng.gauss(4, 2.5)
+                rr = base_rr + rng.gauss(2.5, 1.2)
+                hrv = abs(rng.gauss(4.0, 1.2))
+            else:
+                mv = max(0.0, rng.gauss(2, 2))
+                hr = base_hr + rng.gauss(-3, 2)
+                rr = base_rr + rng.gauss(-1, 1)
+                hrv = abs(rng.gauss(2.0, 0.8))
+            night.append(((min(mv, 100.0), rr, hr, hrv), stage))
+            r = rng.random()
+            acc = 0.0
+            for nxt, p in trans[stage]:
+                acc += p
+                if r < acc:
+                    stage = nxt
+                    break
+        nights.append(("s%d" % (k // nights_per_subject), night))
+    return nights
+
+
+def featurize(nights):
+    """按文件顺序逐晚计算特征，返回每晚的 (X, y)；每晚之后把该晚融合进该受试者的基线，供下一晚预置阈值"""
+    out = []
+    baselines = {}
+    for subject, night in nights:
+        epochs = [e for e, _ in night]
+        baseline = baselines.get(subject)
+        out.append((night_features(epochs, baseline), [s for _, s in night]))
+        baselines[subject] = baseline_merge_night(baseline, epochs)
+    return out
+
+
+def flatten(per_night, indices):
+    X, y = [], []
+    for i in indices:
+        X.extend(per_night[i][0])
+        y.extend(per_night[i][1])
+    return X, y
+
+
+# ---------------------------------------------------------------- 代码生成
+
+def emit_node(node, indent, out):
+    pad = "    " * indent
+    if "leaf" in node:
+        out.append("%sreturn %s;" % (pad, STAGE_NAMES[node["leaf"]]))
+        return
+    out.append("%sif (x[%d] <= %.6gf) {  /* %s */" % (pad, node["feature"], node["threshold"],
+                                                     FEATURES[node["feature"]]))
+    emit_node(node["left"], indent + 1, out)
+    out.append("%s}" % pad)
+    emit_node(node["right"], indent, out)
+
+
+def emit_header(tree, source, accuracy, samples):
+    nodes, depth = tree_stats(tree)
+    lines = [
+        "#pragma once",
+        "",
+        "/*",
+        " * 由 tools/stage_tree_trainer.py 生成，请勿手工修改。",
+        " * 训练数据: %s" % source,
+        " * 训练样本: %d epoch，训练集准确率 %.1f%%，节点 %d，深度 %d" % (samples, accuracy * 100.0, nodes, depth),
+        " */",
+        "",
+        "#include \"sleep_analysis.h\"",
+        "",
+        "namespace sleep_stage_tree {",
+        "",
+        "constexpr int kFeatureCount = %d;" % len(FEATURES),
+        "constexpr int kNodeCount = %d;" % nodes,
+        "constexpr int kDepth = %d;" % depth,
+        "",
+        "/* 特征顺序：",
+    ]
+    for i, name in enumerate(FEATURES):
+        lines.append(" *   x[%d] %s" % (i, name))
+    lines += [
+        " */",
+        "constexpr sleep_stage_t predict(const float *x) {",
+    ]
+    body = []
+    emit_node(tree, 1, body)
+    lines += body
+    lines += [
+        "}",
+        "",
+        "}  // namespace sleep_stage_tree",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    src = ap.add_mutually_exclusive_group(required=True)
+    src.add_argument("--csv", help="labelled epoch CSV")
+    src.add_argument("--synthetic", type=int, metavar="NIGHTS", help="train on N synthetic nights")
+    ap.add_argument("--out", required=True, help="generated header path")
+    ap.add_argument("--max-depth", type=int, default=5)
+    ap.add_argument("--min-leaf", type=int, default=40)
+    ap.add_argument("--seed", type=int, default=1)
+    ap.add_argument("--holdout", type=float, default=0.2, help="fraction of nights held out for validation")
+    args = ap.parse_args()
+
+    if args.csv:
+        nights = load_csv(args.csv)
+        source = args.csv
+    else:
+        nights = synthetic_nights(args.synthetic, args.seed)
+        source = "synthetic (%d nights, seed %d)" % (args.synthetic, args.seed)
+
+    # 基线只用体征不用标注，全部夜晚按顺序计算特征后再划分留出集
+    per_night = featurize(nights)
+    rng = random.Random(args.seed)
+    order = list(range(len(nights)))
+    rng.shuffle(order)
+    n_hold = int(len(nights) * args.holdout) if len(nights) > 1 else 0
+    hold = order[:n_hold]
+
+    X, y = flatten(per_night, order[n_hold:])
+    tree = build(X, y, list(range(len(X))), 0, args.max_depth, args.min_leaf)
+    acc = sum(predict(tree, x) == t for x, t in zip(X, y)) / len(X)
+    print("train: %d epochs, accuracy %.1f%%" % (len(X), acc * 100.0))
+    if hold:
+        Xh, yh = flatten(per_night, hold)
+        hacc = sum(predict(tree, x) == t for x, t in zip(Xh, yh)) / len(Xh)
+        print("holdout: %d epochs, accuracy %.1f%%" % (len(Xh), hacc * 100.0))
+
+    with open(args.out, "w", newline="\n") as fh:
+        fh.write(emit_header(tree, source, acc, len(X)))
+    nodes, depth = tree_stats(tree)
+    print("wrote %s (%d nodes, depth %d)" % (args.out, nodes, depth))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
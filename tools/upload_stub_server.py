@@ -0,0 +1,358 @@
+#!/usr/bin/env python3
+"""
+健康数据上传的本地替身服务器（主机端，纯 Python，无第三方依赖）
+
+模拟 SERVER_URL / BATCH_UPLOAD_URL / NIGHT_SUMMARY_URL 三个上传接口，用于在没有正式后端时
+测量固件上传延迟与连接复用：
+    POST /api/health/upload         单条 epoch
+    POST /api/health/upload/batch   {"sentAt":..,"items":[...],"report":{...}}，回复 {"code":0,"accepted":N}
+    POST /api/health/night          整晚摘要二进制包
+批量接口按 http_request.h 中 http_send_health_batch 的约定实现：accepted 为已处理的前 N 条，
+按 ts 去重（重发幂等）。遥测载荷接受 application/json 与 application/cbor（整数键，
+字段表见 telemetry_codec.h，这里解码回 JSON 键名），请求体可带 Content-Encoding: gzip。
+服务器为 HTTP/1.1 keep-alive，逐请求打印
+连接序号、该连接上的第几个请求、路径、字节数与服务端处理耗时，
+并每 --report 个请求汇总一次新建连接数与复用率。
+
+用法：
+    python tools/upload_stub_server.py --port 6060
+    python tools/upload_stub_server.py --port 6060 --close         # 每次响应后关闭连接（无 keep-alive 的后端）
+    python tools/upload_stub_server.py --port 6060 --idle-timeout 20  # 空闲连接20秒后断开，验证固件重连
+    python tools/upload_stub_server.py --batch-limit 8      # 每批只确认前8条，验证固件的部分确认重发
+    python tools/upload_stub_server.py --no-batch           # 批量接口返回404，验证固件回退逐条上传
+    python tools/upload_stub_server.py --fail-every 5       # 每第5个请求返回503，验证失败退避
+    python tools/upload_stub_server.py --json-only          # CBOR 载荷返回415，验证固件回退 JSON
+    python tools/upload_stub_server.py --no-gzip            # gzip 请求体返回415，验证固件改为不压缩发送
+    python tools/upload_stub_server.py --decode FILE        # 把固件抓到的 CBOR 载荷解码为 JSON 打印
+    python tools/upload_stub_server.py --bench 200                  # 主机自测：同一服务器上短连接与长连接的延迟对比
+
+固件侧对比：把 http_request.c 的 SERVER_URL 指向本机，
+HTTP_UPLOAD_KEEP_ALIVE 分别置 0 / 1，报告中的“上传”行给出新建/复用连接数、平均延迟与堆最低值。
+汇总中的 wire bytes 为实际收到的请求体字节数，body bytes 为解压后的字节数，两者之比即压缩比。
+"""
+
+import argparse
+import gzip
+import http.client
+import json
+import struct
+import sys
+import threading
+import time
+import zlib
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+PATHS = ("/api/health/upload", "/api/health/night", "/api/health/upload/batch")
+
+# telemetry_codec.h 的整数键表
+HEALTH_KEYS = ("ts", "heartRate", "breathingRate", "sleepStatus", "radarSleepStatus", "radarSleepScore", "arousals")
+BATCH_KEYS = ("sentAt", "items", "report")
+REPORT_KEYS = ("wakeSeconds", "remSeconds", "nremSeconds", "remRatio", "sleepEfficiency",
+               "avgRespRate", "avgMotion", "avgHeartRate", "avgHrv", "sleepScore")
+
+
+def cbor_decode(data):
+    """最小 CBOR 解码：无符号/负整数、文本、数组、map、float16/32/64、简单值"""
+    pos = 0
+
+    def item():
+        nonlocal pos
+        ib = data[pos]
+        pos += 1
+        major, info = ib >> 5, ib & 0x1F
+        if major == 7:
+            if info in (25, 26, 27):
+                n = {25: 2, 26: 4, 27: 8}[info]
+                raw = data[pos:pos + n]
+                pos += n
+                return struct.unpack(">" + {2: "e", 4: "f", 8: "d"}[n], raw)[0]
+            return {20: False, 21: True, 22: None}.get(info)
+        if info < 24:
+            val = info
+        elif info <= 27:
+            n = 1 << (info - 24)
+            val = int.from_bytes(data[pos:pos + n], "big")
+            pos += n
+        else:
+            raise ValueError("indefinite length not supported")
+        if major == 0:
+            return val
+        if major == 1:
+            return -1 - val
+        if major in (2, 3):
+            raw = data[pos:pos + val]
+            pos += val
+            return raw.decode("utf-8") if major == 3 else raw
+        if major == 4:
+            return [item() for _ in range(val)]
+        if major == 5:
+            out = {}
+            for _ in range(val):
+                k = item()
+                out[k] = item()
+            return out
+        raise ValueError("unsupported major type %d" % major)
+
+    obj = item()
+    if pos != len(data):
+        raise ValueError("trailing bytes")
+    return obj
+
+
+def rename(obj, keys):
+    if not isinstance(obj, dict):
+        raise ValueError("expected a map")
+    return {keys[k] if isinstance(k, int) and k < len(keys) else k: v for k, v in obj.items()}
+
+
+def telemetry_from_cbor(data, batch):
+    """把整数键 CBOR 还原为与 JSON 载荷相同的结构"""
+    doc = cbor_decode(data)
+    if not batch:
+        return rename(doc, HEALTH_KEYS)
+    doc = rename(doc, BATCH_KEYS)
+    doc["items"] = [rename(it, HEALTH_KEYS) for it in doc.get("items", [])]
+    if "report" in doc:
+        doc["report"] = rename(doc["report"], REPORT_KEYS)
+    return doc
+
+
+class Stats:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.connections = 0
+        self.requests = 0
+        self.reused = 0
+        self.bytes = 0
+        self.wire = 0
+        self.items = 0
+        self.duplicates = 0
+        self.seen_ts = set()
+
+    def new_connection(self):
+        with self.lock:
+            self.connections += 1
+            return self.connections
+
+    def request(self, reused, nbytes, wire):
+        with self.lock:
+            self.requests += 1
+            self.reused += 1 if reused else 0
+            self.bytes += nbytes
+            self.wire += wire
+            return self.requests
+
+    def epochs(self, items):
+        """记录入库的 epoch，返回其中按 ts 判为重复的条数"""
+        with self.lock:
+            dup = 0
+            for it in items:
+                ts = it.get("ts", 0)
+                if ts and ts in self.seen_ts:
+                    dup += 1
+                elif ts:
+                    self.seen_ts.add(ts)
+            self.items += len(items) - dup
+            self.duplicates += dup
+            return dup
+
+    def summary(self):
+        with self.lock:
+            ratio = 100.0 * self.reused / self.requests if self.requests else 0.0
+            return "requests %d, connections %d, reused %d (%.1f%%), wire bytes %d, body bytes %d, epochs %d (dup %d)" % (
+                self.requests, self.connections, self.reused, ratio, self.wire, self.bytes, self.items, self.duplicates)
+
+
+class UploadHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "UploadStub/1.0"
+    disable_nagle_algorithm = True   # 头与正文分两次写出，否则长连接上会撞上对端的延迟 ACK（约40ms）
+
+    def setup(self):
+        super().setup()
+        self.conn_id = self.server.stats.new_connection()
+        self.conn_requests = 0
+        if self.server.idle_timeout:
+            self.request.settimeout(self.server.idle_timeout)
+
+    def log_message(self, fmt, *args):
+        pass
+
+    def do_POST(self):
+        t0 = time.perf_counter()
+        length = int(self.headers.get("Content-Length", 0))
+        body = self.rfile.read(length) if length else b""
+        wire = len(body)
+        self.conn_requests += 1
+
+        if self.path not in PATHS or (self.path == PATHS[2] and self.server.no_batch):
+            self._reply(404, {"code": 404, "msg": "unknown path"})
+            return
+
+        encoding = self.headers.get("Content-Encoding", "identity").strip().lower()
+        if encoding == "gzip" and not self.server.no_gzip:
+            try:
+                body = gzip.decompress(body)
+            except (OSError, EOFError, zlib.error):
+                self._reply(400, {"code": 400, "msg": "bad gzip body"})
+                return
+        elif encoding != "identity":
+            self._reply(415, {"code": 415, "msg": "unsupported content encoding"})
+            return
+
+        if self.server.fail_every and (self.server.stats.requests + 1) % self.server.fail_every == 0:
+            self.server.stats.request(self.conn_requests > 1, len(body), wire)
+            self._reply(503, {"code": 503, "msg": "injected failure"})
+            return
+
+        reply = {"code": 0}
+        note = ""
+        if self.path != PATHS[1]:
+            cbor = self.headers.get("Content-Type", "").startswith("application/cbor")
+            if cbor and self.server.json_only:
+                self._reply(415, {"code": 415, "msg": "unsupported media type"})
+                return
+            try:
+                if cbor:
+                    doc = telemetry_from_cbor(body, self.path == PATHS[2])
+                else:
+                    doc = json.loads(body.decode("utf-8"))
+            except (ValueError, IndexError, KeyError, UnicodeDecodeError, struct.error):
+                self._reply(400, {"code": 400, "msg": "bad payload"})
+                return
+            items = [doc] if self.path == PATHS[0] else doc.get("items", [])
+            if self.path == PATHS[2]:
+                if not isinstance(items, list):
+                    self._reply(400, {"code": 400, "msg": "items must be an array"})
+                    return
+                if self.server.batch_limit:
+                    items = items[:self.server.batch_limit]
+                reply["accepted"] = len(items)
+                note = "  %d/%d items%s" % (len(items), len(doc.get("items", [])),
+                                            "  +report" if "report" in doc else "")
+            if cbor:
+                note += "  cbor"
+            dup = self.server.stats.epochs(items)
+            if dup:
+                note += "  dup %d" % dup
+
+        self._reply(200, reply)
+        n = self.server.stats.request(self.conn_requests > 1, len(body), wire)
+        if encoding == "gzip":
+            note += "  gzip %d B (%.1fx)" % (wire, len(body) / float(wire or 1))
+        if self.server.quiet:
+            return
+        print("conn %-4d req %-4d %-26s %5d B  %.2f ms%s" % (
+            self.conn_id, self.conn_requests, self.path, len(body), (time.perf_counter() - t0) * 1000.0, note))
+        if n % self.server.report == 0:
+            print("[summary] " + self.server.stats.summary())
+        sys.stdout.flush()
+
+    def _reply(self, code, obj):
+        data = json.dumps(obj).encode("utf-8")
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        if self.server.force_close:
+            self.send_header("Connection", "close")
+            self.close_connection = True
+        self.end_headers()
+        self.wfile.write(data)
+
+
+def make_server(host, port, force_close=False, idle_timeout=0, report=20,
+                batch_limit=0, no_batch=False, fail_every=0, json_only=False, no_gzip=False):
+    srv = ThreadingHTTPServer((host, port), UploadHandler)
+    srv.daemon_threads = True
+    srv.stats = Stats()
+    srv.force_close = force_close
+    srv.idle_timeout = idle_timeout
+    srv.report = max(1, report)
+    srv.quiet = False
+    srv.batch_limit = batch_limit
+    srv.no_batch = no_batch
+    srv.fail_every = fail_every
+    srv.json_only = json_only
+    srv.no_gzip = no_gzip
+    return srv
+
+
+def bench(n):
+    """在本机临时端口上起服务器，分别以短连接/长连接发 n 个与固件相同的 JSON 请求"""
+    srv = make_server("127.0.0.1", 0)
+    srv.quiet = True
+    port = srv.server_address[1]
+    threading.Thread(target=srv.serve_forever, daemon=True).start()
+    body = json.dumps({"heartRate": 62, "breathingRate": 14, "sleepStatus": "NREM", "arousals": 0},
+                      separators=(",", ":")).encode("utf-8")
+    headers = {"Content-Type": "application/json"}
+
+    def run(keep_alive):
+        lat = []
+        conn = None
+        for _ in range(n):
+            t0 = time.perf_counter()
+            if conn is None:
+                conn = http.client.HTTPConnection("127.0.0.1", port, timeout=5)
+            conn.request("POST", PATHS[0], body, headers)
+            conn.getresponse().read()
+            if not keep_alive:
+                conn.close()
+                conn = None
+            lat.append((time.perf_counter() - t0) * 1000.0)
+        if conn is not None:
+            conn.close()
+        lat.sort()
+        return lat
+
+    try:
+        for keep_alive in (False, True):
+            before = srv.stats.connections
+            lat = run(keep_alive)
+            print("%-10s n=%d connections=%d mean %.3f ms p50 %.3f ms p95 %.3f ms" % (
+                "keep-alive" if keep_alive else "per-req", n, srv.stats.connections - before,
+                sum(lat) / len(lat), lat[len(lat) // 2], lat[int(len(lat) * 0.95)]))
+    finally:
+        srv.shutdown()
+    return 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default="0.0.0.0")
+    ap.add_argument("--port", type=int, default=6060)
+    ap.add_argument("--close", action="store_true", help="send Connection: close after every response")
+    ap.add_argument("--idle-timeout", type=float, default=0, help="drop idle keep-alive connections after N seconds")
+    ap.add_argument("--report", type=int, default=20, help="print a summary every N requests")
+    ap.add_argument("--batch-limit", type=int, default=0, help="acknowledge at most N items per batch")
+    ap.add_argument("--no-batch", action="store_true", help="answer 404 on the batch endpoint")
+    ap.add_argument("--fail-every", type=int, default=0, help="answer 503 to every Nth request")
+    ap.add_argument("--json-only", action="store_true", help="answer 415 to CBOR payloads")
+    ap.add_argument("--no-gzip", action="store_true", help="answer 415 to gzip-encoded bodies")
+    ap.add_argument("--decode", metavar="FILE", help="decode a captured CBOR batch payload and print it as JSON")
+    ap.add_argument("--bench", type=int, metavar="N", help="host self-test: N per-request vs keep-alive POSTs")
+    args = ap.parse_args()
+
+    if args.bench:
+        return bench(args.bench)
+    if args.decode:
+        with open(args.decode, "rb") as f:
+            data = f.read()
+        doc = cbor_decode(data)
+        batch = isinstance(doc, dict) and 1 in doc and isinstance(doc[1], list)
+        print(json.dumps(telemetry_from_cbor(data, batch), indent=2, ensure_ascii=False))
+        return 0
+
+    srv = make_server(args.host, args.port, args.close, args.idle_timeout, args.report,
+                      args.batch_limit, args.no_batch, args.fail_every, args.json_only, args.no_gzip)
+    print("upload stub listening on %s:%d (%s)" % (args.host, args.port, "close" if args.close else "keep-alive"))
+    try:
+        srv.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print("[summary] " + srv.stats.summary())
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())